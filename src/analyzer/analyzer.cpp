@@ -0,0 +1,198 @@
+#include "analyzer.h"
+
+#include <fstream>
+#include <boost/locale/encoding_utf.hpp>
+
+namespace {
+
+//! Максимальная длина слова в символах. Более длинные последовательности не индексируются.
+const size_t maxWordLength = 45;
+
+bool isCyrillic(char32_t c) {
+    return (c >= 0x0400 && c <= 0x04FF);
+}
+
+bool isLatin(char32_t c) {
+    return (c >= U'a' && c <= U'z');
+}
+
+char32_t toLower(char32_t c) {
+    if (c >= U'A' && c <= U'Z') {
+        return c + (U'a' - U'A');
+    }
+    if (c >= U'А' && c <= U'Я') {
+        return c + (U'а' - U'А');
+    }
+    if (c == U'Ё') {
+        return U'ё';
+    }
+    return c;
+}
+
+/**
+* @brief Проверить, является ли символ частью слова.
+* @details Разделителями считаются пробельные символы, знаки препинания ASCII, неразрывный
+* пробел, кавычки-ёлочки и блок общей пунктуации Unicode (тире, многоточие и т.п.).
+*/
+bool isWordChar(char32_t c) {
+    if (c < 0x80) {
+        return (c >= U'0' && c <= U'9') || (c >= U'a' && c <= U'z') || (c >= U'A' && c <= U'Z');
+    }
+    if (c == 0xA0 || c == 0xAB || c == 0xBB) {
+        return false;
+    }
+    if ((c >= 0x2000 && c <= 0x206F) || (c >= 0x3000 && c <= 0x303F)) {
+        return false;
+    }
+    return true;
+}
+
+std::string toUtf8(const std::u32string &word) {
+    return boost::locale::conv::utf_to_utf<char>(word);
+}
+
+} // namespace
+
+Analyzer::Analyzer() :
+stemming_(true),
+stopWords_(),
+ruStemmer_(),
+enStemmer_() {
+}
+
+Analyzer::Analyzer(const AnalyzerConfig &config) :
+stemming_(config.stemming),
+stopWords_(),
+ruStemmer_(),
+enStemmer_() {
+    if (!config.stopWordsRuPath.empty()) {
+        loadStopWords(config.stopWordsRuPath);
+    }
+    if (!config.stopWordsEnPath.empty()) {
+        loadStopWords(config.stopWordsEnPath);
+    }
+}
+
+std::vector<std::string> Analyzer::analyze(const std::string &text) const {
+    std::vector<std::string> words;
+    for (auto &token : tokenize(text)) {
+        words.push_back(std::move(token.term));
+    }
+
+    return words;
+}
+
+std::vector<Token> Analyzer::tokenize(const std::string &text) const {
+    std::vector<Token> tokens;
+    const std::u32string source = boost::locale::conv::utf_to_utf<char32_t>(text);
+
+    uint32_t position = 0;
+    std::u32string word;
+    for (size_t i = 0; i <= source.size(); ++i) {
+        if (i < source.size() && isWordChar(source[i])) {
+            word += source[i];
+            continue;
+        }
+
+        if (!word.empty()) {
+            std::string normalized = normalizeWord(word);
+            if (!normalized.empty()) {
+                tokens.push_back(Token {std::move(normalized), position, toUtf8(word)});
+            }
+            ++position;
+            word.clear();
+        }
+    }
+
+    return tokens;
+}
+
+std::string Analyzer::normalize(const std::string &word) const {
+    std::u32string source = boost::locale::conv::utf_to_utf<char32_t>(word);
+
+    std::u32string cleared;
+    for (char32_t c : source) {
+        if (isWordChar(c)) {
+            cleared += c;
+        }
+    }
+
+    return normalizeWord(cleared);
+}
+
+std::string Analyzer::normalizePrefix(const std::string &text) const {
+    const std::u32string source = boost::locale::conv::utf_to_utf<char32_t>(text);
+
+    size_t begin = source.size();
+    while (begin > 0 && isWordChar(source[begin - 1])) {
+        --begin;
+    }
+    std::u32string word = source.substr(begin, maxWordLength);
+    for (char32_t &c : word) {
+        c = toLower(c);
+    }
+    return toUtf8(word);
+}
+
+bool Analyzer::isStopWord(const std::string &word) const {
+    return stopWords_.count(word) != 0;
+}
+
+void Analyzer::loadStopWords(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Analyzer::loadStopWords: Error: can't open " << path << std::endl;
+        return;
+    }
+
+    std::string line;
+    size_t count = 0;
+    while (std::getline(file, line)) {
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        const size_t end = line.find_last_not_of(" \t\r");
+        std::u32string word = boost::locale::conv::utf_to_utf<char32_t>(
+                line.substr(begin, end - begin + 1));
+        for (char32_t &c : word) {
+            c = toLower(c);
+        }
+        stopWords_.insert(toUtf8(word));
+        ++count;
+    }
+
+    std::cout << "Analyzer::loadStopWords: loaded " << count << " words from " << path
+              << std::endl;
+}
+
+std::string Analyzer::normalizeWord(std::u32string &word) const {
+    if (word.empty() || word.size() > maxWordLength) {
+        return "";
+    }
+
+    bool cyrillic = true;
+    bool latin = true;
+    for (char32_t &c : word) {
+        c = toLower(c);
+        cyrillic = cyrillic && isCyrillic(c);
+        latin = latin && isLatin(c);
+    }
+
+    if (isStopWord(toUtf8(word))) {
+        return "";
+    }
+
+    if (!stemming_) {
+        return toUtf8(word);
+    }
+
+    if (cyrillic) {
+        return toUtf8(ruStemmer_.stem(word));
+    }
+    if (latin) {
+        return enStemmer_.stem(std::string(word.begin(), word.end()));
+    }
+
+    return toUtf8(word);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+#include "stemmer.h"
+
+/**
+* @brief Параметры анализатора текста.
+*/
+struct AnalyzerConfig {
+    bool stemming = true; //!< Приводить слова к основе.
+    std::string stopWordsRuPath; //!< Путь к файлу стоп-слов русского языка.
+    std::string stopWordsEnPath; //!< Путь к файлу стоп-слов английского языка.
+};
+
+/**
+* @brief Нормализованное слово вместе с его позицией в тексте.
+*/
+struct Token {
+    std::string term; //!< Основа слова.
+    uint32_t position; //!< Номер слова в тексте с учетом отброшенных стоп-слов.
+    std::string surface; //!< Слово в нижнем регистре до приведения к основе.
+};
+
+/**
+* @brief Анализатор текста.
+* @details Разбивает текст на слова, отбрасывает стоп-слова и приводит слова к основе.
+* Используется как при индексации страниц, так и при разборе поискового запроса, чтобы
+* слова запроса и слова индекса имели одинаковую форму.
+*/
+class Analyzer {
+public:
+    /**
+    * @brief Конструктор по умолчанию. Стемминг включен, список стоп-слов пуст.
+    */
+    Analyzer();
+
+    /**
+    * @brief Конструктор.
+    * @param config Параметры анализатора.
+    */
+    explicit Analyzer(const AnalyzerConfig &config);
+
+    /**
+    * @brief Разбить текст на нормализованные слова.
+    * @param text Текст.
+    * @return Нормализованные слова в порядке следования в тексте.
+    */
+    std::vector<std::string> analyze(const std::string &text) const;
+
+    /**
+    * @brief Разбить текст на нормализованные слова с позициями.
+    * @details Стоп-слова не попадают в результат, но занимают позицию, поэтому расстояние
+    * между словами совпадает с расстоянием в исходном тексте.
+    * @param text Текст.
+    * @return Нормализованные слова с позициями в порядке следования в тексте.
+    */
+    std::vector<Token> tokenize(const std::string &text) const;
+
+    /**
+    * @brief Нормализовать одно слово.
+    * @param word Слово.
+    * @return Основа слова или пустая строка, если слово является стоп-словом.
+    */
+    std::string normalize(const std::string &word) const;
+
+    /**
+    * @brief Нормализовать начало последнего слова текста для автодополнения.
+    * @details Приводит к нижнему регистру, но не к основе и не отбрасывает стоп-слова:
+    * недописанное слово нельзя ни проверить по списку, ни отдать стеммеру.
+    * @param text Текст.
+    * @return Последнее слово текста в нижнем регистре или пустая строка.
+    */
+    std::string normalizePrefix(const std::string &text) const;
+
+    /**
+    * @brief Проверить, является ли слово стоп-словом.
+    * @param word Слово в нижнем регистре.
+    * @return true, если слово есть в списке стоп-слов.
+    */
+    bool isStopWord(const std::string &word) const;
+
+private:
+    bool stemming_; //!< Приводить слова к основе.
+    std::unordered_set<std::string> stopWords_; //!< Стоп-слова в нижнем регистре.
+    RussianStemmer ruStemmer_; //!< Стеммер русского языка.
+    EnglishStemmer enStemmer_; //!< Стеммер английского языка.
+
+    /**
+    * @brief Загрузить стоп-слова из файла.
+    * @details Одно слово на строку, строки, начинающиеся с '#', игнорируются.
+    * @param path Путь к файлу.
+    */
+    void loadStopWords(const std::string &path);
+
+    /**
+    * @brief Нормализовать слово, представленное в UTF-32.
+    * @param word Слово; слово допустимой длины приводится к нижнему регистру.
+    * @return Основа слова в UTF-8 или пустая строка для стоп-слова.
+    */
+    std::string normalizeWord(std::u32string &word) const;
+};
@@ -0,0 +1,411 @@
+#include "stemmer.h"
+
+#include <algorithm>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Русский язык
+// ---------------------------------------------------------------------------
+
+bool isRuVowel(char32_t c) {
+    return c == U'а' || c == U'е' || c == U'и' || c == U'о' || c == U'у' || c == U'ы' ||
+            c == U'э' || c == U'ю' || c == U'я';
+}
+
+bool endsWith(const std::u32string &word, const std::u32string &suffix) {
+    return word.size() >= suffix.size() &&
+            word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+* @brief Найти начало области после первого сочетания «гласная + согласная».
+* @param word Слово.
+* @param from Позиция начала поиска.
+* @return Позиция начала области или длина слова, если область пустая.
+*/
+size_t ruRegionAfter(const std::u32string &word, size_t from) {
+    for (size_t i = from + 1; i < word.size(); ++i) {
+        if (!isRuVowel(word[i]) && isRuVowel(word[i - 1])) {
+            return i + 1;
+        }
+    }
+    return word.size();
+}
+
+// ---------------------------------------------------------------------------
+// Английский язык
+// ---------------------------------------------------------------------------
+
+bool isEnVowel(char c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' || c == 'y';
+}
+
+bool endsWith(const std::string &word, const std::string &suffix) {
+    return word.size() >= suffix.size() &&
+            word.compare(word.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+size_t enRegionAfter(const std::string &word, size_t from) {
+    for (size_t i = from + 1; i < word.size(); ++i) {
+        if (!isEnVowel(word[i]) && isEnVowel(word[i - 1])) {
+            return i + 1;
+        }
+    }
+    return word.size();
+}
+
+/**
+* @brief Проверить, заканчивается ли префикс слова длины end коротким слогом.
+*/
+bool endsWithShortSyllable(const std::string &word, size_t end) {
+    if (end == 2) {
+        return isEnVowel(word[0]) && !isEnVowel(word[1]);
+    }
+    if (end >= 3) {
+        const char last = word[end - 1];
+        return !isEnVowel(word[end - 3]) && isEnVowel(word[end - 2]) && !isEnVowel(last) &&
+                last != 'w' && last != 'x' && last != 'Y';
+    }
+    return false;
+}
+
+bool containsVowel(const std::string &word, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        if (isEnVowel(word[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+* @brief Найти самый длинный суффикс из списка, которым оканчивается слово.
+* @return Индекс суффикса в списке или -1.
+*/
+int findLongestSuffix(const std::string &word, const std::vector<std::string> &suffixes) {
+    int found = -1;
+    for (size_t i = 0; i < suffixes.size(); ++i) {
+        if (endsWith(word, suffixes[i]) &&
+                (found < 0 || suffixes[i].size() > suffixes[found].size())) {
+            found = static_cast<int>(i);
+        }
+    }
+    return found;
+}
+
+void replaceSuffix(std::string &word, size_t suffixLength, const std::string &replacement) {
+    word.replace(word.size() - suffixLength, suffixLength, replacement);
+}
+
+bool isValidLiEnding(char c) {
+    return c == 'c' || c == 'd' || c == 'e' || c == 'g' || c == 'h' || c == 'k' || c == 'm' ||
+            c == 'n' || c == 'r' || c == 't';
+}
+
+bool isDouble(const std::string &word) {
+    static const std::vector<std::string> doubles = {
+            "bb", "dd", "ff", "gg", "mm", "nn", "pp", "rr", "tt"};
+    return findLongestSuffix(word, doubles) >= 0;
+}
+
+} // namespace
+
+std::u32string RussianStemmer::stem(const std::u32string &source) const {
+    static const std::vector<SuffixRule> perfectiveGerund = {
+            {U"в", true}, {U"вши", true}, {U"вшись", true},
+            {U"ив", false}, {U"ивши", false}, {U"ившись", false},
+            {U"ыв", false}, {U"ывши", false}, {U"ывшись", false}};
+    static const std::vector<SuffixRule> reflexive = {{U"ся", false}, {U"сь", false}};
+    static const std::vector<SuffixRule> adjective = {
+            {U"ее", false}, {U"ие", false}, {U"ые", false}, {U"ое", false}, {U"ими", false},
+            {U"ыми", false}, {U"ей", false}, {U"ий", false}, {U"ый", false}, {U"ой", false},
+            {U"ем", false}, {U"им", false}, {U"ым", false}, {U"ом", false}, {U"его", false},
+            {U"ого", false}, {U"ему", false}, {U"ому", false}, {U"их", false}, {U"ых", false},
+            {U"ую", false}, {U"юю", false}, {U"ая", false}, {U"яя", false}, {U"ою", false},
+            {U"ею", false}};
+    static const std::vector<SuffixRule> participle = {
+            {U"ем", true}, {U"нн", true}, {U"вш", true}, {U"ющ", true}, {U"щ", true},
+            {U"ивш", false}, {U"ывш", false}, {U"ующ", false}};
+    static const std::vector<SuffixRule> verb = {
+            {U"ла", true}, {U"на", true}, {U"ете", true}, {U"йте", true}, {U"ли", true},
+            {U"й", true}, {U"л", true}, {U"ем", true}, {U"н", true}, {U"ло", true},
+            {U"но", true}, {U"ет", true}, {U"ют", true}, {U"ны", true}, {U"ть", true},
+            {U"ешь", true}, {U"нно", true},
+            {U"ила", false}, {U"ыла", false}, {U"ена", false}, {U"ейте", false},
+            {U"уйте", false}, {U"ите", false}, {U"или", false}, {U"ыли", false}, {U"ей", false},
+            {U"уй", false}, {U"ил", false}, {U"ыл", false}, {U"им", false}, {U"ым", false},
+            {U"ен", false}, {U"ило", false}, {U"ыло", false}, {U"ено", false}, {U"ят", false},
+            {U"ует", false}, {U"уют", false}, {U"ит", false}, {U"ыт", false}, {U"ены", false},
+            {U"ить", false}, {U"ыть", false}, {U"ишь", false}, {U"ую", false}, {U"ю", false}};
+    static const std::vector<SuffixRule> noun = {
+            {U"а", false}, {U"ев", false}, {U"ов", false}, {U"ие", false}, {U"ье", false},
+            {U"е", false}, {U"иями", false}, {U"ями", false}, {U"ами", false}, {U"еи", false},
+            {U"ии", false}, {U"и", false}, {U"ией", false}, {U"ей", false}, {U"ой", false},
+            {U"ий", false}, {U"й", false}, {U"иям", false}, {U"ям", false}, {U"ием", false},
+            {U"ем", false}, {U"ам", false}, {U"ом", false}, {U"о", false}, {U"у", false},
+            {U"ах", false}, {U"иях", false}, {U"ях", false}, {U"ы", false}, {U"ь", false},
+            {U"ию", false}, {U"ью", false}, {U"ю", false}, {U"ия", false}, {U"ья", false},
+            {U"я", false}};
+    static const std::vector<SuffixRule> superlative = {{U"ейш", false}, {U"ейше", false}};
+    static const std::vector<SuffixRule> derivational = {{U"ост", false}, {U"ость", false}};
+
+    std::u32string word = source;
+    std::replace(word.begin(), word.end(), U'ё', U'е');
+
+    size_t rv = word.size();
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (isRuVowel(word[i])) {
+            rv = i + 1;
+            break;
+        }
+    }
+    const size_t r1 = ruRegionAfter(word, 0);
+    const size_t r2 = ruRegionAfter(word, r1);
+
+    // Шаг 1.
+    if (!removeLongest(word, rv, perfectiveGerund)) {
+        removeLongest(word, rv, reflexive);
+        if (removeLongest(word, rv, adjective)) {
+            removeLongest(word, rv, participle);
+        } else if (!removeLongest(word, rv, verb)) {
+            removeLongest(word, rv, noun);
+        }
+    }
+
+    // Шаг 2.
+    if (word.size() > rv && word.back() == U'и') {
+        word.pop_back();
+    }
+
+    // Шаг 3.
+    removeLongest(word, std::max(r2, rv), derivational);
+
+    // Шаг 4.
+    if (removeLongest(word, rv, superlative) || endsWith(word, U"нн")) {
+        if (endsWith(word, U"нн") && word.size() - 1 > rv) {
+            word.pop_back();
+        }
+    } else if (word.size() > rv && word.back() == U'ь') {
+        word.pop_back();
+    }
+
+    return word;
+}
+
+bool RussianStemmer::removeLongest(std::u32string &word, size_t limit,
+        const std::vector<SuffixRule> &rules) const {
+    const SuffixRule *found = nullptr;
+    for (const auto &rule : rules) {
+        if (endsWith(word, rule.suffix) && word.size() - rule.suffix.size() >= limit &&
+                (!found || rule.suffix.size() > found->suffix.size())) {
+            found = &rule;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    const size_t start = word.size() - found->suffix.size();
+    if (found->afterAYa) {
+        if (start == 0 || start - 1 < limit || (word[start - 1] != U'а' && word[start - 1] != U'я')) {
+            return false;
+        }
+    }
+
+    word.erase(start);
+    return true;
+}
+
+std::string EnglishStemmer::stem(const std::string &source) const {
+    static const std::vector<std::pair<std::string, std::string> > exceptions = {
+            {"skis", "ski"}, {"skies", "sky"}, {"dying", "die"}, {"lying", "lie"},
+            {"tying", "tie"}, {"idly", "idl"}, {"gently", "gentl"}, {"ugly", "ugli"},
+            {"early", "earli"}, {"only", "onli"}, {"singly", "singl"}, {"sky", "sky"},
+            {"news", "news"}, {"howe", "howe"}, {"atlas", "atlas"}, {"cosmos", "cosmos"},
+            {"bias", "bias"}, {"andes", "andes"}};
+    static const std::vector<std::string> invariantAfterStep1a = {
+            "inning", "outing", "canning", "herring", "earring", "proceed", "exceed",
+            "succeed"};
+
+    std::string word = source;
+    if (!word.empty() && word[0] == '\'') {
+        word.erase(0, 1);
+    }
+
+    for (const auto &exception : exceptions) {
+        if (word == exception.first) {
+            return exception.second;
+        }
+    }
+
+    if (word.size() <= 2) {
+        return word;
+    }
+
+    // Помечаем согласную «y».
+    if (word[0] == 'y') {
+        word[0] = 'Y';
+    }
+    for (size_t i = 1; i < word.size(); ++i) {
+        if (word[i] == 'y' && isEnVowel(word[i - 1])) {
+            word[i] = 'Y';
+        }
+    }
+
+    size_t r1 = word.size();
+    if (word.compare(0, 5, "gener") == 0 || word.compare(0, 5, "arsen") == 0) {
+        r1 = 5;
+    } else if (word.compare(0, 6, "commun") == 0) {
+        r1 = 6;
+    } else {
+        r1 = enRegionAfter(word, 0);
+    }
+    const size_t r2 = enRegionAfter(word, r1);
+
+    auto inR1 = [&word, r1](size_t suffixLength) { return word.size() - suffixLength >= r1; };
+    auto inR2 = [&word, r2](size_t suffixLength) { return word.size() - suffixLength >= r2; };
+
+    // Шаг 0.
+    {
+        static const std::vector<std::string> suffixes = {"'s'", "'s", "'"};
+        int index = findLongestSuffix(word, suffixes);
+        if (index >= 0) {
+            word.erase(word.size() - suffixes[index].size());
+        }
+    }
+
+    // Шаг 1a.
+    {
+        static const std::vector<std::string> suffixes = {"sses", "ied", "ies", "us", "ss", "s"};
+        int index = findLongestSuffix(word, suffixes);
+        const std::string suffix = index >= 0 ? suffixes[index] : "";
+        if (suffix == "sses") {
+            replaceSuffix(word, 4, "ss");
+        } else if (suffix == "ied" || suffix == "ies") {
+            replaceSuffix(word, 3, word.size() > 4 ? "i" : "ie");
+        } else if (suffix == "s") {
+            if (word.size() >= 3 && containsVowel(word, 0, word.size() - 2)) {
+                word.pop_back();
+            }
+        }
+    }
+
+    for (const auto &invariant : invariantAfterStep1a) {
+        if (word == invariant) {
+            return word;
+        }
+    }
+
+    // Шаг 1b.
+    {
+        static const std::vector<std::string> suffixes = {
+                "eed", "eedly", "ed", "edly", "ing", "ingly"};
+        int index = findLongestSuffix(word, suffixes);
+        const std::string suffix = index >= 0 ? suffixes[index] : "";
+        if (suffix == "eed" || suffix == "eedly") {
+            if (inR1(suffix.size())) {
+                replaceSuffix(word, suffix.size(), "ee");
+            }
+        } else if (!suffix.empty() && containsVowel(word, 0, word.size() - suffix.size())) {
+            word.erase(word.size() - suffix.size());
+            if (endsWith(word, "at") || endsWith(word, "bl") || endsWith(word, "iz")) {
+                word += 'e';
+            } else if (isDouble(word)) {
+                word.pop_back();
+            } else if (r1 >= word.size() && endsWithShortSyllable(word, word.size())) {
+                word += 'e';
+            }
+        }
+    }
+
+    // Шаг 1c.
+    if (word.size() > 2 && (word.back() == 'y' || word.back() == 'Y') &&
+            !isEnVowel(word[word.size() - 2])) {
+        word.back() = 'i';
+    }
+
+    // Шаг 2.
+    {
+        static const std::vector<std::pair<std::string, std::string> > rules = {
+                {"tional", "tion"}, {"enci", "ence"}, {"anci", "ance"}, {"abli", "able"},
+                {"entli", "ent"}, {"izer", "ize"}, {"ization", "ize"}, {"ational", "ate"},
+                {"ation", "ate"}, {"ator", "ate"}, {"alism", "al"}, {"aliti", "al"},
+                {"alli", "al"}, {"fulness", "ful"}, {"ousli", "ous"}, {"ousness", "ous"},
+                {"iveness", "ive"}, {"iviti", "ive"}, {"biliti", "ble"}, {"bli", "ble"},
+                {"ogi", "og"}, {"fulli", "ful"}, {"lessli", "less"}, {"li", ""}};
+        const std::pair<std::string, std::string> *found = nullptr;
+        for (const auto &rule : rules) {
+            if (endsWith(word, rule.first) && (!found || rule.first.size() > found->first.size())) {
+                found = &rule;
+            }
+        }
+        if (found && inR1(found->first.size())) {
+            const size_t length = found->first.size();
+            const char preceding = word.size() > length ? word[word.size() - length - 1] : '\0';
+            if (found->first == "ogi") {
+                if (preceding == 'l') {
+                    replaceSuffix(word, length, found->second);
+                }
+            } else if (found->first == "li") {
+                if (isValidLiEnding(preceding)) {
+                    replaceSuffix(word, length, found->second);
+                }
+            } else {
+                replaceSuffix(word, length, found->second);
+            }
+        }
+    }
+
+    // Шаг 3.
+    {
+        static const std::vector<std::pair<std::string, std::string> > rules = {
+                {"tional", "tion"}, {"ational", "ate"}, {"alize", "al"}, {"icate", "ic"},
+                {"iciti", "ic"}, {"ical", "ic"}, {"ful", ""}, {"ness", ""}, {"ative", ""}};
+        const std::pair<std::string, std::string> *found = nullptr;
+        for (const auto &rule : rules) {
+            if (endsWith(word, rule.first) && (!found || rule.first.size() > found->first.size())) {
+                found = &rule;
+            }
+        }
+        if (found && inR1(found->first.size())) {
+            if (found->first != "ative" || inR2(found->first.size())) {
+                replaceSuffix(word, found->first.size(), found->second);
+            }
+        }
+    }
+
+    // Шаг 4.
+    {
+        static const std::vector<std::string> suffixes = {
+                "al", "ance", "ence", "er", "ic", "able", "ible", "ant", "ement", "ment",
+                "ent", "ism", "ate", "iti", "ous", "ive", "ize", "ion"};
+        int index = findLongestSuffix(word, suffixes);
+        if (index >= 0 && inR2(suffixes[index].size())) {
+            const size_t length = suffixes[index].size();
+            if (suffixes[index] != "ion") {
+                word.erase(word.size() - length);
+            } else if (word.size() > length) {
+                const char preceding = word[word.size() - length - 1];
+                if (preceding == 's' || preceding == 't') {
+                    word.erase(word.size() - length);
+                }
+            }
+        }
+    }
+
+    // Шаг 5.
+    if (!word.empty() && word.back() == 'e') {
+        if (inR2(1) || (inR1(1) && !endsWithShortSyllable(word, word.size() - 1))) {
+            word.pop_back();
+        }
+    } else if (!word.empty() && word.back() == 'l') {
+        if (inR2(1) && word.size() >= 2 && word[word.size() - 2] == 'l') {
+            word.pop_back();
+        }
+    }
+
+    std::replace(word.begin(), word.end(), 'Y', 'y');
+    return word;
+}
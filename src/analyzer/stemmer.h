@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+* @brief Стеммер русского языка.
+* @details Реализация алгоритма Snowball для русского языка. Работает со словом,
+* переведенным в нижний регистр и представленным в UTF-32.
+*/
+class RussianStemmer {
+public:
+    /**
+    * @brief Получить основу слова.
+    * @param word Слово в нижнем регистре.
+    * @return Основа слова.
+    */
+    std::u32string stem(const std::u32string &word) const;
+
+private:
+    /**
+    * @brief Правило отсечения окончания.
+    */
+    struct SuffixRule {
+        std::u32string suffix; //!< Окончание.
+        bool afterAYa; //!< Окончание отсекается только после букв «а» или «я».
+    };
+
+    /**
+    * @brief Отсечь самое длинное из подходящих окончаний.
+    * @param word Слово.
+    * @param limit Начало области, в которой должно находиться окончание.
+    * @param rules Правила отсечения.
+    * @return true, если окончание было отсечено.
+    */
+    bool removeLongest(std::u32string &word, size_t limit,
+            const std::vector<SuffixRule> &rules) const;
+};
+
+/**
+* @brief Стеммер английского языка.
+* @details Реализация алгоритма Snowball (Porter2) для английского языка. Работает со
+* словом в нижнем регистре, состоящим из латинских букв.
+*/
+class EnglishStemmer {
+public:
+    /**
+    * @brief Получить основу слова.
+    * @param word Слово в нижнем регистре.
+    * @return Основа слова.
+    */
+    std::string stem(const std::string &word) const;
+};
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+#include "../database_manager/database_manager.h"
+
+/**
+* @brief Параметры нагрузочного теста.
+*/
+struct BenchmarkConfig {
+    std::string dbConnectionString; //!< Строка подключения к отдельной тестовой БД.
+    size_t pages = 2000; //!< Число синтетических страниц.
+    size_t batchPages = 64; //!< Число страниц в пакете записи.
+    size_t wordsPerPage = 300; //!< Число различных слов на странице.
+    size_t vocabulary = 20000; //!< Размер словаря.
+    size_t queries = 500; //!< Число поисковых запросов.
+};
+
+/**
+* @brief Режим работы DatabaseManager.
+*/
+struct BenchmarkMode {
+    std::string name; //!< Название режима.
+    bool preparedStatements; //!< Использовать подготовленные запросы.
+    bool pipelining; //!< Отправлять независимые запросы конвейером.
+    DatabaseSchema schema; //!< Схема хранения индекса.
+};
+
+/**
+* @brief Результат прогона одного режима.
+*/
+struct BenchmarkResult {
+    double writeSeconds = 0; //!< Время записи всех страниц, с.
+    double searchSeconds = 0; //!< Время выполнения всех запросов, с.
+};
+
+/**
+* @brief Загрузить параметры теста из файла конфигурации.
+* @details Тест очищает БД, поэтому подключается к БД из Benchmark.dbname, а не к рабочей.
+* @param config Структура для записи.
+* @throw std::invalid_argument Параметры, с которыми тест не завершится.
+*/
+void readConfig(BenchmarkConfig &config) {
+    boost::property_tree::ptree pt;
+
+    try {
+        boost::property_tree::read_ini("../resources/config.ini", pt);
+
+        config.dbConnectionString = "host=" + pt.get<std::string>("Database.host");
+        config.dbConnectionString += " port=" + pt.get<std::string>("Database.port");
+        config.dbConnectionString +=
+                " dbname=" + pt.get<std::string>("Benchmark.dbname", "browser_bench");
+        config.dbConnectionString += " user=" + pt.get<std::string>("Database.user");
+        config.dbConnectionString += " password=" + pt.get<std::string>("Database.password");
+
+        config.pages = pt.get<size_t>("Benchmark.pages", 2000);
+        config.batchPages = pt.get<size_t>("Benchmark.batchPages", 64);
+        config.wordsPerPage = pt.get<size_t>("Benchmark.wordsPerPage", 300);
+        config.vocabulary = pt.get<size_t>("Benchmark.vocabulary", 20000);
+        config.queries = pt.get<size_t>("Benchmark.queries", 500);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    if (config.batchPages == 0) {
+        throw std::invalid_argument("Benchmark.batchPages must be positive");
+    }
+    // Слова страницы различны, поэтому их не может быть больше, чем слов в словаре.
+    if (config.vocabulary == 0 || config.vocabulary < config.wordsPerPage) {
+        throw std::invalid_argument("Benchmark.vocabulary must be positive and not less than "
+                "Benchmark.wordsPerPage");
+    }
+    if (config.queries == 0) {
+        throw std::invalid_argument("Benchmark.queries must be positive");
+    }
+}
+
+/**
+* @brief Сгенерировать синтетические страницы.
+* @details Частоты слов распределены по закону Ципфа, как в текстах на естественном языке.
+* @param config Параметры теста.
+* @param pages Контейнер для записи страниц.
+*/
+void generatePages(const BenchmarkConfig &config, std::vector<PageTerms> &pages) {
+    std::mt19937 random(42);
+    std::vector<double> weights(config.vocabulary);
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<size_t> word(weights.begin(), weights.end());
+
+    pages.resize(config.pages);
+    for (size_t i = 0; i < pages.size(); ++i) {
+        pages[i].requestConfig.host = "bench.local";
+        pages[i].requestConfig.port = "80";
+        pages[i].requestConfig.target = "/page/" + std::to_string(i);
+
+        uint32_t position = 0;
+        while (pages[i].terms.size() < config.wordsPerPage) {
+            TermEntry &entry = pages[i].terms["term" + std::to_string(word(random))];
+            entry.count++;
+            entry.impact++;
+            entry.positions.push_back(position++);
+        }
+    }
+}
+
+/**
+* @brief Прогнать запись и поиск в одном режиме.
+* @param dbManager Объект взаимодействия с БД.
+* @param config Параметры теста.
+* @param mode Режим.
+* @param pages Страницы.
+* @return Время записи и поиска.
+*/
+BenchmarkResult runMode(DatabaseManager &dbManager, const BenchmarkConfig &config,
+        const BenchmarkMode &mode, const std::vector<PageTerms> &pages) {
+    typedef std::chrono::steady_clock Clock;
+    BenchmarkResult result;
+
+    dbManager.setPreparedStatements(mode.preparedStatements);
+    dbManager.setPipelining(mode.pipelining);
+    dbManager.setSchema(mode.schema);
+    dbManager.clearDatabase();
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < pages.size(); i += config.batchPages) {
+        const size_t end = std::min(pages.size(), i + config.batchPages);
+        dbManager.writeBatch(std::vector<PageTerms>(pages.begin() + i, pages.begin() + end));
+    }
+    // Упорядочивание таблиц и сбор статистики входят во время индексации любого режима.
+    dbManager.clusterPostings();
+    result.writeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<size_t> word(0, std::min<size_t>(config.vocabulary, 1000) - 1);
+    std::uniform_int_distribution<size_t> length(1, 4);
+    start = Clock::now();
+    for (size_t i = 0; i < config.queries; ++i) {
+        std::vector<std::string> words(length(random));
+        for (auto &val : words) {
+            val = "term" + std::to_string(word(random));
+        }
+        SearchResults results;
+        dbManager.searchWords(results, words);
+    }
+    result.searchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    return result;
+}
+
+int main() {
+    try {
+        BenchmarkConfig config;
+        readConfig(config);
+
+        DatabaseManager dbManager(config.dbConnectionString, 1);
+        dbManager.createTables();
+
+        std::vector<PageTerms> pages;
+        generatePages(config, pages);
+
+        const std::vector<BenchmarkMode> modes = {
+            {"text", false, false, SCHEMA_POSTINGS},
+            {"prepared", true, false, SCHEMA_POSTINGS},
+            {"pipeline", false, true, SCHEMA_POSTINGS},
+            {"prepared+pipeline", true, true, SCHEMA_POSTINGS},
+            {"fulltext (tsvector+GIN)", true, true, SCHEMA_FULLTEXT},
+        };
+        std::vector<BenchmarkResult> results;
+        for (const auto &mode : modes) {
+            results.push_back(runMode(dbManager, config, mode, pages));
+        }
+
+        std::cout << std::endl
+                  << "pages: " << config.pages << ", batch: " << config.batchPages
+                  << ", queries: " << config.queries << std::endl;
+        for (size_t i = 0; i < modes.size(); ++i) {
+            std::cout << modes[i].name << ": write "
+                      << config.pages / results[i].writeSeconds << " pages/s, search "
+                      << results[i].searchSeconds * 1000 / config.queries << " ms/query"
+                      << std::endl;
+        }
+
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
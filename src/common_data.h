@@ -1,6 +1,12 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <string>
+#include <vector>
 
 /**
 * @brief Параметры запроса HTML страницы.
@@ -10,3 +16,101 @@ struct RequestConfig {
     std::string port; //!< Порт.
     std::string target; //!< Таргет.
 };
+
+/**
+* @brief Поле документа.
+*/
+enum DocumentField {
+    FIELD_TITLE = 0, //!< Заголовок страницы (<title>).
+    FIELD_HEADING, //!< Заголовки разделов (<h1>-<h3>).
+    FIELD_BODY, //!< Весь текст страницы.
+    FIELD_ANCHOR, //!< Текст входящих ссылок на страницу.
+    FIELD_COUNT //!< Число полей.
+};
+
+/**
+* @brief Веса полей документа при расчете релевантности.
+*/
+struct FieldBoosts {
+    int title = 5; //!< Вес заголовка страницы.
+    int heading = 3; //!< Вес заголовков разделов.
+    int body = 1; //!< Вес текста страницы.
+    int anchor = 4; //!< Вес текста входящих ссылок.
+
+    /**
+    * @brief Получить вес поля.
+    * @param field Поле.
+    * @return Вес поля.
+    */
+    int get(DocumentField field) const {
+        switch (field) {
+            case FIELD_TITLE:
+                return title;
+            case FIELD_HEADING:
+                return heading;
+            case FIELD_BODY:
+                return body;
+            case FIELD_ANCHOR:
+                return anchor;
+            default:
+                return 0;
+        }
+    }
+};
+
+/**
+* @brief Данные слова в пределах одной страницы.
+*/
+struct TermEntry {
+    int count = 0; //!< Число вхождений слова в текст страницы.
+    std::array<int, FIELD_COUNT> fieldCounts {}; //!< Число вхождений слова в каждое поле.
+    int impact = 0; //!< Вклад слова в релевантность страницы с учетом весов полей.
+    std::vector<uint32_t> positions; //!< Позиции вхождений слова по возрастанию.
+    std::string surface; //!< Самая частая в тексте форма слова до приведения к основе.
+};
+
+//! Тип хранилища слов страницы. Используется индексатором и классом БД.
+typedef std::map<std::string, TermEntry> TermStorage;
+
+//! Обработчик слова словаря: слово, его самая частая форма до приведения к основе и
+//! документная частота.
+typedef std::function<void(const std::string &, const std::string &, uint64_t)> TermConsumer;
+
+/**
+* @brief Страница, найденная поиском.
+*/
+struct SearchResult {
+    int score; //!< Релевантность.
+    std::string url; //!< URL страницы.
+};
+
+//! Найденные страницы по убыванию релевантности. Страницы с равной релевантностью
+//! сохраняются все, в порядке их поступления.
+typedef std::vector<SearchResult> SearchResults;
+
+/**
+* @brief Тип узла дерева поискового запроса.
+*/
+enum QueryNodeType {
+    QUERY_TERM = 0, //!< Слово.
+    QUERY_PHRASE, //!< Фраза: слова на заданных расстояниях друг от друга.
+    QUERY_SITE, //!< Страницы сайта: хост или его поддомены.
+    QUERY_AND, //!< Все дочерние узлы.
+    QUERY_OR, //!< Хотя бы один дочерний узел.
+    QUERY_NOT //!< Исключение страниц, на которых совпал единственный дочерний узел.
+};
+
+/**
+* @brief Узел дерева поискового запроса.
+* @details Узел NOT встречается только среди дочерних узлов AND, у которого есть хотя бы
+* один узел без NOT: исключаются страницы из найденных остальными узлами.
+*/
+struct QueryNode {
+    QueryNodeType type = QUERY_TERM; //!< Тип узла.
+    std::string value; //!< Нормализованное слово (TERM) или хост в нижнем регистре (SITE).
+    std::vector<std::string> words; //!< Нормализованные слова фразы (PHRASE).
+    //! Слова в нижнем регистре до приведения к основе: одно для TERM, по слову фразы для PHRASE.
+    std::vector<std::string> surfaces;
+    std::vector<uint32_t> offsets; //!< Смещения слов фразы от ее начала (PHRASE).
+    std::vector<QueryNode> children; //!< Дочерние узлы (AND, OR, NOT).
+};
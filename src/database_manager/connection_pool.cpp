@@ -0,0 +1,146 @@
+#include "connection_pool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+ConnectionPool::Lease::Lease(ConnectionPool &pool, Slot &&slot) :
+pool_(&pool),
+slot_(std::move(slot)) {
+}
+
+ConnectionPool::Lease::Lease(Lease &&other) noexcept :
+pool_(other.pool_),
+slot_(std::move(other.slot_)) {
+    other.pool_ = nullptr;
+}
+
+ConnectionPool::Lease::~Lease() {
+    if (pool_) {
+        pool_->release(std::move(slot_));
+    }
+}
+
+pqxx::connection &ConnectionPool::Lease::operator*() const {
+    return *slot_.connection;
+}
+
+pqxx::connection *ConnectionPool::Lease::operator->() const {
+    return slot_.connection.get();
+}
+
+const std::string &ConnectionPool::Lease::prepare(const std::string &name) {
+    const std::string sql = pool_->statement(name);
+    const auto it = slot_.prepared.find(name);
+    if (it != slot_.prepared.end() && it->second == sql) {
+        return name;
+    }
+
+    // Запрос перерегистрирован с новым текстом: старая версия на подключении устарела.
+    if (it != slot_.prepared.end()) {
+        slot_.connection->unprepare(name);
+    }
+    slot_.connection->prepare(name, sql);
+    slot_.prepared[name] = sql;
+    return name;
+}
+
+ConnectionPool::ConnectionPool(const std::string &connectionString, size_t size,
+        int healthCheckIntervalMs) :
+connectionString_(connectionString),
+size_(std::max<size_t>(size, 1)),
+healthCheckInterval_(healthCheckIntervalMs),
+mutex_(),
+condition_(),
+idle_(),
+leased_(0),
+statements_() {
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < size_; ++i) {
+        std::unique_ptr<pqxx::connection> connection = connect();
+        if (!connection->is_open()) {
+            throw std::runtime_error("ConnectionPool::ConnectionPool: Error connect");
+        }
+        idle_.push_back(Slot {std::move(connection), {}, now});
+    }
+
+    std::cout << "ConnectionPool::ConnectionPool: opened " << size_ << " connections"
+              << std::endl;
+}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+    Slot idle;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() { return leased_ < size_; });
+        ++leased_;
+        if (!idle_.empty()) {
+            idle = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+
+    try {
+        const auto now = std::chrono::steady_clock::now();
+        if (idle.connection && now - idle.lastUsed >= healthCheckInterval_ &&
+                !isAlive(*idle.connection)) {
+            std::cerr << "ConnectionPool::acquire: Error: stale connection, reconnecting"
+                      << std::endl;
+            idle.connection.reset();
+        }
+        if (!idle.connection || !idle.connection->is_open()) {
+            idle.connection = connect();
+            idle.prepared.clear();
+        }
+    } catch (...) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            --leased_;
+        }
+        condition_.notify_one();
+        throw;
+    }
+
+    return Lease(*this, std::move(idle));
+}
+
+size_t ConnectionPool::size() const {
+    return size_;
+}
+
+void ConnectionPool::registerStatement(const std::string &name, const std::string &sql) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    statements_[name] = sql;
+}
+
+std::string ConnectionPool::statement(const std::string &name) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return statements_.at(name);
+}
+
+std::unique_ptr<pqxx::connection> ConnectionPool::connect() const {
+    return std::make_unique<pqxx::connection>(connectionString_);
+}
+
+bool ConnectionPool::isAlive(pqxx::connection &connection) {
+    try {
+        pqxx::nontransaction ntx(connection);
+        ntx.exec("SELECT 1");
+        return true;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+void ConnectionPool::release(Slot &&slot) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        --leased_;
+        // Закрытое подключение не возвращается: при следующей выдаче откроется новое.
+        if (slot.connection && slot.connection->is_open()) {
+            slot.lastUsed = std::chrono::steady_clock::now();
+            idle_.push_back(std::move(slot));
+        }
+    }
+    condition_.notify_one();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+* @brief Пул подключений к БД PostgreSql.
+* @details Потокобезопасен. Подключение выдается во временное владение (Lease) и
+* возвращается в пул при уничтожении Lease. Закрытые подключения отбрасываются и
+* переоткрываются при следующей выдаче, а подключение, простоявшее дольше интервала
+* проверки, перед выдачей проверяется запросом SELECT 1. Пул хранит реестр подготовленных
+* запросов: каждый запрос подготавливается на подключении один раз, при первом обращении,
+* и переподготавливается, если его текст в реестре изменился.
+*/
+class ConnectionPool {
+private:
+    /**
+    * @brief Подключение пула с набором подготовленных на нем запросов.
+    */
+    struct Slot {
+        std::unique_ptr<pqxx::connection> connection; //!< Подключение.
+        //! Подготовленные на подключении запросы: имя и текст, с которым запрос подготовлен.
+        std::map<std::string, std::string> prepared;
+        std::chrono::steady_clock::time_point lastUsed; //!< Время возврата в пул.
+    };
+
+public:
+    /**
+    * @brief Подключение, выданное из пула.
+    */
+    class Lease {
+    public:
+        /**
+        * @brief Конструктор.
+        * @param pool Пул, в который подключение вернется.
+        * @param slot Подключение.
+        */
+        Lease(ConnectionPool &pool, Slot &&slot);
+
+        /**
+        * @brief Конструктор перемещения.
+        */
+        Lease(Lease &&other) noexcept;
+
+        /**
+        * @brief Деструктор. Возвращает подключение в пул.
+        */
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+
+        /**
+        * @brief Получить подключение.
+        */
+        pqxx::connection &operator*() const;
+
+        /**
+        * @brief Получить подключение.
+        */
+        pqxx::connection *operator->() const;
+
+        /**
+        * @brief Подготовить запрос из реестра пула на этом подключении, если он еще не
+        * подготовлен или подготовлен с другим текстом.
+        * @param name Имя запроса.
+        * @return Имя запроса для exec_prepared.
+        */
+        const std::string &prepare(const std::string &name);
+
+    private:
+        ConnectionPool *pool_; //!< Пул подключений.
+        Slot slot_; //!< Подключение.
+    };
+
+    /**
+    * @brief Конструктор. Открывает все подключения пула.
+    * @param connectionString Строка с параметрами подключения к БД.
+    * @param size Число подключений.
+    * @param healthCheckIntervalMs Время простоя, после которого подключение проверяется, мс.
+    */
+    ConnectionPool(const std::string &connectionString, size_t size,
+            int healthCheckIntervalMs = 30000);
+
+    /**
+    * @brief Получить подключение.
+    * @details Блокируется, пока все подключения выданы.
+    * @return Подключение во временном владении.
+    */
+    Lease acquire();
+
+    /**
+    * @brief Получить число подключений пула.
+    */
+    size_t size() const;
+
+    /**
+    * @brief Добавить запрос в реестр подготовленных запросов.
+    * @details Если запрос с таким именем уже зарегистрирован с другим текстом, подключения
+    * переподготовят его при следующем обращении.
+    * @param name Имя запроса.
+    * @param sql Текст запроса.
+    */
+    void registerStatement(const std::string &name, const std::string &sql);
+
+    /**
+    * @brief Получить текст запроса из реестра.
+    * @param name Имя запроса.
+    * @return Текст запроса. Бросает std::out_of_range, если запрос не зарегистрирован.
+    */
+    std::string statement(const std::string &name) const;
+
+private:
+    std::string connectionString_; //!< Строка с параметрами подключения к БД.
+    size_t size_; //!< Число подключений.
+    std::chrono::milliseconds healthCheckInterval_; //!< Интервал проверки подключения.
+    mutable std::mutex mutex_; //!< Мьютекс для работы со свободными подключениями и реестром.
+    std::condition_variable condition_; //!< Условие возврата подключения в пул.
+    std::vector<Slot> idle_; //!< Свободные подключения.
+    size_t leased_; //!< Число выданных подключений.
+    std::map<std::string, std::string> statements_; //!< Реестр подготовленных запросов.
+
+    /**
+    * @brief Открыть новое подключение.
+    */
+    std::unique_ptr<pqxx::connection> connect() const;
+
+    /**
+    * @brief Проверить, что подключение живо.
+    * @param connection Подключение.
+    */
+    static bool isAlive(pqxx::connection &connection);
+
+    /**
+    * @brief Вернуть подключение в пул.
+    * @param slot Подключение.
+    */
+    void release(Slot &&slot);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+* @brief Параметры очереди отложенной записи.
+*/
+struct WriteBehindConfig {
+    size_t batchPages = 64; //!< Число страниц, записываемых одной транзакцией.
+    int batchDelayMs = 500; //!< Максимальное время ожидания неполного пакета, мс.
+    size_t maxQueuedPages = 1024; //!< Число страниц в очереди, при котором push блокируется.
+    int maxRetries = 5; //!< Число повторных попыток записи пакета.
+    int retryDelayMs = 1000; //!< Задержка перед первой повторной попыткой, мс.
+    size_t writerThreads = 1; //!< Число потоков, параллельно записывающих пакеты.
+};
+
+/**
+* @brief Параметры кэша словаря в памяти поисковика.
+*/
+struct LexiconCacheConfig {
+    bool enabled = false; //!< Загружать словарь в память.
+    size_t hotTerms = 1000; //!< Число самых частых слов, списки вхождений которых в памяти.
+    double falsePositiveRate = 0.01; //!< Доля ложных срабатываний фильтра Блума словаря.
+};
@@ -1,87 +1,667 @@
 #include "database_manager.h"
+#include "../index/postings_codec.h"
+#include "../index/query_tree.h"
+#include "../utils/bm25.h"
+#include "../utils/secondary_function.h"
+#include "../utils/top_k.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <tuple>
 
 namespace {
 
-std::string makeUrlFromRequestConfig(const RequestConfig &config) {
-    std::string url;
+//! Наибольшая длина слова в символах: как у анализатора, и помещается в VARCHAR(50) словаря.
+const size_t maxWordLength = 45;
+
+/**
+* @brief Проверить, помещается ли слово в словарь БД.
+* @details Длина считается в символах UTF-8, а не в байтах: кириллическое слово занимает
+* вдвое больше байт, чем символов.
+* @param word Слово в UTF-8.
+*/
+bool storableWord(const std::string &word) {
+    const size_t length = std::count_if(word.begin(), word.end(), [](char ch) {
+        return (static_cast<unsigned char>(ch) & 0xC0) != 0x80;
+    });
+    return length <= maxWordLength;
+}
 
-    if (config.port == "443") {
-        url = "https://";
-    } else if (config.port == "80") {
-        url = "http://";
+/**
+* @brief Преобразовать список строк в литерал массива PostgreSql.
+* @param values Строки.
+* @return Литерал вида {"a","b"} с экранированными кавычками и обратной косой чертой.
+*/
+std::string toArrayLiteral(const std::vector<std::string> &values) {
+    std::string literal = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            literal += ',';
+        }
+        literal += '"';
+        for (char ch : values[i]) {
+            if (ch == '"' || ch == '\\') {
+                literal += '\\';
+            }
+            literal += ch;
+        }
+        literal += '"';
     }
-    url += config.host;
-    url += config.target;
+    literal += '}';
+    return literal;
+}
 
-    return url;
+/**
+* @brief Преобразовать список чисел в литерал массива PostgreSql.
+* @param values Числа.
+* @return Литерал вида {1,2}.
+*/
+std::string toArrayLiteral(const std::vector<int> &values) {
+    std::string literal = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            literal += ',';
+        }
+        literal += std::to_string(values[i]);
+    }
+    literal += '}';
+    return literal;
 }
 
+/**
+* @brief Заключить слово в кавычки для tsvector и tsquery.
+* @param word Слово.
+* @return Слово в одинарных кавычках с удвоенными кавычками и обратной косой чертой.
+*/
+std::string quoteLexeme(const std::string &word) {
+    std::string quoted = "'";
+    for (char ch : word) {
+        if (ch == '\'' || ch == '\\') {
+            quoted += ch;
+        }
+        quoted += ch;
+    }
+    quoted += '\'';
+    return quoted;
 }
 
-DatabaseManager::DatabaseManager(const std::string &connectionString) :
-connection_(connectionString) {
-    if (!connection_.is_open()) {
-        throw std::runtime_error("DatabaseManager::DatabaseManager: Error connect");
-    } else {
-        std::cout << "DatabaseManager::DatabaseManager: sucsessful connection" << std::endl;
+/**
+* @brief Преобразовать слова страницы в литерал tsvector.
+* @details Позиции tsvector начинаются с 1 и ограничены значением 16383, у одного слова
+* хранится не больше 256 позиций; лишние позиции отбрасываются.
+* @param terms Слова страницы.
+* @return Литерал вида 'слово':1,5 'другое':2.
+*/
+std::string toTsvectorLiteral(const TermStorage &terms) {
+    const uint32_t maxPosition = 16383;
+    const size_t maxPositions = 256;
+
+    std::string literal;
+    for (const auto &val : terms) {
+        if (!storableWord(val.first)) {
+            continue;
+        }
+        if (!literal.empty()) {
+            literal += ' ';
+        }
+        literal += quoteLexeme(val.first);
+
+        size_t written = 0;
+        for (uint32_t position : val.second.positions) {
+            if (position >= maxPosition || written == maxPositions) {
+                break;
+            }
+            literal += written == 0 ? ':' : ',';
+            literal += std::to_string(position + 1);
+            ++written;
+        }
     }
+    return literal;
 }
 
-DatabaseManager::~DatabaseManager() {
-    if (connection_.is_open()) {
-        connection_.disconnect();
+/**
+* @brief Подставить значения параметров $1..$n в текст запроса.
+* @param sql Текст запроса.
+* @param values Значения параметров, уже экранированные для SQL.
+* @return Текст запроса без параметров.
+*/
+std::string inlineParams(std::string sql, const std::vector<std::string> &values) {
+    // С конца, чтобы $1 не заменился внутри $10.
+    for (size_t i = values.size(); i > 0; --i) {
+        const std::string placeholder = "$" + std::to_string(i);
+        for (size_t pos = sql.find(placeholder); pos != std::string::npos;
+                pos = sql.find(placeholder, pos + values[i - 1].size())) {
+            sql.replace(pos, placeholder.size(), values[i - 1]);
+        }
+    }
+    return sql;
+}
+
+//! Число строк, читаемых из курсора за одно обращение к серверу.
+const int cursorStride = 256;
+
+//! Число строк словаря, читаемых из курсора за раз: строки короткие, а словарь большой.
+const int lexiconStride = 10000;
+
+/**
+* @brief Посчитать длину страницы для BM25: число слов на странице.
+* @param terms Слова страницы.
+*/
+int pageLength(const TermStorage &terms) {
+    int length = 0;
+    for (const auto &val : terms) {
+        length += val.second.count;
+    }
+    return length;
+}
+
+//! Подзапрос со статистикой коллекции для bm25Score.
+const char *const collectionStatsSql = R"(
+    (SELECT GREATEST(doc_count, 1)::float8 AS doc_count,
+        GREATEST(total_length::float8 / GREATEST(doc_count, 1), 1) AS average_length
+    FROM collection_stats) stats)";
+
+/**
+* @brief Получить SQL выражение оценки BM25 одного вхождения.
+* @details Формула и параметры совпадают с utils/bm25.h, статистика коллекции берется
+* из подзапроса collectionStatsSql, присоединенного к запросу под именем stats.
+* @param impact Столбец вклада слова.
+* @param length Столбец длины страницы.
+* @param docFreq Столбец документной частоты слова.
+*/
+std::string bm25Term(const std::string &impact, const std::string &length,
+        const std::string &docFreq) {
+    const std::string df = docFreq + "::float8";
+    const std::string k1 = std::to_string(bm25::k1);
+    const std::string b = std::to_string(bm25::b);
+    return "LN(1 + (GREATEST(stats.doc_count, " + df + ") - " + df + " + 0.5) / (" + df +
+            " + 0.5)) * " + impact + " * (" + k1 + " + 1) / (" + impact + " + " + k1 +
+            " * (1 - " + b + " + " + b + " * " + length + " / stats.average_length))";
+}
+
+/**
+* @brief Получить SQL выражение целочисленной оценки BM25, суммированной по вхождениям.
+* @param impact Столбец вклада слова.
+* @param length Столбец длины страницы.
+* @param docFreq Столбец документной частоты слова.
+*/
+std::string bm25Score(const std::string &impact, const std::string &length,
+        const std::string &docFreq) {
+    return "ROUND(SUM(" + bm25Term(impact, length, docFreq) + ") * " +
+            std::to_string(bm25::scoreScale) + ")";
+}
+
+/**
+* @brief Получить текст tsquery для фразы.
+* @details Расстояние между соседними словами фразы задается оператором <N>.
+* @param words Слова фразы.
+* @param offsets Смещения слов от начала фразы.
+*/
+std::string phraseTsquery(const std::vector<std::string> &words,
+        const std::vector<uint32_t> &offsets) {
+    std::string query;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i > 0) {
+            query += " <" + std::to_string(offsets[i] - offsets[i - 1]) + "> ";
+        }
+        query += quoteLexeme(words[i]);
+    }
+    return query;
+}
+
+/**
+* @brief Получить SQL условие на хост страницы для запроса site:.
+* @param column Столбец хоста.
+* @param site Хост сайта. Состоит только из букв, цифр, точек и дефисов.
+* @param txn Транзакция для экранирования строк.
+*/
+std::string siteCondition(const std::string &column, const std::string &site,
+        pqxx::transaction_base &txn) {
+    return "(lower(" + column + ") = " + txn.quote(site) + " OR lower(" + column + ") LIKE " +
+            txn.quote("%." + site) + ")";
+}
+
+/**
+* @brief Перевести дерево запроса в SQL условие на документ tsvector.
+* @details Слова и фразы проверяются оператором @@ по индексу GIN, узлы AND, OR и NOT
+* переходят в одноименные логические операторы SQL.
+* @param query Дерево запроса.
+* @param txn Транзакция для экранирования строк.
+*/
+std::string fullTextCondition(const QueryNode &query, pqxx::transaction_base &txn) {
+    switch (query.type) {
+        case QUERY_TERM:
+            return "t.document @@ " + txn.quote(quoteLexeme(query.value)) + "::tsquery";
+        case QUERY_PHRASE:
+            return "t.document @@ " + txn.quote(phraseTsquery(query.words, query.offsets)) +
+                    "::tsquery";
+        case QUERY_SITE:
+            return siteCondition("p.host", query.value, txn);
+        case QUERY_NOT:
+            return "NOT " + fullTextCondition(query.children.front(), txn);
+        default:
+            break;
     }
+
+    std::string condition;
+    for (const auto &child : query.children) {
+        if (!condition.empty()) {
+            condition += query.type == QUERY_AND ? " AND " : " OR ";
+        }
+        condition += fullTextCondition(child, txn);
+    }
+    return "(" + condition + ")";
+}
+
+/**
+* @brief Перевести дерево запроса в SQL запрос идентификаторов страниц-кандидатов.
+* @details Узлы AND, OR и NOT переходят в INTERSECT, UNION и EXCEPT над списками страниц
+* слов. Позиций в списках нет, поэтому фраза заменяется пересечением списков ее слов,
+* а исключение, под которым есть фраза, не применяется: кандидатов может оказаться больше,
+* чем подходящих страниц.
+* @param query Дерево запроса.
+* @param txn Транзакция для экранирования строк.
+* @param exact Сбрасывается, если кандидатов может оказаться больше.
+*/
+std::string candidatesSql(const QueryNode &query, pqxx::transaction_base &txn, bool &exact) {
+    switch (query.type) {
+        case QUERY_TERM:
+            return "SELECT po.page_id FROM postings po JOIN lexicon l ON l.id = po.word_id "
+                   "WHERE l.word = " + txn.quote(query.value);
+        case QUERY_PHRASE: {
+            exact = false;
+            std::string sql;
+            for (const auto &word : query.words) {
+                QueryNode term;
+                term.value = word;
+                sql += (sql.empty() ? "(" : " INTERSECT (") + candidatesSql(term, txn, exact) +
+                        ")";
+            }
+            return sql;
+        }
+        case QUERY_SITE:
+            return "SELECT id FROM pages WHERE " + siteCondition("host", query.value, txn);
+        default:
+            break;
+    }
+
+    std::string sql;
+    for (const auto &child : query.children) {
+        if (child.type == QUERY_NOT) {
+            continue;
+        }
+        if (!sql.empty()) {
+            sql += query.type == QUERY_AND ? " INTERSECT " : " UNION ";
+        }
+        sql += "(" + candidatesSql(child, txn, exact) + ")";
+    }
+    for (const auto &child : query.children) {
+        if (child.type != QUERY_NOT) {
+            continue;
+        }
+        bool childExact = true;
+        const std::string excluded = candidatesSql(child.children.front(), txn, childExact);
+        if (childExact) {
+            sql = "(" + sql + ") EXCEPT (" + excluded + ")";
+        } else {
+            exact = false;
+        }
+    }
+    return sql;
+}
+
+/**
+* @brief Перевести ответ полнотекстового поиска в результаты.
+* @details Ранг ts_rank_cd дробный: переводится в целую оценку с точностью 1e-4.
+* @param result Строки host, port, target, rank по убыванию ранга.
+* @param limit Число лучших страниц, 0 - без ограничения.
+* @param results Контейнер для записи URL страниц.
+*/
+void pushRankedPages(const pqxx::result &result, size_t limit, SearchResults &results) {
+    TopK<RequestConfig> top(limit);
+    for (const auto &row : result) {
+        RequestConfig requestConfig;
+        requestConfig.host = row[0].as<std::string>();
+        requestConfig.port = row[1].as<std::string>();
+        requestConfig.target = row[2].as<std::string>();
+        top.push(static_cast<int>(row[3].as<double>() * 10000), std::move(requestConfig));
+    }
+    for (auto &val : top.take()) {
+        results.push_back(SearchResult {val.first, makeUrlFromRequestConfig(val.second)});
+    }
+}
+
+//! Канал уведомлений об изменении индекса для словаря в памяти поисковика.
+const char *const indexChannel = "index_changes";
+
+} // namespace
+
+DatabaseManager::DatabaseManager(const std::string &connectionString, size_t poolSize) :
+connectionString_(connectionString),
+pool_(connectionString, poolSize),
+resultLimit_(100),
+preparedStatements_(true),
+pipelining_(true),
+schema_(SCHEMA_POSTINGS),
+postingsPartitions_(1),
+partitionsMutex_(),
+partitionsLoaded_(false),
+partitions_(),
+lexiconCache_(),
+notificationListener_() {
+    registerStatements();
+    std::cout << "DatabaseManager::DatabaseManager: sucsessful connection" << std::endl;
+}
+
+DatabaseManager::~DatabaseManager() {
+    // Поток подписки обращается к пулу и словарю, поэтому останавливается первым.
+    notificationListener_.reset();
 }
 
 void DatabaseManager::createTables() {
     try {
-        pqxx::work txn(connection_);
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
 
         txn.exec(R"(
             CREATE TABLE IF NOT EXISTS pages (
                 id SERIAL PRIMARY KEY,
                 host VARCHAR(127) NOT NULL,
                 port VARCHAR(31) NOT NULL,
-                target VARCHAR(255) NOT NULL
+                target VARCHAR(255) NOT NULL,
+                length INT NOT NULL DEFAULT 0
             )
         )");
         std::cout << "DatabaseManager::createTables: Table 'pages' created" << std::endl;
 
         txn.exec(R"(
-            CREATE TABLE IF NOT EXISTS words (
-                id_word SERIAL PRIMARY KEY,
-                word VARCHAR(50) NOT NULL,
-                word_count INT NOT NULL
+            CREATE TABLE IF NOT EXISTS lexicon (
+                id SERIAL PRIMARY KEY,
+                word VARCHAR(50) NOT NULL UNIQUE,
+                doc_freq INT NOT NULL DEFAULT 0,
+                surface VARCHAR(50)
             )
         )");
-        std::cout << "DatabaseManager::createTables: Table 'words' created" << std::endl;
+        // Форма слова для подсказок: в словарях, созданных до ее появления, остается NULL.
+        txn.exec("ALTER TABLE lexicon ADD COLUMN IF NOT EXISTS surface VARCHAR(50)");
+        std::cout << "DatabaseManager::createTables: Table 'lexicon' created" << std::endl;
 
+        // Статистика коллекции для BM25: одна строка, обновляется clusterPostings.
         txn.exec(R"(
-            CREATE TABLE IF NOT EXISTS page_words (
-                id SERIAL PRIMARY KEY,
-                page_id INT NOT NULL,
+            CREATE TABLE IF NOT EXISTS collection_stats (
+                id INT PRIMARY KEY CHECK (id = 1),
+                doc_count BIGINT NOT NULL,
+                total_length BIGINT NOT NULL
+            )
+        )");
+        txn.exec("INSERT INTO collection_stats VALUES (1, 0, 0) ON CONFLICT (id) DO NOTHING");
+        std::cout << "DatabaseManager::createTables: Table 'collection_stats' created"
+                  << std::endl;
+
+        // Первичный ключ (word_id, page_id) хранит вхождения одного слова рядом в индексе,
+        // поэтому выборка по слову читает только его список вхождений.
+        const bool partitioned = postingsPartitions_ > 1;
+        txn.exec(std::string(R"(
+            CREATE TABLE IF NOT EXISTS postings (
                 word_id INT NOT NULL,
+                page_id INT NOT NULL,
+                tf INT NOT NULL,
+                impact INT NOT NULL,
+                positions BYTEA,
+
+                PRIMARY KEY (word_id, page_id),
+                FOREIGN KEY (word_id) REFERENCES lexicon(id),
+                FOREIGN KEY (page_id) REFERENCES pages(id)
+            )
+        )") + (partitioned ? " PARTITION BY HASH (word_id)" : ""));
+
+        pqxx::result kind = txn.exec("SELECT relkind FROM pg_class "
+                                     "WHERE oid = to_regclass('postings')");
+        if (kind[0][0].as<std::string>() == "p") {
+            // Секции добавляются только к пустой таблице: при другом числе секций
+            // хеш-распределение существующих строк не совпало бы с новым.
+            for (size_t i = 0; i < postingsPartitions_; ++i) {
+                txn.exec("CREATE TABLE IF NOT EXISTS postings_p" + std::to_string(i) +
+                        " PARTITION OF postings FOR VALUES WITH (MODULUS " +
+                        std::to_string(postingsPartitions_) + ", REMAINDER " +
+                        std::to_string(i) + ")");
+            }
+        } else if (partitioned) {
+            std::cerr << "DatabaseManager::createTables: Error: table 'postings' already "
+                      << "exists without partitions, partitioning skipped" << std::endl;
+        }
+        std::cout << "DatabaseManager::createTables: Table 'postings' created" << std::endl;
 
-                FOREIGN KEY (page_id) REFERENCES pages(id),
-                FOREIGN KEY (word_id) REFERENCES words(id_word),
-                UNIQUE (page_id, word_id)
+        // Промежуточная таблица для массовой загрузки: не пишется в WAL, строки живут
+        // только до конца транзакции записи пакета.
+        txn.exec(R"(
+            CREATE UNLOGGED TABLE IF NOT EXISTS staging_postings (
+                batch_id BIGINT NOT NULL,
+                page_id INT NOT NULL,
+                word VARCHAR(50) NOT NULL,
+                tf INT NOT NULL,
+                impact INT NOT NULL,
+                positions BYTEA,
+                surface VARCHAR(50)
             )
         )");
-        std::cout << "DatabaseManager::createTables: Table 'page_words' created" << std::endl;
+        txn.exec("ALTER TABLE staging_postings ADD COLUMN IF NOT EXISTS surface VARCHAR(50)");
+        txn.exec("CREATE INDEX IF NOT EXISTS staging_postings_batch_idx "
+                 "ON staging_postings (batch_id)");
+        txn.exec("CREATE SEQUENCE IF NOT EXISTS staging_batch_seq");
+        std::cout << "DatabaseManager::createTables: Table 'staging_postings' created" << std::endl;
+
+        // Документы полнотекстового поиска: слова страницы с позициями, уже нормализованные
+        // анализатором. Документ записывается литералом tsvector, а запрос - литералом
+        // tsquery, поэтому словари PostgreSql не применяются ни к одной из сторон.
+        txn.exec(R"(
+            CREATE TABLE IF NOT EXISTS page_texts (
+                page_id INT PRIMARY KEY REFERENCES pages(id),
+                document TSVECTOR NOT NULL
+            )
+        )");
+        txn.exec("CREATE INDEX IF NOT EXISTS page_texts_document_idx "
+                 "ON page_texts USING GIN (document)");
+        std::cout << "DatabaseManager::createTables: Table 'page_texts' created" << std::endl;
+
+        migrateLegacySchema(txn);
+        migrateStatistics(txn);
 
         txn.commit();
         std::cout << "DatabaseManager::createTables: All tables created" << std::endl;
 
+        std::unique_lock<std::mutex> lock(partitionsMutex_);
+        partitionsLoaded_ = false;
+
     } catch (const std::exception &e) {
         std::cerr << "DatabaseManager::createTables: Error create tables " << e.what() << std::endl;
     }
 }
 
+void DatabaseManager::migrateLegacySchema(pqxx::work &txn) {
+    pqxx::result legacy = txn.exec("SELECT to_regclass('words') IS NOT NULL "
+                                   "AND to_regclass('page_words') IS NOT NULL");
+    if (!legacy[0][0].as<bool>()) {
+        return;
+    }
+
+    std::cout << "DatabaseManager::migrateLegacySchema: migrating 'words' and 'page_words'"
+              << std::endl;
+
+    txn.exec("ALTER TABLE words ADD COLUMN IF NOT EXISTS impact INT");
+    txn.exec("ALTER TABLE words ADD COLUMN IF NOT EXISTS positions BYTEA");
+    txn.exec(R"(
+        INSERT INTO lexicon (word)
+        SELECT DISTINCT word FROM words
+        ON CONFLICT (word) DO NOTHING
+    )");
+    txn.exec(R"(
+        INSERT INTO postings (word_id, page_id, tf, impact, positions)
+        SELECT l.id, pw.page_id, SUM(w.word_count), SUM(COALESCE(w.impact, w.word_count)),
+            (ARRAY_AGG(w.positions))[1]
+        FROM page_words pw
+        JOIN words w ON w.id_word = pw.word_id
+        JOIN lexicon l ON l.word = w.word
+        GROUP BY l.id, pw.page_id
+        ON CONFLICT (word_id, page_id) DO NOTHING
+    )");
+    txn.exec("DROP TABLE page_words");
+    txn.exec("DROP TABLE words");
+    for (const auto &table : postingsTables(txn)) {
+        txn.exec("CLUSTER " + txn.quote_name(table) + " USING " + txn.quote_name(table + "_pkey"));
+    }
+
+    std::cout << "DatabaseManager::migrateLegacySchema: migration done" << std::endl;
+}
+
+void DatabaseManager::migrateStatistics(pqxx::work &txn) {
+    pqxx::result missing = txn.exec("SELECT NOT EXISTS (SELECT 1 FROM information_schema.columns "
+                                    "WHERE table_name = 'pages' AND column_name = 'length')");
+    if (!missing[0][0].as<bool>()) {
+        return;
+    }
+
+    std::cout << "DatabaseManager::migrateStatistics: adding BM25 statistics" << std::endl;
+
+    // Длины уже проиндексированных страниц восстанавливаются по вхождениям, документные
+    // частоты и статистика коллекции - при следующем clusterPostings.
+    txn.exec("ALTER TABLE pages ADD COLUMN length INT NOT NULL DEFAULT 0");
+    txn.exec("ALTER TABLE lexicon ADD COLUMN IF NOT EXISTS doc_freq INT NOT NULL DEFAULT 0");
+    txn.exec(R"(
+        UPDATE pages p SET length = s.length
+        FROM (SELECT page_id, SUM(tf) AS length FROM postings GROUP BY page_id) s
+        WHERE p.id = s.page_id
+    )");
+}
+
+void DatabaseManager::clusterPostings() {
+    try {
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::nontransaction ntx(*connection);
+
+        // Секционированная таблица упорядочивается по секциям: CLUSTER родительской
+        // таблицы поддерживается не всеми версиями PostgreSql.
+        for (const auto &table : postingsTables(ntx)) {
+            ntx.exec("CLUSTER " + ntx.quote_name(table) + " USING " +
+                    ntx.quote_name(table + "_pkey"));
+        }
+        // Во время обхода статистика BM25 наращивается после каждого пакета (addStatistics);
+        // здесь она пересчитывается точно, в том числе после перезаписи страниц.
+        ntx.exec(R"(
+            UPDATE lexicon l SET doc_freq = s.doc_freq
+            FROM (SELECT word_id, COUNT(*) AS doc_freq FROM postings GROUP BY word_id) s
+            WHERE l.id = s.word_id AND l.doc_freq <> s.doc_freq
+        )");
+        ntx.exec(R"(
+            UPDATE collection_stats
+            SET doc_count = s.doc_count, total_length = s.total_length
+            FROM (SELECT COUNT(*) AS doc_count, COALESCE(SUM(length), 0) AS total_length
+                FROM pages) s
+        )");
+        ntx.exec_params("SELECT pg_notify($1, 'stats')", indexChannel);
+        ntx.exec("ANALYZE lexicon");
+        ntx.exec("ANALYZE postings");
+        ntx.exec("ANALYZE page_texts");
+
+        std::cout << "DatabaseManager::clusterPostings: sucsessful cluster postings" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::clusterPostings: Error: " << e.what() << std::endl;
+    }
+}
+
+std::vector<std::string> DatabaseManager::postingsTables(pqxx::transaction_base &txn) {
+    pqxx::result result = txn.exec(R"(
+        SELECT c.relname
+        FROM pg_inherits i
+        JOIN pg_class c ON c.oid = i.inhrelid
+        WHERE i.inhparent = to_regclass('postings')
+        ORDER BY c.relname
+    )");
+
+    std::vector<std::string> tables;
+    for (const auto &row : result) {
+        tables.push_back(row[0].as<std::string>());
+    }
+    if (tables.empty()) {
+        tables.push_back("postings");
+    }
+    return tables;
+}
+
+std::vector<std::string> DatabaseManager::postingsPartitions() {
+    std::unique_lock<std::mutex> lock(partitionsMutex_);
+    if (partitionsLoaded_) {
+        return partitions_;
+    }
+
+    ConnectionPool::Lease connection = pool_.acquire();
+    pqxx::work txn(*connection);
+    std::vector<std::string> tables = postingsTables(txn);
+    txn.commit();
+
+    partitions_.clear();
+    if (tables.size() > 1 || tables.front() != "postings") {
+        partitions_ = tables;
+    }
+    // Каждая ветвь UNION ALL суммирует оценки BM25 слов своей секции по страницам; слово
+    // целиком лежит в одной секции, поэтому оценки ветвей просто складываются. Ветви
+    // PostgreSQL может выполнить параллельно (Parallel Append), а лучшие страницы отбираются
+    // в БД, так что клиент получает не больше limit строк. Позиции читаются только для
+    // отобранных страниц.
+    std::string branches;
+    for (const auto &table : partitions_) {
+        if (!branches.empty()) {
+            branches += "\n            UNION ALL";
+        }
+        branches += R"(
+            SELECT po.page_id, )" + bm25Score("po.impact", "p.length", "l.doc_freq") +
+                R"(::bigint AS score, COUNT(*) AS words
+            FROM lexicon l
+            JOIN )" + txn.quote_name(table) + R"( po ON po.word_id = l.id
+            JOIN pages p ON p.id = po.page_id
+            CROSS JOIN )" + collectionStatsSql + R"(
+            WHERE l.word = ANY($1::text[])
+            GROUP BY po.page_id)";
+    }
+    if (!partitions_.empty()) {
+        pool_.registerStatement("search_partitions", R"(
+            WITH matches AS (
+                SELECT s.page_id, SUM(s.score) AS score
+                FROM ()" + branches + R"(
+                ) s
+                GROUP BY s.page_id
+                HAVING SUM(s.words) >= $2
+                ORDER BY score DESC, s.page_id
+                LIMIT NULLIF($3, 0)
+            )
+            SELECT p.host, p.port, p.target, m.score::int AS score,
+                (SELECT string_agg(array_position($1::text[], l.word::text) || ':' ||
+                        COALESCE(encode(po.positions, 'hex'), ''), ',')
+                    FROM lexicon l
+                    JOIN postings po ON po.word_id = l.id AND po.page_id = m.page_id
+                    WHERE l.word = ANY($1::text[]))
+            FROM matches m
+            JOIN pages p ON p.id = m.page_id
+            ORDER BY m.score DESC, m.page_id
+        )");
+    }
+    partitionsLoaded_ = true;
+
+    std::cout << "DatabaseManager::postingsPartitions: " << partitions_.size()
+              << " partitions" << std::endl;
+    return partitions_;
+}
+
 void DatabaseManager::clearDatabase() {
     try {
-        pqxx::work tx(connection_);
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work tx(*connection);
 
-        tx.exec("TRUNCATE TABLE page_words, pages, words RESTART IDENTITY;");
+        tx.exec("TRUNCATE TABLE staging_postings, postings, lexicon, page_texts, pages "
+                "RESTART IDENTITY;");
+        tx.exec("UPDATE collection_stats SET doc_count = 0, total_length = 0");
+        tx.exec_params("SELECT pg_notify($1, 'clear')", indexChannel);
 
         tx.commit();
         std::cout << "DatabaseManager::clearDatabase: sucsessful clear db" << std::endl;
@@ -91,102 +671,630 @@ void DatabaseManager::clearDatabase() {
 }
 
 void DatabaseManager::writeData(const RequestConfig &requestConfig,
-        const std::map<std::string, int> &storage) {
+        const TermStorage &storage) {
+    writeBatch({PageTerms {requestConfig, storage}});
+}
+
+void DatabaseManager::setPostingsPartitions(size_t partitions) {
+    postingsPartitions_ = partitions;
+}
+
+void DatabaseManager::setSchema(DatabaseSchema schema) {
+    schema_ = schema;
+}
+
+void DatabaseManager::setPreparedStatements(bool enabled) {
+    preparedStatements_ = enabled;
+}
+
+void DatabaseManager::setPipelining(bool enabled) {
+    pipelining_ = enabled;
+}
+
+void DatabaseManager::registerStatements() {
+    pool_.registerStatement("next_batch_id", "SELECT nextval('staging_batch_seq')");
+    pool_.registerStatement("insert_page", "INSERT INTO pages (host, port, target, length) "
+                                           "VALUES ($1, $2, $3, $4) RETURNING id");
+
+    // Слова сортируются, чтобы параллельные пакеты блокировали строки словаря в одном
+    // порядке и не попадали во взаимную блокировку. Форма нового слова - самая частая
+    // среди страниц пакета, в котором оно впервые встретилось.
+    pool_.registerStatement("merge_lexicon", R"(
+        INSERT INTO lexicon (word, surface)
+        SELECT word, mode() WITHIN GROUP (ORDER BY surface)
+        FROM staging_postings WHERE batch_id = $1
+        GROUP BY word
+        ORDER BY word
+        ON CONFLICT (word) DO NOTHING
+    )");
+    pool_.registerStatement("merge_postings", R"(
+        INSERT INTO postings (word_id, page_id, tf, impact, positions)
+        SELECT l.id, s.page_id, s.tf, s.impact, s.positions
+        FROM staging_postings s
+        JOIN lexicon l ON l.word = s.word
+        WHERE s.batch_id = $1
+        ON CONFLICT (word_id, page_id) DO UPDATE
+        SET tf = EXCLUDED.tf, impact = EXCLUDED.impact, positions = EXCLUDED.positions
+    )");
+    pool_.registerStatement("delete_staging", "DELETE FROM staging_postings WHERE batch_id = $1");
+    // Строки словаря блокируются по возрастанию id, чтобы параллельные пакеты не попадали
+    // во взаимную блокировку; строка статистики коллекции - после них.
+    pool_.registerStatement("add_doc_freq", R"(
+        WITH delta AS (
+            SELECT l.id, d.delta
+            FROM lexicon l
+            JOIN unnest($1::text[], $2::int[]) AS d(word, delta) ON l.word = d.word
+            ORDER BY l.id
+            FOR UPDATE OF l
+        )
+        UPDATE lexicon l SET doc_freq = l.doc_freq + delta.delta
+        FROM delta
+        WHERE l.id = delta.id
+    )");
+    pool_.registerStatement("add_collection_stats", "UPDATE collection_stats "
+            "SET doc_count = doc_count + $1, total_length = total_length + $2");
+    // Уведомление доставляется подписчикам только после фиксации транзакции.
+    pool_.registerStatement("notify_changes", "SELECT pg_notify($1, $2)");
+
+    // Один запрос на все слова: оценка BM25 и отбор лучших страниц выполняются в БД,
+    // позиции возвращаются строкой "номер слова:hex,...".
+    pool_.registerStatement("search_pages", R"(
+        SELECT p.host, p.port, p.target,
+            )" + bm25Score("po.impact", "p.length", "l.doc_freq") + R"(::int AS score,
+            string_agg(array_position($1::text[], l.word::text) || ':' ||
+                COALESCE(encode(po.positions, 'hex'), ''), ',')
+        FROM lexicon l
+        JOIN postings po ON po.word_id = l.id
+        JOIN pages p ON p.id = po.page_id
+        CROSS JOIN )" + collectionStatsSql + R"(
+        WHERE l.word = ANY($1::text[])
+        GROUP BY p.id
+        HAVING COUNT(*) >= $2
+        ORDER BY score DESC
+        LIMIT NULLIF($3, 0)
+    )");
+
+    pool_.registerStatement("search_fulltext", R"(
+        SELECT p.host, p.port, p.target, ts_rank_cd(t.document, q.query) AS rank
+        FROM (SELECT $1::tsquery) AS q(query)
+        JOIN page_texts t ON t.document @@ q.query
+        JOIN pages p ON p.id = t.page_id
+        ORDER BY rank DESC
+        LIMIT NULLIF($2, 0)
+    )");
+}
+
+void DatabaseManager::insertPages(ConnectionPool::Lease &connection, pqxx::work &txn,
+        const std::vector<PageTerms> &pages, std::vector<int> &pageIds) {
+    pageIds.reserve(pages.size());
+    if (!pipelining_) {
+        for (const auto &page : pages) {
+            pqxx::result page_result = execute(connection, txn, "insert_page",
+                    page.requestConfig.host, page.requestConfig.port, page.requestConfig.target,
+                    pageLength(page.terms));
+            pageIds.push_back(page_result[0][0].as<int>());
+        }
+        return;
+    }
+
+    // Вставки страниц независимы друг от друга: отправляем их все, не дожидаясь ответов,
+    // и только потом читаем идентификаторы. Конвейер передает запросы текстом, поэтому
+    // подготовленный запрос вызывается через EXECUTE; pqxx подготавливает запросы лениво,
+    // при первом exec_prepared, и здесь запрос регистрируется на сервере явно.
+    const bool prepared = preparedStatements_;
+    if (prepared) {
+        connection->prepare_now(connection.prepare("insert_page"));
+    }
+
+    pqxx::pipeline pipe(txn);
+    std::vector<pqxx::pipeline::query_id> queries;
+    queries.reserve(pages.size());
+    for (const auto &page : pages) {
+        const std::string values = txn.quote(page.requestConfig.host) + ", " +
+                txn.quote(page.requestConfig.port) + ", " + txn.quote(page.requestConfig.target) +
+                ", " + std::to_string(pageLength(page.terms));
+        queries.push_back(pipe.insert(prepared
+                ? "EXECUTE insert_page (" + values + ")"
+                : "INSERT INTO pages (host, port, target, length) VALUES (" + values +
+                        ") RETURNING id"));
+    }
+    for (auto query : queries) {
+        pageIds.push_back(pipe.retrieve(query)[0][0].as<int>());
+    }
+    pipe.complete();
+}
+
+bool DatabaseManager::writeBatch(const std::vector<PageTerms> &pages) {
+    if (pages.empty()) {
+        return true;
+    }
+
     try {
-        pqxx::work txn(connection_);
-
-        pqxx::result page_result =
-            txn.exec_params(
-                "INSERT INTO pages (host, port, target) VALUES ($1, $2, $3) RETURNING id",
-                requestConfig.host,
-                requestConfig.port,
-                requestConfig.target
-        );
-        int page_id = page_result[0][0].as<int>();
-
-        for (auto &val : storage) {
-            if (val.first.length() > 45) {
-                continue;
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
+
+        if (schema_ == SCHEMA_FULLTEXT) {
+            std::vector<int> pageIds;
+            insertPages(connection, txn, pages, pageIds);
+            const size_t documents = writeTexts(txn, pages, pageIds);
+
+            txn.commit();
+            std::cout << "DatabaseManager::writeBatch: " << documents << " documents written"
+                      << std::endl;
+            return true;
+        }
+
+        const long long batchId =
+                execute(connection, txn, "next_batch_id")[0][0].as<long long>();
+
+        std::vector<int> pageIds;
+        insertPages(connection, txn, pages, pageIds);
+
+        // Все слова пакета одним потоком COPY. Позиции передаются в текстовом
+        // представлении bytea (\x + hex).
+        pqxx::stream_to stream(txn, "staging_postings",
+                std::vector<std::string> {"batch_id", "page_id", "word", "tf", "impact",
+                        "positions", "surface"});
+        size_t rows = 0;
+        for (size_t i = 0; i < pages.size(); ++i) {
+            for (const auto &val : pages[i].terms) {
+                if (!storableWord(val.first)) {
+                    continue;
+                }
+
+                stream << std::make_tuple(batchId, pageIds[i], val.first, val.second.count,
+                        val.second.impact,
+                        "\\x" + toHex(encodePositions(val.second.positions)),
+                        val.second.surface.empty() ? val.first : val.second.surface);
+                ++rows;
             }
+        }
+        stream.complete();
 
-            // Добавляем слово и получаем его ID
-            pqxx::result new_word_result = txn.exec_params(
-                    "INSERT INTO words (word, word_count) VALUES ($1, $2) RETURNING id_word",
-                    val.first, val.second);
-            int word_id = new_word_result[0][0].as<int>();
+        execute(connection, txn, "merge_lexicon", batchId);
+        execute(connection, txn, "merge_postings", batchId);
+        execute(connection, txn, "delete_staging", batchId);
 
-            // Добавляем связь в связующую таблицу
-            txn.exec_params("INSERT INTO page_words (page_id, word_id) VALUES ($1, $2) "
-                            "ON CONFLICT (page_id, word_id) DO NOTHING",
-                    page_id, word_id);
+        txn.commit();
+        std::cout << "DatabaseManager::writeBatch: " << pages.size() << " pages, " << rows
+                  << " postings written" << std::endl;
+
+        addStatistics(connection, pages,
+                "batch " + std::to_string(*std::min_element(pageIds.begin(), pageIds.end())) +
+                " " + std::to_string(*std::max_element(pageIds.begin(), pageIds.end())));
+
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::writeBatch: Ошибка: " << e.what() << std::endl;
+        return false;
+    }
 
-            // std::cout << "Добавлено: Page ID: " << page_id << ", Word: " << val.first
-            //           << ", Count: " << val.second << ", Word ID: " << word_id << std::endl;
+    return true;
+}
+
+void DatabaseManager::addStatistics(ConnectionPool::Lease &connection,
+        const std::vector<PageTerms> &pages, const std::string &notification) {
+    std::map<std::string, int> docFreqs;
+    long long totalLength = 0;
+    for (const auto &page : pages) {
+        for (const auto &val : page.terms) {
+            if (storableWord(val.first)) {
+                docFreqs[val.first]++;
+            }
         }
+        totalLength += pageLength(page.terms);
+    }
 
+    std::vector<std::string> words;
+    std::vector<int> deltas;
+    for (const auto &val : docFreqs) {
+        words.push_back(val.first);
+        deltas.push_back(val.second);
+    }
+
+    // Пакет уже записан: ошибка здесь только оставляет статистику приближенной до
+    // следующего clusterPostings. Уведомление отправляется в той же транзакции, чтобы
+    // подписчики дочитывали пакет уже с обновленной статистикой.
+    try {
+        pqxx::work txn(*connection);
+        execute(connection, txn, "add_doc_freq", toArrayLiteral(words), toArrayLiteral(deltas));
+        execute(connection, txn, "add_collection_stats", static_cast<long long>(pages.size()),
+                totalLength);
+        execute(connection, txn, "notify_changes", indexChannel, notification);
         txn.commit();
-        std::cout << "DatabaseManager::writeData: Все данные для страницы " <<
-            requestConfig.host << ": " <<
-            requestConfig.port << " " <<
-            requestConfig.target << " успешно добавлены!"
-                  << std::endl;
+        return;
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::addStatistics: Error: " << e.what() << std::endl;
+    }
+
+    // Статистика не обновилась, но страницы пакета записаны: подписчики все равно должны
+    // их дочитать.
+    try {
+        pqxx::nontransaction ntx(*connection);
+        ntx.exec_params("SELECT pg_notify($1, $2)", indexChannel, notification);
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::addStatistics: Error: " << e.what() << std::endl;
+    }
+}
+
+size_t DatabaseManager::writeTexts(pqxx::work &txn, const std::vector<PageTerms> &pages,
+        const std::vector<int> &pageIds) {
+    pqxx::stream_to stream(txn, "page_texts", std::vector<std::string> {"page_id", "document"});
+    for (size_t i = 0; i < pages.size(); ++i) {
+        stream << std::make_tuple(pageIds[i], toTsvectorLiteral(pages[i].terms));
+    }
+    stream.complete();
+    return pages.size();
+}
+
+void DatabaseManager::setResultLimit(size_t limit) {
+    resultLimit_ = limit;
+}
+
+void DatabaseManager::enableLexiconCache(const LexiconCacheConfig &config,
+        std::function<void()> onChange) {
+    notificationListener_.reset();
+    lexiconCache_.reset(new LexiconCache(config));
+    notificationListener_.reset(new NotificationListener(connectionString_, indexChannel,
+            [this, onChange](const std::vector<std::string> &payloads) {
+        refreshLexiconCache(payloads);
+        if (onChange) {
+            onChange();
+        }
+    }));
+}
+
+void DatabaseManager::refreshLexiconCache(const std::vector<std::string> &payloads) {
+    bool reload = payloads.empty();
+    std::vector<std::pair<int, int> > batches;
+    for (const auto &payload : payloads) {
+        std::istringstream stream(payload);
+        std::string kind;
+        int first = 0;
+        int last = 0;
+        if (stream >> kind >> first >> last && kind == "batch") {
+            batches.emplace_back(first, last);
+        } else {
+            reload = true;
+        }
+    }
 
+    try {
+        ConnectionPool::Lease connection = pool_.acquire();
+        if (reload) {
+            lexiconCache_->reload(*connection);
+            return;
+        }
+        for (const auto &val : batches) {
+            lexiconCache_->update(*connection, val.first, val.second);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::refreshLexiconCache: Error: " << e.what() << std::endl;
+    }
+}
+
+void DatabaseManager::readLexicon(const TermConsumer &consumer) {
+    try {
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
+
+        const char *const query = schema_ == SCHEMA_FULLTEXT ?
+                "SELECT word, word, ndoc FROM ts_stat('SELECT document FROM page_texts')" :
+                "SELECT word, COALESCE(surface, word), doc_freq FROM lexicon";
+        pqxx::icursorstream cursor(txn, query, "lexicon_cursor", lexiconStride);
+        pqxx::result chunk;
+        size_t words = 0;
+        while (cursor >> chunk) {
+            for (const auto &row : chunk) {
+                consumer(row[0].as<std::string>(), row[1].as<std::string>(),
+                        row[2].as<uint64_t>());
+            }
+            words += chunk.size();
+        }
         txn.commit();
 
+        std::cout << "DatabaseManager::readLexicon: " << words << " words read" << std::endl;
     } catch (const std::exception &e) {
-        std::cerr << "DatabaseManager::writeData: Ошибка: " << e.what() << std::endl;
+        std::cerr << "DatabaseManager::readLexicon: Error: " << e.what() << std::endl;
     }
 }
 
-void DatabaseManager::searchWords(std::map<int, std::string, std::greater<int>> &results,
-        const std::vector<std::string> &words) {
+bool DatabaseManager::lexiconCacheActive() const {
+    return lexiconCache_ && schema_ == SCHEMA_POSTINGS;
+}
+
+void DatabaseManager::search(SearchResults &results, const QueryNode &query) {
+    QueryNode pruned = query;
+    if (lexiconCacheActive() && !pruneQuery(pruned, [this](const std::string &word) {
+        return lexiconCache_->mayContain(word);
+    })) {
+        return;
+    }
+
+    std::vector<std::string> words;
+    if (isWordsQuery(pruned, words)) {
+        searchWords(results, words);
+    } else if (schema_ == SCHEMA_FULLTEXT) {
+        searchFullTextQuery(results, pruned);
+    } else {
+        searchPostingsQuery(results, pruned);
+    }
+}
 
-    std::map<std::string, int> titleRelevant;
+void DatabaseManager::searchWords(SearchResults &results,
+        const std::vector<std::string> &queryWords) {
+    std::vector<std::string> words;
+    if (lexiconCacheActive()) {
+        // Слов, которых нет в фильтре Блума, точно нет в индексе.
+        for (const auto &word : queryWords) {
+            if (lexiconCache_->mayContain(word)) {
+                words.push_back(word);
+            }
+        }
+        if (words.empty() || lexiconCache_->searchWords(results, words, resultLimit_)) {
+            std::cout << "DatabaseManager::searchWords: sucsess (lexicon cache)" << std::endl;
+            return;
+        }
+    } else {
+        words = queryWords;
+    }
 
-    for (int i = 0; i < words.size();++ i) {
-        std::vector<std::pair<std::string, int> > wordResults;
-        getPagesByWord(words[i], wordResults);
-        for (auto &val : wordResults) {
-            // std::cout << val.first << " " << val.second << std::endl;
-            titleRelevant[val.first] += val.second;
+    if (schema_ == SCHEMA_FULLTEXT) {
+        std::string query;
+        for (const auto &word : words) {
+            query += (query.empty() ? "" : " | ") + quoteLexeme(word);
         }
+        searchFullText(results, query, resultLimit_);
+        return;
     }
 
-    for (auto &val : titleRelevant) {
-        results[val.second] = val.first;
+    TopK<RequestConfig> top(resultLimit_);
+    streamPages(words, false, resultLimit_, [&top](PageMatch &&page) {
+        top.push(page.score + proximityBonus(page.positions), std::move(page.requestConfig));
+    });
+
+    for (auto &val : top.take()) {
+        results.push_back(SearchResult {val.first, makeUrlFromRequestConfig(val.second)});
     }
 
     std::cout << "DatabaseManager::searchWords: sucsess" << std::endl;
 }
 
-void DatabaseManager::getPagesByWord(const std::string &targetWord,
-        std::vector<std::pair<std::string, int> > &results) {
+void DatabaseManager::searchFullText(SearchResults &results,
+        const std::string &query, size_t limit) {
+    if (query.empty()) {
+        return;
+    }
+
+    try {
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
+
+        pqxx::result result = execute(connection, txn, "search_fulltext", query,
+                static_cast<long long>(limit));
+        txn.commit();
+
+        pushRankedPages(result, limit, results);
+
+        std::cout << "DatabaseManager::searchFullText: sucsess" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::searchFullText: Error: " << e.what() << std::endl;
+    }
+}
+
+void DatabaseManager::searchFullTextQuery(SearchResults &results, const QueryNode &query) {
+    std::vector<std::string> positive;
+    std::vector<std::string> all;
+    collectQueryWords(query, positive, all);
+
+    try {
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
+
+        // Ранг считается по словам вне NOT, объединенным через |.
+        std::string rankQuery;
+        for (const auto &word : positive) {
+            rankQuery += (rankQuery.empty() ? "" : " | ") + quoteLexeme(word);
+        }
+        const std::string rank = rankQuery.empty() ? "0::float8" :
+                "ts_rank_cd(t.document, " + txn.quote(rankQuery) + "::tsquery)";
+        std::string sql = "SELECT p.host, p.port, p.target, " + rank + " AS rank "
+                          "FROM page_texts t JOIN pages p ON p.id = t.page_id "
+                          "WHERE " + fullTextCondition(query, txn) + " ORDER BY rank DESC";
+        if (resultLimit_ > 0) {
+            sql += " LIMIT " + std::to_string(resultLimit_);
+        }
+        pqxx::result result = txn.exec(sql);
+        txn.commit();
+
+        pushRankedPages(result, resultLimit_, results);
+
+        std::cout << "DatabaseManager::searchFullTextQuery: sucsess" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::searchFullTextQuery: Error: " << e.what() << std::endl;
+    }
+}
+
+void DatabaseManager::searchPostingsQuery(SearchResults &results, const QueryNode &query) {
+    std::vector<std::string> positive;
+    std::vector<std::string> all;
+    collectQueryWords(query, positive, all);
+    const int proximityBound = positive.size() > 1 ? maxProximityBonus : 0;
+
+    TopK<RequestConfig> top(resultLimit_);
+    auto handleRow = [&](const pqxx::row &row) {
+        RequestConfig requestConfig;
+        requestConfig.host = row[0].as<std::string>();
+        requestConfig.port = row[1].as<std::string>();
+        requestConfig.target = row[2].as<std::string>();
+        int score = row[3].as<int>();
+
+        PageWords words;
+        std::istringstream stream(row[4].is_null() ? std::string() : row[4].as<std::string>());
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            const size_t colon = item.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            const size_t index = std::stoul(item.substr(0, colon));
+            if (index >= 1 && index <= all.size()) {
+                words[all[index - 1]] = decodePositions(fromHex(item.substr(colon + 1)));
+            }
+        }
+
+        std::string host = requestConfig.host;
+        std::transform(host.begin(), host.end(), host.begin(),
+                [](unsigned char ch) { return std::tolower(ch); });
+        if (!matchesQuery(query, words, host)) {
+            return;
+        }
+        if (proximityBound > 0 && top.accepts(score + proximityBound)) {
+            std::vector<PositionList> positions;
+            for (const auto &word : positive) {
+                auto it = words.find(word);
+                positions.push_back(it == words.end() ? PositionList() : it->second);
+            }
+            score += proximityBonus(positions);
+        }
+        top.push(score, std::move(requestConfig));
+    };
+
+    try {
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
+
+        // Множество страниц вычисляется операциями над множествами в БД, оценка BM25
+        // считается по словам вне NOT, позиции всех слов запроса возвращаются строкой
+        // "номер слова:hex,..." для точной проверки запроса на клиенте.
+        bool exact = true;
+        const std::string candidates = candidatesSql(query, txn, exact);
+        const std::string allLiteral = txn.quote(toArrayLiteral(all));
+        std::string sql = R"(
+            SELECT p.host, p.port, p.target,
+                COALESCE(ROUND(SUM()" + bm25Term("po.impact", "p.length", "l.doc_freq") + R"()
+                    FILTER (WHERE l.word = ANY()" + txn.quote(toArrayLiteral(positive)) +
+                R"(::text[])) * )" + std::to_string(bm25::scoreScale) + R"(), 0)::int AS score,
+                string_agg(array_position()" + allLiteral + R"(::text[], l.word::text) || ':' ||
+                    COALESCE(encode(po.positions, 'hex'), ''), ',')
+                    FILTER (WHERE po.page_id IS NOT NULL)
+            FROM ()" + candidates + R"() AS c(page_id)
+            JOIN pages p ON p.id = c.page_id
+            LEFT JOIN lexicon l ON l.word = ANY()" + allLiteral + R"(::text[])
+            LEFT JOIN postings po ON po.word_id = l.id AND po.page_id = c.page_id
+            CROSS JOIN )" + collectionStatsSql + R"(
+            GROUP BY p.id
+            ORDER BY score DESC)";
+
+        if (exact && resultLimit_ > 0) {
+            // Кандидаты совпадают с подходящими страницами: лучшие отбираются в БД.
+            sql += " LIMIT " + std::to_string(resultLimit_);
+            for (const auto &row : txn.exec(sql)) {
+                handleRow(row);
+            }
+        } else {
+            // Часть кандидатов отсеется проверкой на клиенте, поэтому ответ читается целиком
+            // через курсор на стороне сервера.
+            pqxx::icursorstream cursor(txn, sql, "search_query_cursor", cursorStride);
+            pqxx::result chunk;
+            while (cursor >> chunk) {
+                for (const auto &row : chunk) {
+                    handleRow(row);
+                }
+            }
+        }
+        txn.commit();
+
+        for (auto &val : top.take()) {
+            results.push_back(SearchResult {val.first, makeUrlFromRequestConfig(val.second)});
+        }
+
+        std::cout << "DatabaseManager::searchPostingsQuery: sucsess" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "DatabaseManager::searchPostingsQuery: Error: " << e.what() << std::endl;
+    }
+}
+
+void DatabaseManager::streamPages(const std::vector<std::string> &words, bool requireAll,
+        size_t limit, const std::function<void(PageMatch &&)> &consumer) {
+    if (words.empty()) {
+        return;
+    }
+
+    // Номер первого вхождения каждого слова в запрос: повторяющиеся слова получают
+    // одни и те же позиции.
+    std::vector<size_t> firstIndex(words.size());
+    std::vector<std::string> distinctWords;
+    for (size_t i = 0; i < words.size(); ++i) {
+        auto it = std::find(distinctWords.begin(), distinctWords.end(), words[i]);
+        firstIndex[i] = static_cast<size_t>(it - distinctWords.begin());
+        if (it == distinctWords.end()) {
+            distinctWords.push_back(words[i]);
+        }
+    }
+
+    auto handleRow = [&](const pqxx::row &row) {
+        PageMatch page;
+        page.requestConfig.host = row[0].as<std::string>();
+        page.requestConfig.port = row[1].as<std::string>();
+        page.requestConfig.target = row[2].as<std::string>();
+        page.score = row[3].as<int>();
+
+        std::vector<PositionList> distinctPositions(distinctWords.size());
+        std::istringstream stream(row[4].as<std::string>());
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            const size_t colon = item.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            const size_t index = std::stoul(item.substr(0, colon));
+            if (index >= 1 && index <= distinctPositions.size()) {
+                distinctPositions[index - 1] = decodePositions(fromHex(item.substr(colon + 1)));
+            }
+        }
+
+        page.positions.resize(words.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            page.positions[i] = distinctPositions[firstIndex[i]];
+        }
+        consumer(std::move(page));
+    };
+
     try {
-        pqxx::work txn(connection_);
+        // Секционированная таблица ищется объединением секций, параметры запросов одинаковы.
+        const std::string statement =
+                postingsPartitions().empty() ? "search_pages" : "search_partitions";
 
-        std::string query = R"(
-            SELECT DISTINCT p.host, p.port, p.target, w.word_count
-            FROM pages p
-            JOIN page_words pw ON p.id = pw.page_id
-            JOIN words w ON pw.word_id = w.id_word
-            WHERE w.word = $1
-        )";
+        ConnectionPool::Lease connection = pool_.acquire();
+        pqxx::work txn(*connection);
 
-        pqxx::result result = txn.exec_params(query, targetWord);
+        const std::string wordsLiteral = toArrayLiteral(distinctWords);
+        const int minWords = requireAll ? static_cast<int>(distinctWords.size()) : 1;
 
-        for (const auto &row : result) {
-            RequestConfig requestConfig;
-            requestConfig.host = row[0].as<std::string>();
-            requestConfig.port = row[1].as<std::string>();
-            requestConfig.target = row[2].as<std::string>();
-            std::string url = makeUrlFromRequestConfig(requestConfig);
-            int count = row[3].as<int>();
-            results.push_back(std::make_pair(url, count));
+        if (limit > 0) {
+            // Ответ ограничен limit строками, читаем его целиком подготовленным запросом.
+            pqxx::result result = execute(connection, txn, statement, wordsLiteral,
+                    minWords, static_cast<long long>(limit));
+            for (const auto &row : result) {
+                handleRow(row);
+            }
+        } else {
+            // Без ограничения ответ может содержать сотни тысяч строк: читаем его через
+            // курсор на стороне сервера порциями по cursorStride строк.
+            const std::string query = inlineParams(pool_.statement(statement),
+                    {txn.quote(wordsLiteral), std::to_string(minWords), "0"});
+            pqxx::icursorstream cursor(txn, query, statement + "_cursor", cursorStride);
+            pqxx::result chunk;
+            while (cursor >> chunk) {
+                for (const auto &row : chunk) {
+                    handleRow(row);
+                }
+            }
         }
 
         txn.commit();
 
     } catch (const std::exception &e) {
-        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "DatabaseManager::streamPages: Error: " << e.what() << std::endl;
     }
 }
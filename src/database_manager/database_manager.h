@@ -1,11 +1,37 @@
 #pragma once
 
 #include <pqxx/pqxx>
+#include <atomic>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
+#include "connection_pool.h"
+#include "lexicon_cache.h"
+#include "notification_listener.h"
 #include "../common_data.h"
+#include "../index/proximity.h"
+
+/**
+* @brief Слова одной страницы для записи в БД.
+*/
+struct PageTerms {
+    RequestConfig requestConfig; //!< Параметры подключения к странице.
+    TermStorage terms; //!< Слова страницы.
+};
+
+/**
+* @brief Схема хранения индекса в БД.
+*/
+enum DatabaseSchema {
+    SCHEMA_POSTINGS = 0, //!< Таблицы lexicon и postings с вкладами и позициями слов.
+    SCHEMA_FULLTEXT //!< Таблица page_texts с документами tsvector под индексом GIN.
+};
 
 /**
 * @brief Класс взаимодействия с БД PostgeSql.
@@ -15,8 +41,9 @@ public:
     /**
     * @brief Конструктор.
     * @param connectionString Строка с параметрами подключения к БД,
+    * @param poolSize Число подключений в пуле.
     */
-    DatabaseManager(const std::string &connectionString);
+    DatabaseManager(const std::string &connectionString, size_t poolSize = 1);
 
     /**
     * @brief Деструктор.
@@ -25,26 +52,277 @@ public:
 
     /**
     * @brief ОСоздать все необходимые таблицы.
+    * @details Если задано больше одной секции, таблица вхождений создается секционированной
+    * по хешу word_id. Уже существующая таблица не пересоздается.
     */
     void createTables();
 
+    /**
+    * @brief Установить число хеш-секций таблицы вхождений для createTables.
+    * @details Вхождения одного слова всегда лежат в одной секции: запись пакетов из разных
+    * потоков распределяется по индексам секций, а поиск объединяет секции одним запросом
+    * и отбирает лучшие страницы в БД. 0 и 1 - таблица без секций.
+    */
+    void setPostingsPartitions(size_t partitions);
+
+    /**
+    * @brief Упорядочить таблицу вхождений по словам и обновить статистику планировщика
+    * и BM25.
+    * @details Вызывается после обхода: вхождения одного слова оказываются в соседних
+    * страницах таблицы, и поиск по слову читает их за минимум обращений к диску.
+    * Документные частоты слов и статистика коллекции пересчитываются по всей таблице.
+    */
+    void clusterPostings();
+
     /**
     * @brief Очистить БД от данных.
     */
     void clearDatabase();
 
     /**
-    * @brief
+    * @brief Записать слова страницы в БД.
+    * @details Для каждого слова сохраняется число вхождений, рассчитанный индексатором вклад
+    * в релевантность и позиции, закодированные разностями в формате varint.
+    * @param requestConfig Параметры подключения к странице.
+    * @param storage Слова страницы.
+    */
+    void writeData(const RequestConfig &requestConfig, const TermStorage &storage);
+
+    /**
+    * @brief Записать слова нескольких страниц в БД одной транзакцией.
+    * @details Слова всех страниц загружаются через COPY в нежурналируемую таблицу
+    * staging_postings под общим номером пакета, после чего переносятся в lexicon и postings
+    * двумя запросами над множествами строк.
+    * @param pages Страницы.
+    * @return false, если транзакция не зафиксирована.
+    */
+    bool writeBatch(const std::vector<PageTerms> &pages);
+
+    /**
+    * @brief Установить число лучших страниц, возвращаемых поиском по словам.
+    */
+    void setResultLimit(size_t limit);
+
+    /**
+    * @brief Установить схему, в которую записываются страницы и по которой ведется поиск.
+    * @details В схеме SCHEMA_FULLTEXT слова страницы с позициями сохраняются документом
+    * tsvector, а поиск выполняется встроенным полнотекстовым поиском PostgreSql:
+    * литералом tsquery по индексу GIN с ранжированием ts_rank_cd.
+    */
+    void setSchema(DatabaseSchema schema);
+
+    /**
+    * @brief Включить или выключить подготовленные запросы.
+    * @details Если выключены, запросы из реестра каждый раз передаются в БД текстом.
+    */
+    void setPreparedStatements(bool enabled);
+
+    /**
+    * @brief Включить или выключить конвейерную отправку независимых запросов.
+    * @details Вставки страниц пакета отправляются одним конвейером; при включенных
+    * подготовленных запросах каждая вставка выполняется через EXECUTE insert_page.
+    */
+    void setPipelining(bool enabled);
+
+    /**
+    * @brief Найти страницы, содержащие хотя бы одно из слов.
+    * @details Релевантность - оценка BM25 с прибавкой за близость слов друг к другу.
+    * Длины страниц записываются при индексации, документные частоты слов и статистика
+    * коллекции - в clusterPostings. Выполняется одним запросом к БД, который возвращает
+    * не более resultLimit страниц с наибольшей оценкой BM25. При включенном словаре в памяти
+    * неизвестные слова отбрасываются, а запрос из частых слов выполняется без обращения к БД.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param words Нормализованные слова запроса.
+    */
+    void searchWords(SearchResults &results, const std::vector<std::string> &words);
+
+    /**
+    * @brief Найти страницы, подходящие под дерево запроса.
+    * @details Запрос из слов, объединенных OR, выполняется searchWords. В схеме fulltext
+    * дерево переводится в условие на документы tsvector. В схеме вхождений множество
+    * страниц-кандидатов вычисляется в БД операциями INTERSECT, UNION и EXCEPT, а позиции
+    * фраз и исключения с фразами проверяются на клиенте. Релевантность - оценка BM25 по
+    * словам вне NOT с прибавкой за близость слов.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param query Дерево запроса.
     */
-    void writeData(const RequestConfig &requestConfig, const std::map<std::string, int> &storage);
+    void search(SearchResults &results, const QueryNode &query);
 
-    void searchWords(std::map<int, std::string, std::greater<int>> &results,
-            const std::vector<std::string> &words);
+    /**
+    * @brief Перебрать слова словаря с формами и документными частотами.
+    * @details В схеме вхождений читается таблица lexicon, частоты в которой пересчитывает
+    * clusterPostings, в схеме fulltext - статистика ts_stat документов tsvector. Документы
+    * tsvector хранят только основы, поэтому в схеме fulltext формой считается само слово.
+    * @param consumer Обработчик слова, его формы и документной частоты.
+    */
+    void readLexicon(const TermConsumer &consumer);
+
+    /**
+    * @brief Загрузить словарь и частые списки вхождений в память и держать их актуальными.
+    * @details Кэш используется в схеме вхождений: слова, которых нет в фильтре Блума,
+    * убираются из запросов без обращения к БД, а запросы только из частых слов
+    * выполняются в памяти. Загрузка идет в фоновом потоке, который подписывается на
+    * уведомления writeBatch, clusterPostings и clearDatabase и после каждого из них
+    * дочитывает или перезагружает кэш.
+    * @param config Параметры кэша.
+    * @param onChange Вызывается из фонового потока после обновления кэша.
+    */
+    void enableLexiconCache(const LexiconCacheConfig &config, std::function<void()> onChange);
 
 private:
-    //! Объект подключения к БД PostgreSql
-    pqxx::connection connection_;
+    /**
+    * @brief Страница, найденная по словам запроса.
+    */
+    struct PageMatch {
+        RequestConfig requestConfig; //!< Параметры подключения к странице.
+        int score; //!< Оценка BM25 страницы.
+        std::vector<PositionList> positions; //!< Позиции каждого слова запроса.
+    };
 
-    void getPagesByWord(const std::string &targetWord,
-            std::vector<std::pair<std::string, int> > &results);
+    std::string connectionString_; //!< Строка с параметрами подключения к БД.
+    //! Пул подключений к БД PostgreSql.
+    ConnectionPool pool_;
+    size_t resultLimit_; //!< Число лучших страниц в результатах поиска по словам.
+    std::atomic<bool> preparedStatements_; //!< Использовать подготовленные запросы.
+    std::atomic<bool> pipelining_; //!< Отправлять независимые запросы конвейером.
+    std::atomic<DatabaseSchema> schema_; //!< Схема хранения индекса.
+    size_t postingsPartitions_; //!< Число секций таблицы вхождений для createTables.
+    std::mutex partitionsMutex_; //!< Мьютекс для работы со списком секций.
+    bool partitionsLoaded_; //!< Список секций прочитан из БД.
+    std::vector<std::string> partitions_; //!< Секции таблицы вхождений.
+    std::unique_ptr<LexiconCache> lexiconCache_; //!< Словарь в памяти, если включен.
+    //! Подписка на уведомления об изменении индекса для обновления словаря в памяти.
+    std::unique_ptr<NotificationListener> notificationListener_;
+
+    /**
+    * @brief Зарегистрировать в пуле часто выполняемые запросы.
+    */
+    void registerStatements();
+
+    /**
+    * @brief Обновить словарь в памяти по уведомлениям об изменении индекса.
+    * @details Уведомление о пакете дочитывает его страницы, остальные уведомления и пустой
+    * список после подключения подписки загружают словарь заново.
+    * @param payloads Тексты уведомлений.
+    */
+    void refreshLexiconCache(const std::vector<std::string> &payloads);
+
+    /**
+    * @brief Проверить, используется ли словарь в памяти при поиске.
+    */
+    bool lexiconCacheActive() const;
+
+    /**
+    * @brief Выполнить запрос из реестра.
+    * @details Подготовленным запросом, если они включены, иначе - текстом.
+    * @param connection Подключение.
+    * @param txn Транзакция.
+    * @param name Имя запроса.
+    * @param args Параметры запроса.
+    */
+    template <typename... Args>
+    pqxx::result execute(ConnectionPool::Lease &connection, pqxx::work &txn,
+            const std::string &name, Args &&...args) {
+        if (preparedStatements_) {
+            return txn.exec_prepared(connection.prepare(name), std::forward<Args>(args)...);
+        }
+        return txn.exec_params(pool_.statement(name), std::forward<Args>(args)...);
+    }
+
+    /**
+    * @brief Добавить страницы пакета в таблицу pages.
+    * @param connection Подключение.
+    * @param txn Транзакция.
+    * @param pages Страницы.
+    * @param pageIds Контейнер для записи идентификаторов страниц.
+    */
+    void insertPages(ConnectionPool::Lease &connection, pqxx::work &txn,
+            const std::vector<PageTerms> &pages, std::vector<int> &pageIds);
+
+    /**
+    * @brief Прибавить страницы записанного пакета к статистике BM25.
+    * @details Документные частоты слов и статистика коллекции увеличиваются отдельной
+    * короткой транзакцией после фиксации пакета, поэтому блокировки строк частых слов не
+    * держатся на время записи пакета. Точные значения пересчитывает clusterPostings.
+    * Уведомление о пакете отправляется после обновления статистики.
+    * @param connection Подключение.
+    * @param pages Страницы пакета.
+    * @param notification Текст уведомления о пакете.
+    */
+    void addStatistics(ConnectionPool::Lease &connection, const std::vector<PageTerms> &pages,
+            const std::string &notification);
+
+    /**
+    * @brief Записать документы tsvector страниц пакета в таблицу page_texts.
+    * @param txn Транзакция.
+    * @param pages Страницы.
+    * @param pageIds Идентификаторы страниц.
+    * @return Число записанных документов.
+    */
+    size_t writeTexts(pqxx::work &txn, const std::vector<PageTerms> &pages,
+            const std::vector<int> &pageIds);
+
+    /**
+    * @brief Найти страницы полнотекстовым поиском PostgreSql.
+    * @param results Контейнер для записи URL страниц по убыванию ранга.
+    * @param query Литерал tsquery со словами в кавычках.
+    * @param limit Число лучших страниц, 0 - без ограничения.
+    */
+    void searchFullText(SearchResults &results, const std::string &query, size_t limit);
+
+    /**
+    * @brief Найти страницы, подходящие под дерево запроса, в схеме fulltext.
+    * @param results Контейнер для записи URL страниц по убыванию ранга.
+    * @param query Дерево запроса.
+    */
+    void searchFullTextQuery(SearchResults &results, const QueryNode &query);
+
+    /**
+    * @brief Найти страницы, подходящие под дерево запроса, по таблицам вхождений.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param query Дерево запроса.
+    */
+    void searchPostingsQuery(SearchResults &results, const QueryNode &query);
+
+    /**
+    * @brief Получить секции таблицы вхождений.
+    * @details Список читается из каталога БД при первом обращении, в реестре пула
+    * регистрируется запрос поиска search_partitions по объединению секций.
+    * @return Имена секций или пустой список, если таблица не секционирована.
+    */
+    std::vector<std::string> postingsPartitions();
+
+    /**
+    * @brief Получить таблицы, физически хранящие вхождения.
+    * @param txn Транзакция.
+    * @return Секции таблицы postings или сама таблица, если она не секционирована.
+    */
+    static std::vector<std::string> postingsTables(pqxx::transaction_base &txn);
+
+    /**
+    * @brief Перенести данные из таблиц words и page_words старой схемы в lexicon и postings.
+    * @details Ничего не делает, если таблиц старой схемы нет.
+    * @param txn Транзакция создания таблиц.
+    */
+    void migrateLegacySchema(pqxx::work &txn);
+
+    /**
+    * @brief Добавить длины страниц и документные частоты слов в таблицы, созданные до
+    * перехода на BM25.
+    * @details Ничего не делает, если столбец pages.length уже есть.
+    * @param txn Транзакция создания таблиц.
+    */
+    void migrateStatistics(pqxx::work &txn);
+
+    /**
+    * @brief Получить страницы, содержащие слова запроса, одним запросом к БД.
+    * @details Страницы передаются обработчику по одной по мере чтения ответа. Ответ без
+    * ограничения читается через курсор порциями, поэтому в памяти не накапливается.
+    * @param words Слова запроса.
+    * @param requireAll Возвращать только страницы, содержащие все слова.
+    * @param limit Число страниц с наибольшей оценкой, 0 - без ограничения.
+    * @param consumer Обработчик страниц, вызывается по убыванию оценки.
+    */
+    void streamPages(const std::vector<std::string> &words, bool requireAll, size_t limit,
+            const std::function<void(PageMatch &&)> &consumer);
 };
@@ -0,0 +1,355 @@
+#include "lexicon_cache.h"
+#include "../index/postings_codec.h"
+#include "../index/proximity.h"
+#include "../utils/bm25.h"
+#include "../utils/secondary_function.h"
+#include "../utils/top_k.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <limits>
+
+namespace {
+
+//! Число строк, читаемых из курсора за один раз.
+const size_t cursorStride = 10000;
+
+/**
+* @brief Прочитать ответ запроса через курсор на стороне сервера порциями.
+* @param txn Транзакция.
+* @param query Текст запроса.
+* @param name Имя курсора.
+* @param handler Обработчик строки ответа.
+*/
+template <typename Handler>
+void readCursor(pqxx::transaction_base &txn, const std::string &query, const std::string &name,
+        Handler handler) {
+    pqxx::icursorstream cursor(txn, query, name, cursorStride);
+    pqxx::result chunk;
+    while (cursor >> chunk) {
+        for (const auto &row : chunk) {
+            handler(row);
+        }
+    }
+}
+
+/**
+* @brief Преобразовать список чисел в литерал массива PostgreSql.
+*/
+std::string toArrayLiteral(const std::vector<int> &values) {
+    std::string literal = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        literal += (i > 0 ? "," : "") + std::to_string(values[i]);
+    }
+    return literal + "}";
+}
+
+/**
+* @brief Начать транзакцию, все запросы которой видят один снимок БД.
+* @details Иначе пакет, записанный между чтением страниц и чтением вхождений, попал бы в
+* кэш наполовину.
+*/
+void beginSnapshot(pqxx::transaction_base &txn) {
+    txn.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+}
+
+} // namespace
+
+LexiconCache::LexiconCache(const LexiconCacheConfig &config) :
+config_(config),
+loadMutex_(),
+mutex_(),
+state_() {
+}
+
+void LexiconCache::reload(pqxx::connection &connection) {
+    std::unique_lock<std::mutex> loadLock(loadMutex_);
+
+    try {
+        pqxx::work txn(connection);
+        beginSnapshot(txn);
+
+        State state;
+        const size_t words = txn.exec("SELECT COUNT(*) FROM lexicon")[0][0].as<size_t>();
+        state.bloom.reset(new BloomFilter(std::max<size_t>(words * 2, 1024),
+                config_.falsePositiveRate));
+        readCursor(txn, "SELECT word FROM lexicon", "lexicon_cache_words",
+                [&state](const pqxx::row &row) {
+            state.bloom->add(row[0].as<std::string>());
+        });
+
+        if (config_.hotTerms > 0) {
+            pqxx::result hot = txn.exec("SELECT id, word, doc_freq FROM lexicon "
+                                        "ORDER BY doc_freq DESC, id LIMIT " +
+                    std::to_string(config_.hotTerms));
+            for (const auto &row : hot) {
+                HotTerm &term = state.hotTerms[row[1].as<std::string>()];
+                term.id = row[0].as<int>();
+                term.docFreq = row[2].as<uint32_t>();
+            }
+        }
+
+        Delta delta;
+        loadPages(txn, state, 0, std::numeric_limits<int>::max(), delta);
+        for (const auto &row : txn.exec("SELECT doc_count, total_length FROM collection_stats")) {
+            delta.docCount = row[0].as<uint64_t>();
+            delta.totalLength = row[1].as<uint64_t>();
+        }
+        txn.commit();
+
+        apply(state, std::move(delta));
+        const size_t pages = state.pages.size();
+        const size_t hotTerms = state.hotTerms.size();
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            std::swap(state_, state);
+        }
+
+        std::cout << "LexiconCache::reload: " << words << " words, " << hotTerms
+                  << " hot terms, " << pages << " pages loaded" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "LexiconCache::reload: Error: " << e.what() << std::endl;
+    }
+}
+
+void LexiconCache::update(pqxx::connection &connection, int firstPageId, int lastPageId) {
+    std::unique_lock<std::mutex> loadLock(loadMutex_);
+    // Фильтр Блума нельзя расширить: после переполнения он строится заново по размеру
+    // словаря.
+    if (!state_.bloom || state_.bloom->full()) {
+        loadLock.unlock();
+        reload(connection);
+        return;
+    }
+
+    try {
+        pqxx::work txn(connection);
+        beginSnapshot(txn);
+
+        // Содержимое меняет только поток, удерживающий loadMutex_, поэтому читать его
+        // здесь можно без mutex_.
+        Delta delta;
+        loadPages(txn, state_, firstPageId, lastPageId, delta);
+        // Слова читаются со всех страниц диапазона, а не только со страниц с частыми
+        // словами: иначе фильтр Блума отбрасывал бы запросы со словами остальных страниц.
+        readCursor(txn, "SELECT DISTINCT l.word FROM lexicon l "
+                        "JOIN postings po ON po.word_id = l.id "
+                        "WHERE po.page_id BETWEEN " + std::to_string(firstPageId) + " AND " +
+                        std::to_string(lastPageId), "lexicon_cache_batch_words",
+                [this, &delta](const pqxx::row &row) {
+            std::string word = row[0].as<std::string>();
+            if (!state_.bloom->mayContain(word)) {
+                delta.words.push_back(std::move(word));
+            }
+        });
+        // addStatistics увеличивает документные частоты после каждого пакета: без них
+        // idf частых слов расходился бы со статистикой коллекции.
+        std::vector<int> hotIds;
+        hotIds.reserve(state_.hotTerms.size());
+        for (const auto &val : state_.hotTerms) {
+            hotIds.push_back(val.second.id);
+        }
+        if (!hotIds.empty()) {
+            const pqxx::result docFreqs = txn.exec_params(
+                    "SELECT id, doc_freq FROM lexicon WHERE id = ANY($1::int[])",
+                    toArrayLiteral(hotIds));
+            for (const auto &row : docFreqs) {
+                delta.docFreqs[row[0].as<int>()] = row[1].as<uint32_t>();
+            }
+        }
+        for (const auto &row : txn.exec("SELECT doc_count, total_length FROM collection_stats")) {
+            delta.docCount = row[0].as<uint64_t>();
+            delta.totalLength = row[1].as<uint64_t>();
+        }
+        txn.commit();
+
+        const size_t pages = delta.pages.size();
+        const size_t words = delta.words.size();
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            apply(state_, std::move(delta));
+        }
+
+        std::cout << "LexiconCache::update: " << pages << " pages, " << words
+                  << " new words loaded" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "LexiconCache::update: Error: " << e.what() << std::endl;
+    }
+}
+
+void LexiconCache::loadPages(pqxx::transaction_base &txn, const State &loaded, int firstPageId,
+        int lastPageId, Delta &delta) {
+    std::vector<int> hotIds;
+    hotIds.reserve(loaded.hotTerms.size());
+    for (const auto &val : loaded.hotTerms) {
+        hotIds.push_back(val.second.id);
+    }
+    if (hotIds.empty()) {
+        return;
+    }
+
+    const std::string range =
+            " BETWEEN " + std::to_string(firstPageId) + " AND " + std::to_string(lastPageId);
+    const std::string hot = "word_id = ANY(" + txn.quote(toArrayLiteral(hotIds)) + "::int[])";
+
+    // Страницы без частых слов поиску по кэшу не нужны и в память не загружаются.
+    readCursor(txn, "SELECT id, COALESCE(length, 0), host, port, target FROM pages "
+                    "WHERE id IN (SELECT page_id FROM postings WHERE " + hot +
+                    " AND page_id" + range + ")", "lexicon_cache_pages",
+            [&loaded, &delta](const pqxx::row &row) {
+        const int id = row[0].as<int>();
+        if (loaded.pages.count(id) > 0) {
+            return;
+        }
+        RequestConfig requestConfig;
+        requestConfig.host = row[2].as<std::string>();
+        requestConfig.port = row[3].as<std::string>();
+        requestConfig.target = row[4].as<std::string>();
+        delta.pages.emplace(id, Page {row[1].as<uint32_t>(),
+                makeUrlFromRequestConfig(requestConfig)});
+    });
+    if (delta.pages.empty()) {
+        return;
+    }
+
+    readCursor(txn, "SELECT word_id, page_id, impact, "
+                    "COALESCE(encode(positions, 'hex'), '') FROM postings "
+                    "WHERE " + hot + " AND page_id" + range + " ORDER BY page_id",
+            "lexicon_cache_postings", [&delta](const pqxx::row &row) {
+        const int pageId = row[1].as<int>();
+        if (delta.pages.count(pageId) == 0) {
+            return;
+        }
+        delta.postings[row[0].as<int>()].push_back(
+                Posting {pageId, row[2].as<uint32_t>(), fromHex(row[3].as<std::string>())});
+    });
+}
+
+void LexiconCache::apply(State &state, Delta &&delta) {
+    for (const auto &word : delta.words) {
+        state.bloom->add(word);
+    }
+
+    // Пакеты приходят не по порядку идентификаторов страниц, поэтому новые вхождения
+    // сливаются с уже загруженными, а не дописываются в конец.
+    auto byPage = [](const Posting &lhs, const Posting &rhs) {
+        return lhs.pageId < rhs.pageId;
+    };
+    for (auto &val : state.hotTerms) {
+        auto docFreq = delta.docFreqs.find(val.second.id);
+        if (docFreq != delta.docFreqs.end()) {
+            val.second.docFreq = docFreq->second;
+        }
+
+        auto it = delta.postings.find(val.second.id);
+        if (it == delta.postings.end()) {
+            continue;
+        }
+        std::vector<Posting> &postings = val.second.postings;
+        const size_t middle = postings.size();
+        postings.insert(postings.end(), std::make_move_iterator(it->second.begin()),
+                std::make_move_iterator(it->second.end()));
+        std::inplace_merge(postings.begin(), postings.begin() + middle, postings.end(), byPage);
+    }
+
+    for (auto &val : delta.pages) {
+        state.pages.emplace(val.first, std::move(val.second));
+    }
+    state.docCount = delta.docCount;
+    state.totalLength = delta.totalLength;
+}
+
+bool LexiconCache::mayContain(const std::string &word) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return !state_.bloom || state_.bloom->mayContain(word);
+}
+
+bool LexiconCache::searchWords(SearchResults &results, const std::vector<std::string> &words,
+        size_t limit) const {
+    std::vector<std::string> distinctWords(words);
+    std::sort(distinctWords.begin(), distinctWords.end());
+    distinctWords.erase(std::unique(distinctWords.begin(), distinctWords.end()),
+            distinctWords.end());
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<const HotTerm *> terms;
+    for (const auto &word : distinctWords) {
+        auto it = state_.hotTerms.find(word);
+        if (it == state_.hotTerms.end()) {
+            return false;
+        }
+        terms.push_back(&it->second);
+    }
+
+    // Статистика и формула совпадают с запросом search_pages DatabaseManager.
+    const uint64_t docCount = std::max<uint64_t>(state_.docCount, 1);
+    const double averageLength =
+            std::max(static_cast<double>(state_.totalLength) / docCount, 1.0);
+    std::vector<double> idf(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        idf[i] = bm25::idf(docCount, terms[i]->docFreq);
+    }
+
+    // Слияние списков вхождений по возрастанию идентификатора страницы. Как и в запросе
+    // search_pages, лучшие страницы отбираются по BM25, а прибавка за близость
+    // начисляется только им: иначе состав выдачи зависел бы от того, загружен ли кэш.
+    TopK<std::pair<const Page *, std::vector<const Posting *> > > top(limit);
+    std::vector<size_t> cursors(terms.size(), 0);
+    std::vector<const Posting *> matched(terms.size());
+    while (true) {
+        int pageId = std::numeric_limits<int>::max();
+        bool found = false;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (cursors[i] < terms[i]->postings.size()) {
+                pageId = std::min(pageId, terms[i]->postings[cursors[i]].pageId);
+                found = true;
+            }
+        }
+        if (!found) {
+            break;
+        }
+
+        auto page = state_.pages.find(pageId);
+        double sum = 0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            matched[i] = nullptr;
+            if (cursors[i] < terms[i]->postings.size() &&
+                    terms[i]->postings[cursors[i]].pageId == pageId) {
+                matched[i] = &terms[i]->postings[cursors[i]++];
+                if (page != state_.pages.end()) {
+                    sum += idf[i] * bm25::termWeight(matched[i]->impact, page->second.length,
+                            averageLength);
+                }
+            }
+        }
+        if (page == state_.pages.end()) {
+            continue;
+        }
+
+        const int score = static_cast<int>(std::lround(sum * bm25::scoreScale));
+        if (top.accepts(score)) {
+            top.push(score, std::make_pair(&page->second, matched));
+        }
+    }
+
+    TopK<const Page *> ranked(limit);
+    std::vector<PositionList> positions(terms.size());
+    for (auto &val : top.take()) {
+        int score = val.first;
+        if (terms.size() > 1) {
+            for (size_t i = 0; i < terms.size(); ++i) {
+                positions[i] = val.second.second[i]
+                        ? decodePositions(val.second.second[i]->positions) : PositionList();
+            }
+            score += proximityBonus(positions);
+        }
+        ranked.push(score, val.second.first);
+    }
+
+    for (auto &val : ranked.take()) {
+        results.push_back(SearchResult {val.first, val.second->url});
+    }
+    return true;
+}
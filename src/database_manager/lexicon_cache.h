@@ -0,0 +1,150 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "database_config.h"
+#include "../common_data.h"
+#include "../utils/bloom_filter.h"
+
+/**
+* @brief Словарь и списки вхождений частых слов БД в памяти поисковика.
+* @details Все слова таблицы lexicon хранятся фильтром Блума: слово, которого нет в
+* фильтре, точно не встречается ни на одной странице, и запрос с ним не идет в БД. Для
+* hotTerms слов с наибольшей документной частотой в памяти лежат вклады и позиции всех
+* вхождений, а для страниц - длины и URL, поэтому запрос только из таких слов
+* выполняется без обращения к БД.
+* reload загружает все заново, update дочитывает страницы записанного пакета и их слова.
+* Данные читаются из БД без блокировки, а добавляются в кэш под исключительной
+* блокировкой, поэтому поиск, идущий под разделяемой, не ждет чтения из БД.
+*/
+class LexiconCache {
+public:
+    /**
+    * @brief Конструктор.
+    * @param config Параметры кэша.
+    */
+    explicit LexiconCache(const LexiconCacheConfig &config);
+
+    /**
+    * @brief Загрузить словарь и списки вхождений заново.
+    * @details Нужна после очистки БД и пересчета документных частот: при этом меняются
+    * статистика BM25 и набор частых слов.
+    * @param connection Подключение к БД.
+    */
+    void reload(pqxx::connection &connection);
+
+    /**
+    * @brief Дочитать страницы пакета и их слова.
+    * @details Пакеты, записываемые параллельно, получают идентификаторы страниц вперемешку,
+    * поэтому уже загруженные страницы диапазона пропускаются. Загружает все заново, если
+    * фильтр Блума переполнен.
+    * @param connection Подключение к БД.
+    * @param firstPageId Наименьший идентификатор страницы пакета.
+    * @param lastPageId Наибольший идентификатор страницы пакета.
+    */
+    void update(pqxx::connection &connection, int firstPageId, int lastPageId);
+
+    /**
+    * @brief Проверить, может ли слово встречаться в индексе.
+    * @return false, если слова точно нет в словаре. До первой загрузки - всегда true.
+    */
+    bool mayContain(const std::string &word) const;
+
+    /**
+    * @brief Найти страницы, содержащие хотя бы одно из слов, по спискам в памяти.
+    * @details Релевантность считается так же, как в DatabaseManager::searchWords: limit
+    * лучших по BM25 страниц упорядочиваются заново с прибавкой за близость слов.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param words Слова запроса.
+    * @param limit Число лучших страниц, 0 - без ограничения.
+    * @return false, если не все слова частые: поиск нужно выполнить в БД.
+    */
+    bool searchWords(SearchResults &results, const std::vector<std::string> &words,
+            size_t limit) const;
+
+private:
+    /**
+    * @brief Вхождение частого слова.
+    */
+    struct Posting {
+        int pageId; //!< Идентификатор страницы.
+        uint32_t impact; //!< Вклад слова в релевантность страницы.
+        std::string positions; //!< Позиции слова в формате postings_codec.
+    };
+
+    /**
+    * @brief Частое слово.
+    */
+    struct HotTerm {
+        int id; //!< Идентификатор слова в lexicon.
+        uint32_t docFreq; //!< Документная частота на момент последней загрузки.
+        std::vector<Posting> postings; //!< Вхождения по возрастанию идентификатора страницы.
+    };
+
+    /**
+    * @brief Страница, на которой встречаются частые слова.
+    */
+    struct Page {
+        uint32_t length; //!< Длина страницы для BM25.
+        std::string url; //!< URL страницы.
+    };
+
+    /**
+    * @brief Загруженное содержимое кэша.
+    */
+    struct State {
+        std::unique_ptr<BloomFilter> bloom; //!< Фильтр Блума всех слов.
+        std::unordered_map<std::string, HotTerm> hotTerms; //!< Частые слова.
+        //! Страницы с частыми словами по идентификатору.
+        std::unordered_map<int, Page> pages;
+        uint64_t docCount = 0; //!< Число страниц для BM25.
+        uint64_t totalLength = 0; //!< Суммарная длина страниц для BM25.
+    };
+
+    /**
+    * @brief Данные, прочитанные из БД для добавления в кэш.
+    */
+    struct Delta {
+        std::vector<std::string> words; //!< Слова для фильтра Блума.
+        std::unordered_map<int, std::vector<Posting> > postings; //!< Вхождения по слову.
+        std::unordered_map<int, Page> pages; //!< Новые страницы.
+        std::unordered_map<int, uint32_t> docFreqs; //!< Документные частоты частых слов.
+        uint64_t docCount = 0; //!< Число страниц для BM25.
+        uint64_t totalLength = 0; //!< Суммарная длина страниц для BM25.
+    };
+
+    LexiconCacheConfig config_; //!< Параметры кэша.
+    std::mutex loadMutex_; //!< Мьютекс загрузки: изменяет содержимое только один поток.
+    mutable std::shared_mutex mutex_; //!< Мьютекс для работы с содержимым.
+    State state_; //!< Содержимое кэша.
+
+    /**
+    * @brief Прочитать страницы диапазона, на которых встречаются частые слова, и
+    * вхождения в них частых слов.
+    * @details Страницы без частых слов не читаются. Частые слова встречаются на
+    * большинстве страниц, поэтому память под страницы все равно растет с их числом:
+    * примерно длина URL и 8 байт на страницу.
+    * @param txn Транзакция.
+    * @param loaded Содержимое, к которому добавляются данные: из него берутся частые
+    * слова, а уже загруженные страницы пропускаются.
+    * @param firstPageId Наименьший идентификатор страницы.
+    * @param lastPageId Наибольший идентификатор страницы.
+    * @param delta Данные для записи.
+    */
+    static void loadPages(pqxx::transaction_base &txn, const State &loaded, int firstPageId,
+            int lastPageId, Delta &delta);
+
+    /**
+    * @brief Добавить прочитанные данные в содержимое кэша.
+    * @param state Содержимое кэша.
+    * @param delta Прочитанные данные.
+    */
+    static void apply(State &state, Delta &&delta);
+};
@@ -0,0 +1,74 @@
+#include "notification_listener.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+//! Время ожидания уведомления, после которого проверяется флаг остановки, с.
+const long waitSeconds = 1;
+
+//! Задержка перед повторным подключением, мс.
+const int reconnectDelayMs = 1000;
+
+/**
+* @brief Получатель уведомлений канала: накапливает их тексты.
+*/
+class Receiver : public pqxx::notification_receiver {
+public:
+    Receiver(pqxx::connection &connection, const std::string &channel,
+            std::vector<std::string> &payloads) :
+    pqxx::notification_receiver(connection, channel),
+    payloads_(payloads) {
+    }
+
+    void operator()(const std::string &payload, int) override {
+        payloads_.push_back(payload);
+    }
+
+private:
+    std::vector<std::string> &payloads_; //!< Тексты полученных уведомлений.
+};
+
+} // namespace
+
+NotificationListener::NotificationListener(const std::string &connectionString,
+        const std::string &channel, Handler handler) :
+connectionString_(connectionString),
+channel_(channel),
+handler_(std::move(handler)),
+stop_(false),
+thread_() {
+    thread_ = std::thread(&NotificationListener::run, this);
+}
+
+NotificationListener::~NotificationListener() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void NotificationListener::run() {
+    while (!stop_) {
+        try {
+            pqxx::connection connection(connectionString_);
+            std::vector<std::string> payloads;
+            Receiver receiver(connection, channel_, payloads);
+            handler_(payloads);
+
+            while (!stop_) {
+                connection.await_notification(waitSeconds, 0);
+                if (!payloads.empty()) {
+                    handler_(payloads);
+                    payloads.clear();
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "NotificationListener::run: Error: " << e.what() << std::endl;
+            for (int waited = 0; waited < reconnectDelayMs && !stop_; waited += 100) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+* @brief Подписка на уведомления PostgreSql (LISTEN/NOTIFY).
+* @details Фоновый поток держит отдельное подключение, выполняет LISTEN и ждет
+* уведомлений канала. Уведомления, пришедшие вместе, передаются обработчику одним
+* вызовом. После каждого подключения, в том числе первого и повторного после обрыва,
+* обработчик вызывается с пустым списком: пока подписки не было, уведомления могли
+* потеряться, и подписчик должен перечитать данные целиком.
+*/
+class NotificationListener {
+public:
+    //! Обработчик уведомлений, получает их тексты (payload) в порядке поступления.
+    typedef std::function<void(const std::vector<std::string> &)> Handler;
+
+    /**
+    * @brief Конструктор. Запускает фоновый поток.
+    * @param connectionString Строка с параметрами подключения к БД.
+    * @param channel Канал уведомлений.
+    * @param handler Обработчик, вызывается из фонового потока.
+    */
+    NotificationListener(const std::string &connectionString, const std::string &channel,
+            Handler handler);
+
+    /**
+    * @brief Деструктор. Останавливает фоновый поток.
+    */
+    ~NotificationListener();
+
+    NotificationListener(const NotificationListener &) = delete;
+    NotificationListener &operator=(const NotificationListener &) = delete;
+
+private:
+    std::string connectionString_; //!< Строка с параметрами подключения к БД.
+    std::string channel_; //!< Канал уведомлений.
+    Handler handler_; //!< Обработчик уведомлений.
+    std::atomic<bool> stop_; //!< Флаг остановки фонового потока.
+    std::thread thread_; //!< Фоновый поток.
+
+    /**
+    * @brief Цикл фонового потока.
+    */
+    void run();
+};
@@ -0,0 +1,146 @@
+#include "write_behind_queue.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+WriteBehindQueue::WriteBehindQueue(DatabaseManager &dbManager, const WriteBehindConfig &config) :
+dbManager_(dbManager),
+config_(config),
+mutex_(),
+pushCondition_(),
+writeCondition_(),
+flushCondition_(),
+pages_(),
+oldest_(),
+inFlight_(0),
+flushing_(false),
+failed_(false),
+stop_(false) {
+    config_.batchPages = std::max<size_t>(config_.batchPages, 1);
+    config_.maxQueuedPages = std::max(config_.maxQueuedPages, config_.batchPages);
+    for (size_t i = 0; i < std::max<size_t>(config_.writerThreads, 1); ++i) {
+        writers_.emplace_back(&WriteBehindQueue::writerThread, this);
+    }
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    writeCondition_.notify_all();
+    pushCondition_.notify_all();
+
+    for (std::thread &writer : writers_) {
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    if (!pages_.empty()) {
+        std::cerr << "WriteBehindQueue::~WriteBehindQueue: Error: " << pages_.size()
+                  << " pages not written" << std::endl;
+    }
+}
+
+void WriteBehindQueue::push(PageTerms &&page) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        pushCondition_.wait(lock, [this]() {
+            return stop_ || pages_.size() + inFlight_ < config_.maxQueuedPages;
+        });
+
+        if (pages_.empty()) {
+            oldest_ = std::chrono::steady_clock::now();
+        }
+        pages_.push_back(std::move(page));
+    }
+    writeCondition_.notify_one();
+}
+
+bool WriteBehindQueue::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushing_ = true;
+    failed_ = false;
+    writeCondition_.notify_one();
+    flushCondition_.wait(lock, [this]() {
+        return failed_ || (pages_.empty() && inFlight_ == 0);
+    });
+    flushing_ = false;
+    return !failed_;
+}
+
+void WriteBehindQueue::writerThread() {
+    while (true) {
+        std::vector<PageTerms> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (pages_.size() < config_.batchPages) {
+                if (!pages_.empty() && (stop_ || flushing_)) {
+                    break;
+                }
+                if (stop_) {
+                    return;
+                }
+                if (pages_.empty()) {
+                    writeCondition_.wait(lock);
+                    continue;
+                }
+
+                const auto deadline = oldest_ + std::chrono::milliseconds(config_.batchDelayMs);
+                if (writeCondition_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                    break;
+                }
+            }
+
+            const size_t count = std::min(pages_.size(), config_.batchPages);
+            batch.assign(std::make_move_iterator(pages_.begin()),
+                    std::make_move_iterator(pages_.begin() + count));
+            pages_.erase(pages_.begin(), pages_.begin() + count);
+            inFlight_ += count;
+            oldest_ = std::chrono::steady_clock::now();
+        }
+
+        const bool written = writeWithRetry(batch);
+
+        bool stopped = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!written) {
+                // Возвращаем пакет в начало очереди: страницы не теряются, а паук
+                // притормаживает, пока БД недоступна. flush узнает об ошибке, а при
+                // остановке поток завершается, не повторяя запись бесконечно.
+                pages_.insert(pages_.begin(), std::make_move_iterator(batch.begin()),
+                        std::make_move_iterator(batch.end()));
+                failed_ = true;
+                stopped = stop_;
+            }
+            inFlight_ -= batch.size();
+        }
+        pushCondition_.notify_all();
+        flushCondition_.notify_all();
+        if (stopped) {
+            return;
+        }
+    }
+}
+
+bool WriteBehindQueue::writeWithRetry(const std::vector<PageTerms> &batch) {
+    int delayMs = config_.retryDelayMs;
+    for (int attempt = 0;; ++attempt) {
+        // Пакет пишется одной транзакцией, при ошибке она откатывается целиком,
+        // поэтому повтор не создает дубликатов.
+        if (dbManager_.writeBatch(batch)) {
+            return true;
+        }
+        if (attempt >= config_.maxRetries) {
+            return false;
+        }
+
+        std::cerr << "WriteBehindQueue::writeWithRetry: Error: batch of " << batch.size()
+                  << " pages failed, retry in " << delayMs << " ms" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        delayMs *= 2;
+    }
+}
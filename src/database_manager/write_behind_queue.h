@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "database_config.h"
+#include "database_manager.h"
+
+/**
+* @brief Очередь отложенной записи страниц в БД.
+* @details Рабочие потоки паука помещают страницы в очередь, а фоновые потоки собирают их
+* в пакеты (по размеру или по времени) и записывают каждый пакет одной транзакцией,
+* каждый через свое подключение из пула.
+* Если очередь переполнена, push блокируется до освобождения места, замедляя паука до
+* скорости записи. Пакет остается в памяти до успешной фиксации транзакции: при ошибке
+* запись повторяется с нарастающей задержкой, а если попытки исчерпаны, пакет
+* возвращается в начало очереди в любом состоянии, в том числе при flush и остановке.
+*/
+class WriteBehindQueue {
+public:
+    /**
+    * @brief Конструктор. Запускает фоновые потоки записи.
+    * @param dbManager Объект взаимодействия с БД.
+    * @param config Параметры очереди.
+    */
+    WriteBehindQueue(DatabaseManager &dbManager, const WriteBehindConfig &config);
+
+    /**
+    * @brief Деструктор. Записывает оставшиеся страницы и останавливает фоновые потоки.
+    * @details Если БД недоступна, потоки останавливаются после исчерпания попыток, а
+    * незаписанные страницы остаются только в сообщении об ошибке. Чтобы обнаружить это
+    * заранее, перед уничтожением вызывается flush.
+    */
+    ~WriteBehindQueue();
+
+    /**
+    * @brief Поместить страницу в очередь.
+    * @details Блокируется, пока в очереди maxQueuedPages страниц или больше.
+    * @param page Слова страницы.
+    */
+    void push(PageTerms &&page);
+
+    /**
+    * @brief Дождаться записи всех страниц, помещенных в очередь.
+    * @details Если пакет не удалось записать за все попытки, ожидание прерывается: пакет
+    * остается в очереди, запись продолжается в фоне и повторяется следующим flush.
+    * @return false, если записаны не все страницы.
+    */
+    bool flush();
+
+private:
+    DatabaseManager &dbManager_; //!< Объект взаимодействия с БД.
+    WriteBehindConfig config_; //!< Параметры очереди.
+    std::mutex mutex_; //!< Мьютекс для работы с очередью.
+    std::condition_variable pushCondition_; //!< Условие освобождения места в очереди.
+    std::condition_variable writeCondition_; //!< Условие появления работы для записи.
+    std::condition_variable flushCondition_; //!< Условие опустошения очереди.
+    std::deque<PageTerms> pages_; //!< Очередь страниц.
+    std::chrono::steady_clock::time_point oldest_; //!< Время помещения первой страницы.
+    size_t inFlight_; //!< Число страниц в записываемых пакетах.
+    bool flushing_; //!< Запрошена запись неполного пакета.
+    bool failed_; //!< Пакет не записан за все попытки с начала текущего flush.
+    bool stop_; //!< Условие остановки фоновых потоков.
+    std::vector<std::thread> writers_; //!< Фоновые потоки записи.
+
+    /**
+    * @brief Обработать фоновую запись пакетов.
+    */
+    void writerThread();
+
+    /**
+    * @brief Записать пакет, повторяя попытки при ошибке.
+    * @param batch Пакет страниц.
+    * @return false, если все попытки исчерпаны.
+    */
+    bool writeWithRetry(const std::vector<PageTerms> &batch);
+};
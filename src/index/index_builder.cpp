@@ -0,0 +1,539 @@
+#include "index_builder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <queue>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+//! Пауза перед повтором после первой неудачной попытки слияния.
+const std::chrono::seconds mergeRetryDelay(1);
+
+//! Наибольшая пауза перед повтором слияния.
+const std::chrono::seconds maxMergeRetryDelay(300);
+
+/**
+* @brief Получить ярус сегмента по его размеру.
+* @param size Размер сегмента в байтах.
+* @param base Размер сегмента нулевого яруса.
+* @param factor Коэффициент роста яруса.
+*/
+size_t segmentTier(uintmax_t size, size_t base, size_t factor) {
+    size_t tier = 0;
+    uintmax_t limit = std::max<size_t>(base, 1) * std::max<size_t>(factor, 2);
+    while (size >= limit) {
+        ++tier;
+        limit *= std::max<size_t>(factor, 2);
+    }
+    return tier;
+}
+
+/**
+* @brief Закодированный список вхождений слова после слияния прогонов.
+*/
+struct MergedTerm {
+    std::string term; //!< Слово.
+    SurfaceForm surface; //!< Самая частая форма слова.
+    uint32_t docFreq; //!< Число документов.
+    std::string block; //!< Список вхождений, закодированный SegmentWriter::encodePostings.
+};
+
+/**
+* @brief Выбрать границы диапазонов слов для параллельного слияния.
+* @details Границы берутся равномерно из словаря самого большого прогона.
+* @param runs Прогоны.
+* @param parts Желаемое число диапазонов.
+* @return Нижние границы диапазонов, первая - пустая строка.
+*/
+std::vector<std::string> splitTermRange(const std::vector<MemSegment> &runs, size_t parts) {
+    const MemSegment *largest = &runs.front();
+    for (const auto &run : runs) {
+        if (run.terms().size() > largest->terms().size()) {
+            largest = &run;
+        }
+    }
+
+    std::vector<std::string> bounds(1);
+    const size_t count = largest->terms().size();
+    auto it = largest->terms().begin();
+    size_t index = 0;
+    for (size_t part = 1; part < parts; ++part) {
+        const size_t target = part * count / parts;
+        std::advance(it, target - index);
+        index = target;
+        if (it != largest->terms().end() && it->first > bounds.back()) {
+            bounds.push_back(it->first);
+        }
+    }
+
+    return bounds;
+}
+
+/**
+* @brief K-путевое слияние прогонов в диапазоне слов [lower, upper).
+* @param runs Прогоны.
+* @param lower Нижняя граница диапазона.
+* @param upper Верхняя граница диапазона, пустая строка - до конца словаря.
+* @param merged Контейнер для записи слов по возрастанию.
+*/
+void mergeTermRange(const std::vector<MemSegment> &runs, const std::string &lower,
+        const std::string &upper, std::vector<MergedTerm> &merged) {
+    typedef MemSegment::Terms::const_iterator Iterator;
+    std::vector<std::pair<Iterator, Iterator> > cursors;
+    std::vector<const MemSegment *> sources; // прогон каждого курсора
+    for (const auto &run : runs) {
+        const Iterator begin = run.terms().lower_bound(lower);
+        const Iterator end = upper.empty() ? run.terms().end() : run.terms().lower_bound(upper);
+        if (begin != end) {
+            cursors.emplace_back(begin, end);
+            sources.push_back(&run);
+        }
+    }
+
+    auto greater = [&cursors](size_t lhs, size_t rhs) {
+        return cursors[lhs].first->first > cursors[rhs].first->first;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        heap.push(i);
+    }
+
+    while (!heap.empty()) {
+        const std::string term = cursors[heap.top()].first->first;
+        std::vector<Posting> postings;
+        SurfaceCounter surfaces;
+
+        while (!heap.empty() && cursors[heap.top()].first->first == term) {
+            const size_t i = heap.top();
+            heap.pop();
+            surfaces.add(sources[i]->surface(term));
+
+            // Каждый прогон отсортирован по идентификатору документа, но прогоны разных
+            // потоков перемежаются, поэтому списки сливаются, а не дописываются.
+            const std::vector<Posting> &run = cursors[i].first->second;
+            const size_t middle = postings.size();
+            postings.insert(postings.end(), run.begin(), run.end());
+            std::inplace_merge(postings.begin(), postings.begin() + middle, postings.end(),
+                    [](const Posting &lhs, const Posting &rhs) { return lhs.docId < rhs.docId; });
+
+            if (++cursors[i].first != cursors[i].second) {
+                heap.push(i);
+            }
+        }
+
+        merged.push_back(MergedTerm {term, surfaces.best(),
+                static_cast<uint32_t>(postings.size()), SegmentWriter::encodePostings(postings)});
+    }
+}
+
+} // namespace
+
+IndexPartition::IndexPartition(IndexBuilder &builder) :
+builder_(builder),
+segment_() {
+}
+
+IndexPartition::~IndexPartition() {
+    checkpoint();
+}
+
+void IndexPartition::addDocument(const std::string &url, const TermStorage &terms) {
+    segment_.addDocument(builder_.nextDocId(), url, terms);
+    if (segment_.memoryUsage() >= builder_.partitionThreshold()) {
+        checkpoint();
+    }
+}
+
+void IndexPartition::checkpoint() {
+    if (segment_.empty()) {
+        return;
+    }
+
+    MemSegment run;
+    std::swap(run, segment_);
+    builder_.submit(std::move(run));
+}
+
+IndexBuilder::IndexBuilder(const IndexBuilderConfig &config) :
+config_(config),
+mutex_(),
+mergeCondition_(),
+runs_(),
+manifest_(),
+nextDocId_(0),
+merging_(),
+retired_(),
+stop_(false) {
+    std::error_code ec;
+    fs::create_directories(config_.directory, ec);
+    if (ec) {
+        throw std::runtime_error("IndexBuilder::IndexBuilder: can't create " + config_.directory +
+                ": " + ec.message());
+    }
+
+    if (!manifest_.load(config_.directory)) {
+        manifest_.save(config_.directory);
+    }
+    nextDocId_ = manifest_.nextDocId;
+    removeOrphans();
+
+    std::cout << "IndexBuilder::IndexBuilder: opened index " << config_.directory << " with "
+              << manifest_.segments.size() << " segments" << std::endl;
+
+    mergeThread_ = std::thread(&IndexBuilder::mergeThread, this);
+}
+
+IndexBuilder::~IndexBuilder() {
+    flush();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    mergeCondition_.notify_all();
+
+    if (mergeThread_.joinable()) {
+        mergeThread_.join();
+    }
+}
+
+uint32_t IndexBuilder::nextDocId() {
+    return nextDocId_.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t IndexBuilder::partitionThreshold() const {
+    return config_.flushThresholdBytes;
+}
+
+void IndexBuilder::submit(MemSegment &&run) {
+    std::vector<MemSegment> runs;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        runs_.push_back(std::move(run));
+        if (runs_.size() < std::max<size_t>(config_.checkpointRuns, 1)) {
+            return;
+        }
+        std::swap(runs, runs_);
+    }
+
+    writeRuns(runs);
+}
+
+bool IndexBuilder::flush() {
+    std::vector<MemSegment> runs;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (runs_.empty()) {
+            return true;
+        }
+        std::swap(runs, runs_);
+    }
+
+    return writeRuns(runs);
+}
+
+void IndexBuilder::clear() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    mergeCondition_.wait(lock, [this]() { return merging_.empty(); });
+
+    retired_.insert(manifest_.segments.begin(), manifest_.segments.end());
+    runs_.clear();
+    manifest_.segments.clear();
+    manifest_.generation++;
+    saveManifest();
+    removeRetired();
+
+    std::cout << "IndexBuilder::clear: sucsessful clear index" << std::endl;
+}
+
+void IndexBuilder::publish() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    manifest_.published = manifest_.segments;
+    manifest_.snapshot++;
+    manifest_.generation++;
+    saveManifest();
+    removeRetired();
+
+    std::cout << "IndexBuilder::publish: snapshot " << manifest_.snapshot << " with "
+              << manifest_.published.size() << " segments published" << std::endl;
+}
+
+bool IndexBuilder::writeRuns(std::vector<MemSegment> &runs) {
+    size_t docCount = 0;
+    for (const auto &run : runs) {
+        docCount += run.docs().size();
+    }
+
+    std::string name;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        name = newSegmentName();
+    }
+
+    const bool written = runs.size() == 1 ? SegmentWriter::write(segmentPath(name), runs.front())
+                                          : mergeRuns(runs, segmentPath(name));
+    if (!written) {
+        std::cerr << "IndexBuilder::writeRuns: Error: can't write segment " << name << ", "
+                  << docCount << " documents kept for the next flush" << std::endl;
+        std::unique_lock<std::mutex> lock(mutex_);
+        runs_.insert(runs_.begin(), std::make_move_iterator(runs.begin()),
+                std::make_move_iterator(runs.end()));
+        return false;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        manifest_.segments.push_back(name);
+        manifest_.generation++;
+        saveManifest();
+    }
+    mergeCondition_.notify_one();
+
+    std::cout << "IndexBuilder::writeRuns: segment " << name << " with " << docCount
+              << " documents from " << runs.size() << " runs written" << std::endl;
+    return true;
+}
+
+bool IndexBuilder::mergeRuns(const std::vector<MemSegment> &runs, const std::string &path) {
+    size_t threadCount = config_.mergeThreads;
+    if (threadCount == 0) {
+        threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    const std::vector<std::string> bounds = splitTermRange(runs, threadCount);
+    std::vector<std::vector<MergedTerm> > parts(bounds.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        const std::string upper = i + 1 < bounds.size() ? bounds[i + 1] : std::string();
+        threads.emplace_back(mergeTermRange, std::cref(runs), bounds[i], upper,
+                std::ref(parts[i]));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    SegmentWriter writer(path);
+    for (const auto &run : runs) {
+        for (const auto &doc : run.docs()) {
+            writer.addDoc(doc);
+        }
+    }
+    for (const auto &part : parts) {
+        for (const auto &merged : part) {
+            writer.addTermBlock(merged.term, merged.surface, merged.docFreq, merged.block);
+        }
+    }
+
+    return writer.finish();
+}
+
+void IndexBuilder::saveManifest() {
+    manifest_.nextDocId = nextDocId_;
+    manifest_.save(config_.directory);
+}
+
+void IndexBuilder::mergeThread() {
+    std::chrono::seconds retryDelay = mergeRetryDelay;
+    while (true) {
+        std::vector<std::string> inputs;
+        std::string output;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            mergeCondition_.wait(lock, [this, &inputs]() { return stop_ || pickMerge(inputs); });
+            if (inputs.empty()) {
+                return;
+            }
+
+            merging_.insert(inputs.begin(), inputs.end());
+            output = newSegmentName();
+        }
+
+        const bool merged = mergeSegments(inputs, output);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (merged) {
+                auto &segments = manifest_.segments;
+                segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                       [this](const std::string &name) {
+                                           return merging_.count(name) != 0;
+                                       }),
+                        segments.end());
+                segments.push_back(output);
+                manifest_.generation++;
+                saveManifest();
+
+                retired_.insert(inputs.begin(), inputs.end());
+                removeRetired();
+            } else {
+                std::remove(segmentPath(output).c_str());
+            }
+            merging_.clear();
+        }
+        mergeCondition_.notify_all();
+
+        if (merged) {
+            retryDelay = mergeRetryDelay;
+            continue;
+        }
+
+        // Причина сбоя (например, нехватка места на диске) может пройти сама, поэтому
+        // слияние повторяется с растущей паузой, а не останавливается навсегда.
+        std::cerr << "IndexBuilder::mergeThread: Error: merge into " << output
+                  << " failed, retry in " << retryDelay.count() << " s" << std::endl;
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (mergeCondition_.wait_for(lock, retryDelay, [this]() { return stop_; })) {
+            return;
+        }
+        retryDelay = std::min(retryDelay * 2, maxMergeRetryDelay);
+    }
+}
+
+bool IndexBuilder::pickMerge(std::vector<std::string> &inputs) {
+    if (!merging_.empty()) {
+        return false;
+    }
+
+    std::map<size_t, std::vector<std::string> > tiers;
+    for (const auto &name : manifest_.segments) {
+        std::error_code ec;
+        const uintmax_t size = fs::file_size(segmentPath(name), ec);
+        if (ec) {
+            continue;
+        }
+        const size_t tier = segmentTier(size, config_.flushThresholdBytes, config_.mergeFactor);
+        tiers[tier].push_back(name);
+    }
+
+    const size_t factor = std::max<size_t>(config_.mergeFactor, 2);
+    for (auto &tier : tiers) {
+        if (tier.second.size() >= factor) {
+            inputs.assign(tier.second.begin(), tier.second.begin() + factor);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool IndexBuilder::mergeSegments(const std::vector<std::string> &inputs,
+        const std::string &output) {
+    std::vector<std::unique_ptr<SegmentReader> > readers;
+    for (const auto &name : inputs) {
+        auto reader = std::make_unique<SegmentReader>();
+        if (!reader->open(segmentPath(name))) {
+            return false;
+        }
+        readers.push_back(std::move(reader));
+    }
+
+    SegmentWriter writer(segmentPath(output));
+    for (const auto &reader : readers) {
+        for (const auto &doc : reader->docs()) {
+            writer.addDoc(doc);
+        }
+    }
+
+    // K-путевое слияние словарей: в куче лежит текущее слово каждого сегмента.
+    typedef std::pair<size_t, size_t> Cursor; // сегмент, номер записи словаря
+    auto greater = [&readers](const Cursor &lhs, const Cursor &rhs) {
+        return readers[lhs.first]->dictionary()[lhs.second].term >
+                readers[rhs.first]->dictionary()[rhs.second].term;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < readers.size(); ++i) {
+        if (!readers[i]->dictionary().empty()) {
+            heap.push(Cursor(i, 0));
+        }
+    }
+
+    while (!heap.empty()) {
+        const std::string term = readers[heap.top().first]->dictionary()[heap.top().second].term;
+        std::vector<Posting> postings;
+        SurfaceCounter surfaces;
+
+        while (!heap.empty() &&
+                readers[heap.top().first]->dictionary()[heap.top().second].term == term) {
+            Cursor cursor = heap.top();
+            heap.pop();
+
+            const SegmentReader &reader = *readers[cursor.first];
+            surfaces.add(reader.dictionary()[cursor.second].surface);
+            std::vector<Posting> run = reader.postings(reader.dictionary()[cursor.second]);
+            const size_t middle = postings.size();
+            postings.insert(postings.end(), std::make_move_iterator(run.begin()),
+                    std::make_move_iterator(run.end()));
+            std::inplace_merge(postings.begin(), postings.begin() + middle, postings.end(),
+                    [](const Posting &lhs, const Posting &rhs) { return lhs.docId < rhs.docId; });
+
+            if (++cursor.second < reader.dictionary().size()) {
+                heap.push(cursor);
+            }
+        }
+
+        writer.addTerm(term, surfaces.best(), postings);
+    }
+
+    if (!writer.finish()) {
+        return false;
+    }
+
+    std::cout << "IndexBuilder::mergeSegments: merged " << inputs.size() << " segments into "
+              << output << std::endl;
+    return true;
+}
+
+void IndexBuilder::removeRetired() {
+    const std::set<std::string> published(manifest_.published.begin(),
+            manifest_.published.end());
+    for (auto it = retired_.begin(); it != retired_.end();) {
+        if (published.count(*it) != 0) {
+            ++it;
+            continue;
+        }
+        std::remove(segmentPath(*it).c_str());
+        it = retired_.erase(it);
+    }
+}
+
+void IndexBuilder::removeOrphans() {
+    std::set<std::string> used(manifest_.segments.begin(), manifest_.segments.end());
+    used.insert(manifest_.published.begin(), manifest_.published.end());
+
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(config_.directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (entry.path().extension() == ".seg" && used.count(name) == 0) {
+            fs::remove(entry.path(), ec);
+            std::cout << "IndexBuilder::removeOrphans: removed " << name << std::endl;
+        }
+    }
+
+    // Выбывшие, но еще опубликованные сегменты удаляются при следующей публикации.
+    for (const auto &name : manifest_.published) {
+        if (std::find(manifest_.segments.begin(), manifest_.segments.end(), name) ==
+                manifest_.segments.end()) {
+            retired_.insert(name);
+        }
+    }
+}
+
+std::string IndexBuilder::newSegmentName() {
+    char name[32];
+    std::snprintf(name, sizeof(name), "seg_%06u.seg", manifest_.nextSegmentId++);
+    return name;
+}
+
+std::string IndexBuilder::segmentPath(const std::string &name) const {
+    return config_.directory + "/" + name;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "manifest.h"
+#include "segment.h"
+
+/**
+* @brief Параметры построителя индекса.
+*/
+struct IndexBuilderConfig {
+    std::string directory = "../index"; //!< Каталог индекса.
+    size_t flushThresholdBytes = 64 * 1024 * 1024; //!< Объем сегмента в памяти до сброса.
+    size_t mergeFactor = 4; //!< Число сегментов одного яруса, объединяемых за раз.
+    size_t checkpointRuns = 4; //!< Число разделов потоков, объединяемых в один сегмент.
+    size_t mergeThreads = 0; //!< Число потоков слияния разделов, 0 - по числу ядер.
+};
+
+class IndexBuilder;
+
+/**
+* @brief Локальный раздел индекса одного рабочего потока.
+* @details Раздел принадлежит одному потоку, поэтому добавление документа не требует
+* блокировок: идентификатор документа выделяется атомарным счетчиком построителя.
+* При превышении порога раздел передается построителю как отсортированный прогон
+* (контрольная точка), и поток продолжает заполнять новый раздел.
+*/
+class IndexPartition {
+public:
+    /**
+    * @brief Конструктор.
+    * @param builder Построитель, которому передаются заполненные прогоны.
+    */
+    explicit IndexPartition(IndexBuilder &builder);
+
+    /**
+    * @brief Деструктор. Передает построителю оставшиеся документы.
+    */
+    ~IndexPartition();
+
+    IndexPartition(const IndexPartition &) = delete;
+    IndexPartition &operator=(const IndexPartition &) = delete;
+
+    /**
+    * @brief Добавить документ в раздел.
+    * @param url URL страницы.
+    * @param terms Слова страницы.
+    */
+    void addDocument(const std::string &url, const TermStorage &terms);
+
+    /**
+    * @brief Передать накопленные документы построителю.
+    */
+    void checkpoint();
+
+private:
+    IndexBuilder &builder_; //!< Построитель индекса.
+    MemSegment segment_; //!< Сегмент раздела в оперативной памяти.
+};
+
+/**
+* @brief Построитель инвертированного индекса в стиле LSM.
+* @details Рабочие потоки накапливают списки вхождений в собственных разделах
+* (IndexPartition). Заполненные разделы копятся как отсортированные прогоны; когда их
+* набирается checkpointRuns (или при сбросе в конце обхода), они параллельно сливаются
+* k-путевым слиянием по словам в один неизменяемый сегмент на диске. Фоновый
+* поток объединяет сегменты по ярусной политике: сегменты группируются по размеру
+* (ярус k - от flushThreshold * mergeFactor^k), и как только в ярусе набирается
+* mergeFactor сегментов, они объединяются в один сегмент следующего яруса.
+* Поиск видит не действующие сегменты, а опубликованный снимок, который заменяется
+* publish в конце обхода. Файлы сегментов, выбывших из действующих при объединении или
+* очистке, удаляются только после того, как они выйдут и из опубликованного снимка.
+*/
+class IndexBuilder {
+public:
+    /**
+    * @brief Конструктор. Открывает существующий индекс или создает новый.
+    * @param config Параметры построителя.
+    */
+    explicit IndexBuilder(const IndexBuilderConfig &config);
+
+    /**
+    * @brief Деструктор. Сбрасывает накопленные данные на диск и дожидается объединения.
+    */
+    ~IndexBuilder();
+
+    /**
+    * @brief Выделить идентификатор для нового документа. Потокобезопасно, без блокировок.
+    */
+    uint32_t nextDocId();
+
+    /**
+    * @brief Получить порог объема раздела в памяти.
+    */
+    size_t partitionThreshold() const;
+
+    /**
+    * @brief Принять заполненный раздел потока как отсортированный прогон.
+    * @details Если накопилось checkpointRuns прогонов, они сливаются в сегмент в
+    * вызывающем потоке.
+    * @param run Прогон.
+    */
+    void submit(MemSegment &&run);
+
+    /**
+    * @brief Слить накопленные прогоны и записать их на диск.
+    * @return false, если сегмент не удалось записать; прогоны остаются в памяти.
+    */
+    bool flush();
+
+    /**
+    * @brief Опубликовать действующие сегменты как новый снимок для поиска.
+    * @details Вызывается после flush в конце обхода, поэтому поиск не видит частично
+    * записанных обходов.
+    */
+    void publish();
+
+    /**
+    * @brief Удалить все сегменты индекса.
+    * @details Опубликованный снимок остается доступным поиску до следующей публикации.
+    */
+    void clear();
+
+private:
+    IndexBuilderConfig config_; //!< Параметры построителя.
+    std::mutex mutex_; //!< Мьютекс для работы с прогонами и манифестом.
+    std::condition_variable mergeCondition_; //!< Условие появления работы для объединения.
+    std::vector<MemSegment> runs_; //!< Прогоны, ожидающие слияния в сегмент.
+    IndexManifest manifest_; //!< Манифест индекса.
+    std::atomic<uint32_t> nextDocId_; //!< Следующий идентификатор документа.
+    std::set<std::string> merging_; //!< Сегменты, участвующие в текущем объединении.
+    std::set<std::string> retired_; //!< Выбывшие сегменты, файлы которых еще не удалены.
+    bool stop_; //!< Условие остановки фонового потока.
+    std::thread mergeThread_; //!< Фоновый поток объединения сегментов.
+
+    /**
+    * @brief Слить прогоны в сегмент, записать его на диск и добавить в манифест.
+    * @details При ошибке записи прогоны возвращаются в накопленные и записываются
+    * следующим flush.
+    * @param runs Прогоны.
+    * @return false, если сегмент не удалось записать.
+    */
+    bool writeRuns(std::vector<MemSegment> &runs);
+
+    /**
+    * @brief Параллельно слить прогоны в один сегмент.
+    * @details Диапазон слов делится на части по числу потоков слияния, каждая часть
+    * сливается независимо, после чего закодированные списки записываются по порядку.
+    * @param runs Прогоны.
+    * @param path Путь к файлу сегмента.
+    * @return false при ошибке записи.
+    */
+    bool mergeRuns(const std::vector<MemSegment> &runs, const std::string &path);
+
+    /**
+    * @brief Сохранить манифест. Вызывается под мьютексом.
+    */
+    void saveManifest();
+
+    /**
+    * @brief Удалить файлы выбывших сегментов, которых нет в опубликованном снимке.
+    * @details Вызывается под мьютексом.
+    */
+    void removeRetired();
+
+    /**
+    * @brief Удалить файлы сегментов, не упомянутых в манифесте.
+    * @details Такие файлы остаются, если построитель завершился, не дождавшись публикации.
+    */
+    void removeOrphans();
+
+    /**
+    * @brief Обработать фоновое объединение сегментов.
+    */
+    void mergeThread();
+
+    /**
+    * @brief Выбрать сегменты для объединения по ярусной политике.
+    * @details Вызывается под мьютексом.
+    * @param inputs Контейнер для записи имен выбранных сегментов.
+    * @return true, если найден ярус с достаточным числом сегментов.
+    */
+    bool pickMerge(std::vector<std::string> &inputs);
+
+    /**
+    * @brief Объединить сегменты в один.
+    * @param inputs Имена объединяемых сегментов.
+    * @param output Имя нового сегмента.
+    * @return false при ошибке чтения или записи.
+    */
+    bool mergeSegments(const std::vector<std::string> &inputs, const std::string &output);
+
+    /**
+    * @brief Получить имя для нового сегмента. Вызывается под мьютексом.
+    */
+    std::string newSegmentName();
+
+    /**
+    * @brief Получить полный путь к файлу сегмента.
+    */
+    std::string segmentPath(const std::string &name) const;
+};
@@ -0,0 +1,574 @@
+#include "index_searcher.h"
+#include "intersection.h"
+#include "manifest.h"
+#include "postings_codec.h"
+#include "query_tree.h"
+#include "../utils/bm25.h"
+#include "../utils/top_k.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+//! Интервал между проверками манифеста, мс.
+const int64_t refreshIntervalMs = 1000;
+
+/**
+* @brief Слово запроса со статистикой коллекции.
+*/
+struct QueryTerm {
+    std::string term; //!< Слово.
+    double idf; //!< Обратная документная частота по всем сегментам.
+};
+
+/**
+* @brief Курсор по списку вхождений слова запроса в одном сегменте.
+*/
+struct TermCursor {
+    PostingCursor cursor; //!< Курсор по списку вхождений.
+    size_t term; //!< Номер слова запроса.
+    double idf; //!< Обратная документная частота слова.
+    double upperBound; //!< Наибольшая оценка слова во всем списке.
+};
+
+/**
+* @brief Перевести сумму оценок BM25 в оценку сверху целочисленной релевантности.
+* @param sum Сумма оценок сверху.
+* @param proximityBound Наибольшая прибавка за близость слов.
+*/
+int scoreBound(double sum, int proximityBound) {
+    return static_cast<int>(std::ceil(sum * bm25::scoreScale)) + proximityBound;
+}
+
+/**
+* @brief Найти лучшие страницы сегмента методом Block-Max WAND.
+* @details Курсоры упорядочиваются по текущему документу. Опорный документ - первый, на
+* котором сумма оценок сверху слов, чьи курсоры до него дошли, может попасть в top.
+* Документы левее опорного пропускаются. Если и сумма оценок по заголовкам текущих блоков
+* не проходит порог, пропускается все до конца ближайшего из этих блоков. Иначе документ
+* оценивается полностью.
+* @param reader Сегмент.
+* @param terms Слова запроса.
+* @param averageLength Средняя длина документа в коллекции.
+* @param top Накопитель лучших страниц, общий для всех сегментов.
+*/
+void searchSegment(const SegmentReader &reader, const std::vector<QueryTerm> &terms,
+        double averageLength, TopK<std::string> &top) {
+    std::vector<TermCursor> cursors;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const DictEntry *entry = reader.findTerm(terms[i].term);
+        if (!entry) {
+            continue;
+        }
+        TermCursor cursor {reader.cursor(*entry), i, terms[i].idf, 0};
+        cursor.upperBound = cursor.idf * bm25::termWeight(cursor.cursor.maxImpact(),
+                cursor.cursor.minLength(), averageLength);
+        cursors.push_back(std::move(cursor));
+    }
+    // Прибавка за близость возможна, только если в запросе больше одного слова.
+    const int proximityBound = terms.size() > 1 ? maxProximityBonus : 0;
+
+    std::vector<TermCursor *> order;
+    for (auto &cursor : cursors) {
+        order.push_back(&cursor);
+    }
+
+    while (true) {
+        order.erase(std::remove_if(order.begin(), order.end(),
+                            [](const TermCursor *cursor) { return !cursor->cursor.valid(); }),
+                order.end());
+        std::sort(order.begin(), order.end(), [](const TermCursor *lhs, const TermCursor *rhs) {
+            return lhs->cursor.docId() < rhs->cursor.docId();
+        });
+
+        double sum = 0;
+        size_t pivot = order.size();
+        for (size_t i = 0; i < order.size(); ++i) {
+            sum += order[i]->upperBound;
+            if (top.accepts(scoreBound(sum, proximityBound))) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) {
+            break;
+        }
+        const uint32_t pivotDoc = order[pivot]->cursor.docId();
+        while (pivot + 1 < order.size() && order[pivot + 1]->cursor.docId() == pivotDoc) {
+            ++pivot;
+        }
+
+        if (order.front()->cursor.docId() != pivotDoc) {
+            for (size_t i = 0; i < pivot; ++i) {
+                order[i]->cursor.advance(pivotDoc);
+            }
+            continue;
+        }
+
+        double blockSum = 0;
+        uint32_t nextDoc = pivot + 1 < order.size() ? order[pivot + 1]->cursor.docId()
+                                                    : PostingCursor::noMoreDocs;
+        for (size_t i = 0; i <= pivot; ++i) {
+            const PostingCursor &cursor = order[i]->cursor;
+            blockSum += order[i]->idf * bm25::termWeight(cursor.blockMaxImpact(),
+                    cursor.blockMinLength(), averageLength);
+            if (cursor.blockLastDocId() < PostingCursor::noMoreDocs) {
+                nextDoc = std::min(nextDoc, cursor.blockLastDocId() + 1);
+            }
+        }
+        if (!top.accepts(scoreBound(blockSum, proximityBound))) {
+            for (size_t i = 0; i <= pivot; ++i) {
+                order[i]->cursor.advance(nextDoc);
+            }
+            continue;
+        }
+
+        const DocInfo *doc = reader.findDoc(pivotDoc);
+        const uint32_t length = doc ? doc->length : 0;
+        double score = 0;
+        for (size_t i = 0; i <= pivot; ++i) {
+            score += order[i]->idf *
+                    bm25::termWeight(order[i]->cursor.impact(), length, averageLength);
+        }
+        int relevance = static_cast<int>(std::lround(score * bm25::scoreScale));
+        if (doc && top.accepts(relevance + proximityBound)) {
+            if (proximityBound > 0) {
+                std::vector<PositionList> positions(terms.size());
+                for (size_t i = 0; i <= pivot; ++i) {
+                    positions[order[i]->term] = decodePositions(order[i]->cursor.positions());
+                }
+                relevance += proximityBonus(positions);
+            }
+            top.push(relevance, doc->url);
+        }
+
+        for (size_t i = 0; i <= pivot; ++i) {
+            order[i]->cursor.next();
+        }
+    }
+}
+
+//! Сегменты набора по имени.
+typedef std::map<std::string, std::shared_ptr<const SegmentReader> > Segments;
+
+/**
+* @brief Получить слова запроса со статистикой коллекции.
+* @details Повторяющееся слово учитывается один раз, слова, которых нет в индексе,
+* отбрасываются. Документная частота слова - сумма по сегментам: каждый документ лежит
+* ровно в одном.
+* @param segments Сегменты.
+* @param docCount Число документов во всех сегментах.
+* @param words Нормализованные слова запроса.
+*/
+std::vector<QueryTerm> collectTerms(const Segments &segments, uint64_t docCount,
+        const std::vector<std::string> &words) {
+    std::vector<std::string> distinct(words);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+    std::vector<QueryTerm> terms;
+    for (const auto &word : distinct) {
+        uint64_t docFreq = 0;
+        for (const auto &segment : segments) {
+            const DictEntry *entry = segment.second->findTerm(word);
+            docFreq += entry ? entry->docFreq : 0;
+        }
+        if (docFreq > 0) {
+            terms.push_back(QueryTerm {word, bm25::idf(docCount, docFreq)});
+        }
+    }
+    return terms;
+}
+
+/**
+* @brief Упорядочить непустые сегменты по возрастанию идентификаторов документов.
+* @details В этом порядке страницы с равной релевантностью выдаются в порядке индексации.
+* @param segments Сегменты.
+*/
+std::vector<const SegmentReader *> orderSegments(const Segments &segments) {
+    std::vector<const SegmentReader *> ordered;
+    for (const auto &segment : segments) {
+        if (!segment.second->docs().empty()) {
+            ordered.push_back(segment.second.get());
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(),
+            [](const SegmentReader *lhs, const SegmentReader *rhs) {
+                return lhs->docs().front().docId < rhs->docs().front().docId;
+            });
+    return ordered;
+}
+
+/**
+* @brief Получить документы сегмента, содержащие слово.
+* @param reader Сегмент.
+* @param word Слово.
+*/
+DocIdList termDocs(const SegmentReader &reader, const std::string &word) {
+    DocIdList docs;
+    const DictEntry *entry = reader.findTerm(word);
+    if (entry) {
+        docs.reserve(entry->docFreq);
+        for (PostingCursor cursor = reader.cursor(*entry); cursor.valid(); cursor.next()) {
+            docs.push_back(cursor.docId());
+        }
+    }
+    return docs;
+}
+
+/**
+* @brief Пересечь списки документов, начиная с самых коротких.
+* @param lists Списки документов.
+*/
+DocIdList intersectAll(std::vector<DocIdList> lists) {
+    if (lists.empty()) {
+        return DocIdList();
+    }
+    std::sort(lists.begin(), lists.end(), [](const DocIdList &lhs, const DocIdList &rhs) {
+        return lhs.size() < rhs.size();
+    });
+    DocIdList docs = std::move(lists.front());
+    for (size_t i = 1; i < lists.size() && !docs.empty(); ++i) {
+        docs = intersectDocIds(docs, lists[i]);
+    }
+    return docs;
+}
+
+/**
+* @brief Получить документы сегмента, содержащие фразу.
+* @details Сначала пересекаются списки документов слов фразы, затем позиции слов
+* проверяются только в документах пересечения.
+* @param reader Сегмент.
+* @param phrase Узел фразы.
+*/
+DocIdList phraseDocs(const SegmentReader &reader, const QueryNode &phrase) {
+    std::vector<DocIdList> lists;
+    for (const auto &word : phrase.words) {
+        lists.push_back(termDocs(reader, word));
+    }
+    DocIdList candidates = intersectAll(std::move(lists));
+    if (candidates.empty()) {
+        return candidates;
+    }
+
+    std::vector<PostingCursor> cursors;
+    for (const auto &word : phrase.words) {
+        cursors.push_back(reader.cursor(*reader.findTerm(word)));
+    }
+    DocIdList docs;
+    std::vector<PositionList> positions(cursors.size());
+    for (uint32_t docId : candidates) {
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            cursors[i].advance(docId);
+            positions[i] = decodePositions(cursors[i].positions());
+        }
+        if (countPhraseMatches(positions, phrase.offsets) > 0) {
+            docs.push_back(docId);
+        }
+    }
+    return docs;
+}
+
+/**
+* @brief Отобрать документы по сайту из запроса site:.
+* @param reader Сегмент.
+* @param docs Документы-кандидаты.
+* @param site Хост сайта.
+* @param keep true - оставить документы сайта, false - исключить их.
+*/
+DocIdList filterSite(const SegmentReader &reader, const DocIdList &docs,
+        const std::string &site, bool keep) {
+    DocIdList filtered;
+    for (uint32_t docId : docs) {
+        const DocInfo *doc = reader.findDoc(docId);
+        if (doc && matchesSite(urlHost(doc->url), site) == keep) {
+            filtered.push_back(docId);
+        }
+    }
+    return filtered;
+}
+
+/**
+* @brief Получить документы сегмента, подходящие под запрос.
+* @details Списки документов узлов AND пересекаются от коротких к длинным, затем из
+* пересечения вычитаются документы узлов NOT; списки узлов OR объединяются. Индекса по
+* хостам нет, поэтому условия site: внутри AND проверяются только на кандидатах,
+* найденных по словам; перебор всех документов сегмента остается для site: вне AND
+* со словами.
+* @param reader Сегмент.
+* @param query Дерево запроса.
+*/
+DocIdList matchDocs(const SegmentReader &reader, const QueryNode &query) {
+    switch (query.type) {
+        case QUERY_TERM:
+            return termDocs(reader, query.value);
+        case QUERY_PHRASE:
+            return phraseDocs(reader, query);
+        case QUERY_SITE: {
+            DocIdList docs;
+            for (const auto &doc : reader.docs()) {
+                if (matchesSite(urlHost(doc.url), query.value)) {
+                    docs.push_back(doc.docId);
+                }
+            }
+            return docs;
+        }
+        case QUERY_AND: {
+            std::vector<DocIdList> lists;
+            std::vector<const QueryNode *> sites;
+            for (const auto &child : query.children) {
+                if (child.type == QUERY_SITE) {
+                    sites.push_back(&child);
+                } else if (child.type != QUERY_NOT) {
+                    lists.push_back(matchDocs(reader, child));
+                }
+            }
+            if (lists.empty() && !sites.empty()) {
+                lists.push_back(matchDocs(reader, *sites.front()));
+                sites.erase(sites.begin());
+            }
+            DocIdList docs = intersectAll(std::move(lists));
+            for (const QueryNode *site : sites) {
+                docs = filterSite(reader, docs, site->value, true);
+            }
+            for (const auto &child : query.children) {
+                if (child.type != QUERY_NOT || docs.empty() || child.children.empty()) {
+                    continue;
+                }
+                const QueryNode &excluded = child.children.front();
+                if (excluded.type == QUERY_SITE) {
+                    docs = filterSite(reader, docs, excluded.value, false);
+                } else {
+                    docs = subtractDocIds(docs, matchDocs(reader, excluded));
+                }
+            }
+            return docs;
+        }
+        case QUERY_OR: {
+            DocIdList docs;
+            for (const auto &child : query.children) {
+                docs = uniteDocIds(docs, matchDocs(reader, child));
+            }
+            return docs;
+        }
+        case QUERY_NOT:
+            // Исключение без слов, из которых исключать, не находит ничего.
+            break;
+    }
+    return DocIdList();
+}
+
+/**
+* @brief Оценить найденные документы сегмента.
+* @details Релевантность считается так же, как в searchSegment: BM25 по словам запроса
+* вне NOT с прибавкой за близость слов.
+* @param reader Сегмент.
+* @param docs Документы, подходящие под запрос.
+* @param terms Слова запроса вне NOT.
+* @param averageLength Средняя длина документа в коллекции.
+* @param top Накопитель лучших страниц, общий для всех сегментов.
+*/
+void scoreDocs(const SegmentReader &reader, const DocIdList &docs,
+        const std::vector<QueryTerm> &terms, double averageLength, TopK<std::string> &top) {
+    std::vector<TermCursor> cursors;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const DictEntry *entry = reader.findTerm(terms[i].term);
+        if (entry) {
+            cursors.push_back(TermCursor {reader.cursor(*entry), i, terms[i].idf, 0});
+        }
+    }
+    const int proximityBound = terms.size() > 1 ? maxProximityBonus : 0;
+
+    for (uint32_t docId : docs) {
+        const DocInfo *doc = reader.findDoc(docId);
+        if (!doc) {
+            continue;
+        }
+        double score = 0;
+        for (auto &cursor : cursors) {
+            cursor.cursor.advance(docId);
+            if (cursor.cursor.valid() && cursor.cursor.docId() == docId) {
+                score += cursor.idf *
+                        bm25::termWeight(cursor.cursor.impact(), doc->length, averageLength);
+            }
+        }
+        int relevance = static_cast<int>(std::lround(score * bm25::scoreScale));
+        if (!top.accepts(relevance + proximityBound)) {
+            continue;
+        }
+        if (proximityBound > 0) {
+            std::vector<PositionList> positions(terms.size());
+            for (const auto &cursor : cursors) {
+                if (cursor.cursor.valid() && cursor.cursor.docId() == docId) {
+                    positions[cursor.term] = decodePositions(cursor.cursor.positions());
+                }
+            }
+            relevance += proximityBonus(positions);
+        }
+        top.push(relevance, doc->url);
+    }
+}
+
+} // namespace
+
+IndexSearcher::IndexSearcher(const std::string &directory) :
+directory_(directory),
+snapshot_(std::make_unique<Snapshot>()),
+refreshMutex_(),
+refreshListener_(),
+resultLimit_(0),
+stopMutex_(),
+stopCondition_(),
+stop_(false),
+refreshThread_() {
+    refresh();
+    refreshThread_ = std::thread(&IndexSearcher::refreshLoop, this);
+}
+
+IndexSearcher::~IndexSearcher() {
+    {
+        std::unique_lock<std::mutex> lock(stopMutex_);
+        stop_ = true;
+    }
+    stopCondition_.notify_all();
+    if (refreshThread_.joinable()) {
+        refreshThread_.join();
+    }
+}
+
+bool IndexSearcher::refresh() {
+    std::unique_lock<std::mutex> lock(refreshMutex_);
+
+    IndexManifest manifest;
+    if (!manifest.load(directory_)) {
+        std::cerr << "IndexSearcher::refresh: Error: can't read manifest in " << directory_
+                  << std::endl;
+        return false;
+    }
+
+    auto current = snapshot_.read();
+    if (current->loaded && current->generation == manifest.snapshot) {
+        return true;
+    }
+
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->generation = manifest.snapshot;
+    snapshot->loaded = true;
+    for (const auto &name : manifest.published) {
+        auto it = current->segments.find(name);
+        std::shared_ptr<const SegmentReader> segment;
+        if (it != current->segments.end()) {
+            segment = it->second;
+        } else {
+            auto reader = std::make_shared<SegmentReader>();
+            if (!reader->open(directory_ + "/" + name)) {
+                // Сегмент мог быть удален после следующей публикации, попробуем при
+                // следующей проверке.
+                return false;
+            }
+            segment = reader;
+        }
+        snapshot->segments[name] = segment;
+        snapshot->docCount += segment->docs().size();
+        snapshot->totalLength += segment->totalLength();
+    }
+
+    const uint64_t generation = snapshot->generation;
+    const size_t segments = snapshot->segments.size();
+    snapshot_.publish(std::move(snapshot));
+
+    std::cout << "IndexSearcher::refresh: snapshot " << generation << ", " << segments
+              << " segments" << std::endl;
+    if (refreshListener_) {
+        refreshListener_(generation);
+    }
+    return true;
+}
+
+void IndexSearcher::refreshLoop() {
+    std::unique_lock<std::mutex> lock(stopMutex_);
+    while (!stopCondition_.wait_for(lock, std::chrono::milliseconds(refreshIntervalMs),
+            [this]() { return stop_; })) {
+        lock.unlock();
+        refresh();
+        {
+            // Наборы, замененные раньше, освобождаются, когда их дочитают запросы.
+            std::unique_lock<std::mutex> refreshLock(refreshMutex_);
+            snapshot_.reclaim();
+        }
+        lock.lock();
+    }
+}
+
+void IndexSearcher::setResultLimit(size_t limit) {
+    resultLimit_ = limit;
+}
+
+void IndexSearcher::setRefreshListener(std::function<void(uint64_t)> listener) {
+    std::unique_lock<std::mutex> lock(refreshMutex_);
+    refreshListener_ = std::move(listener);
+}
+
+void IndexSearcher::search(SearchResults &results, const QueryNode &query) {
+    std::vector<std::string> words;
+    if (isWordsQuery(query, words)) {
+        searchWords(results, words);
+        return;
+    }
+
+    auto snapshot = snapshot_.read();
+    std::vector<std::string> positive;
+    std::vector<std::string> all;
+    collectQueryWords(query, positive, all);
+    const std::vector<QueryTerm> terms =
+            collectTerms(snapshot->segments, snapshot->docCount, positive);
+    const double averageLength = snapshot->docCount == 0 ? 0 :
+            static_cast<double>(snapshot->totalLength) / snapshot->docCount;
+
+    TopK<std::string> top(resultLimit_);
+    for (const SegmentReader *segment : orderSegments(snapshot->segments)) {
+        const DocIdList docs = matchDocs(*segment, query);
+        if (!docs.empty()) {
+            scoreDocs(*segment, docs, terms, averageLength, top);
+        }
+    }
+    for (auto &val : top.take()) {
+        results.push_back(SearchResult {val.first, std::move(val.second)});
+    }
+
+    std::cout << "IndexSearcher::search: sucsess" << std::endl;
+}
+
+void IndexSearcher::searchWords(SearchResults &results, const std::vector<std::string> &words) {
+    auto snapshot = snapshot_.read();
+    const std::vector<QueryTerm> terms =
+            collectTerms(snapshot->segments, snapshot->docCount, words);
+    const double averageLength = snapshot->docCount == 0 ? 0 :
+            static_cast<double>(snapshot->totalLength) / snapshot->docCount;
+
+    TopK<std::string> top(resultLimit_);
+    if (!terms.empty()) {
+        for (const SegmentReader *segment : orderSegments(snapshot->segments)) {
+            searchSegment(*segment, terms, averageLength, top);
+        }
+    }
+    for (auto &val : top.take()) {
+        results.push_back(SearchResult {val.first, std::move(val.second)});
+    }
+
+    std::cout << "IndexSearcher::searchWords: sucsess" << std::endl;
+}
+
+void IndexSearcher::forEachTerm(const TermConsumer &consumer) {
+    auto snapshot = snapshot_.read();
+    for (const auto &val : snapshot->segments) {
+        for (const auto &entry : val.second->dictionary()) {
+            consumer(entry.term,
+                    entry.surface.form.empty() ? entry.term : entry.surface.form,
+                    entry.docFreq);
+        }
+    }
+}
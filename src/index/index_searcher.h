@@ -0,0 +1,117 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "proximity.h"
+#include "segment.h"
+#include "../common_data.h"
+#include "../utils/rcu_pointer.h"
+
+/**
+* @brief Поиск по сегментам индекса, построенного IndexBuilder.
+* @details Читает манифест и открывает сегменты опубликованного снимка. Фоновый поток раз
+* в секунду проверяет, не опубликован ли новый снимок, и подменяет набор сегментов через
+* RcuPointer: запросы берут текущий набор без блокировок, выполняющиеся в момент
+* обновления дорабатывают со старым, а старый набор освобождается после последнего из них.
+*/
+class IndexSearcher {
+public:
+    /**
+    * @brief Конструктор.
+    * @param directory Каталог индекса.
+    */
+    explicit IndexSearcher(const std::string &directory);
+
+    /**
+    * @brief Деструктор. Останавливает фоновый поток.
+    */
+    ~IndexSearcher();
+
+    IndexSearcher(const IndexSearcher &) = delete;
+    IndexSearcher &operator=(const IndexSearcher &) = delete;
+
+    /**
+    * @brief Перечитать манифест и открыть сегменты нового опубликованного снимка.
+    * @return false, если манифест или один из сегментов не удалось прочитать.
+    */
+    bool refresh();
+
+    /**
+    * @brief Установить обработчик перехода на новый снимок.
+    * @details Вызывается из фонового потока после того, как запросы начинают видеть новый
+    * набор сегментов.
+    * @param listener Обработчик, получает номер нового снимка.
+    */
+    void setRefreshListener(std::function<void(uint64_t)> listener);
+
+    /**
+    * @brief Установить число лучших страниц в результатах поиска, 0 - без ограничения.
+    * @details Устанавливается до начала поиска.
+    */
+    void setResultLimit(size_t limit);
+
+    /**
+    * @brief Найти страницы, подходящие под дерево запроса.
+    * @details Запрос из слов, объединенных OR, выполняется searchWords. Иначе в каждом
+    * сегменте вычисляется список подходящих документов: списки слов пересекаются,
+    * объединяются и вычитаются по дереву, фразы проверяются по позициям. Подходящие
+    * документы оцениваются так же, как в searchWords, по словам вне NOT.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param query Дерево запроса.
+    */
+    void search(SearchResults &results, const QueryNode &query);
+
+    /**
+    * @brief Найти страницы, содержащие хотя бы одно из слов.
+    * @details Релевантность - оценка BM25 по статистике всех сегментов с прибавкой за
+    * близость слов друг к другу. Документы перебираются методом Block-Max WAND: документ
+    * и целые блоки списков вхождений пропускаются, если оценка сверху по наибольшим
+    * вкладам не позволяет им попасть в resultLimit лучших.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param words Нормализованные слова запроса.
+    */
+    void searchWords(SearchResults &results, const std::vector<std::string> &words);
+
+    /**
+    * @brief Перебрать слова текущего снимка с формами и документными частотами.
+    * @details Слова передаются отдельно по каждому сегменту вместе с самой частой в
+    * сегменте формой.
+    * @param consumer Обработчик слова, его формы и документной частоты в сегменте.
+    */
+    void forEachTerm(const TermConsumer &consumer);
+
+private:
+    /**
+    * @brief Набор сегментов опубликованного снимка. Не изменяется после публикации.
+    */
+    struct Snapshot {
+        uint64_t generation = 0; //!< Номер снимка.
+        bool loaded = false; //!< Снимок прочитан из манифеста (номер может быть 0).
+        std::map<std::string, std::shared_ptr<const SegmentReader> > segments; //!< Сегменты.
+        uint64_t docCount = 0; //!< Число документов во всех сегментах.
+        uint64_t totalLength = 0; //!< Суммарная длина документов во всех сегментах.
+    };
+
+    std::string directory_; //!< Каталог индекса.
+    RcuPointer<Snapshot> snapshot_; //!< Текущий набор сегментов.
+    //! Мьютекс обновления: набор сегментов заменяет только один поток.
+    std::mutex refreshMutex_;
+    std::function<void(uint64_t)> refreshListener_; //!< Обработчик нового снимка.
+    size_t resultLimit_; //!< Число лучших страниц в результатах поиска.
+    std::mutex stopMutex_; //!< Мьютекс для остановки фонового потока.
+    std::condition_variable stopCondition_; //!< Условие остановки фонового потока.
+    bool stop_; //!< Флаг остановки фонового потока.
+    std::thread refreshThread_; //!< Фоновый поток проверки манифеста.
+
+    /**
+    * @brief Цикл фонового потока: проверка манифеста и освобождение старых наборов.
+    */
+    void refreshLoop();
+};
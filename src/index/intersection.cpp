@@ -0,0 +1,145 @@
+#include "intersection.h"
+
+#include <algorithm>
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+//! Отношение длин списков, начиная с которого короткий список ищется в длинном.
+const size_t gallopingRatio = 32;
+
+/**
+* @brief Пересечь короткий список с длинным экспоненциальным поиском.
+* @param small Короткий список.
+* @param large Длинный список.
+* @param result Список для записи пересечения.
+*/
+void intersectGalloping(const DocIdList &small, const DocIdList &large, DocIdList &result) {
+    size_t begin = 0;
+    for (uint32_t docId : small) {
+        // Удваиваем шаг, пока не перешагнем искомый документ, затем ищем двоичным поиском.
+        size_t step = 1;
+        while (begin + step < large.size() && large[begin + step] < docId) {
+            step *= 2;
+        }
+        const size_t end = std::min(large.size(), begin + step + 1);
+        begin = std::lower_bound(large.begin() + begin + step / 2, large.begin() + end, docId) -
+                large.begin();
+        if (begin == large.size()) {
+            return;
+        }
+        if (large[begin] == docId) {
+            result.push_back(docId);
+        }
+    }
+}
+
+/**
+* @brief Слить хвосты списков сравнимой длины.
+* @param lhs Первый список.
+* @param i Начало хвоста первого списка.
+* @param rhs Второй список.
+* @param j Начало хвоста второго списка.
+* @param result Список для записи пересечения.
+*/
+void intersectMerge(const DocIdList &lhs, size_t i, const DocIdList &rhs, size_t j,
+        DocIdList &result) {
+    while (i < lhs.size() && j < rhs.size()) {
+        if (lhs[i] < rhs[j]) {
+            ++i;
+        } else if (rhs[j] < lhs[i]) {
+            ++j;
+        } else {
+            result.push_back(lhs[i]);
+            ++i;
+            ++j;
+        }
+    }
+}
+
+/**
+* @brief Пересечь списки сравнимой длины.
+* @param lhs Первый список.
+* @param rhs Второй список.
+* @param result Список для записи пересечения.
+*/
+void intersectBlocks(const DocIdList &lhs, const DocIdList &rhs, DocIdList &result) {
+    size_t i = 0;
+    size_t j = 0;
+#ifdef __SSE2__
+    // Пересечение не длиннее левого списка; запас в 4 элемента - для записи без проверок.
+    const size_t begin = result.size();
+    result.resize(begin + lhs.size() + 4);
+    uint32_t *out = result.data() + begin;
+    size_t count = 0;
+    while (i + 4 <= lhs.size() && j + 4 <= rhs.size()) {
+        const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&lhs[i]));
+        const __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&rhs[j]));
+        // Каждый элемент левого блока сравнивается со всеми элементами правого: правый
+        // блок сравнивается без сдвига и с циклическими сдвигами на 1, 2 и 3 элемента.
+        const __m128i equal = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(left, right),
+                        _mm_cmpeq_epi32(left, _mm_shuffle_epi32(right, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm_or_si128(
+                        _mm_cmpeq_epi32(left, _mm_shuffle_epi32(right, _MM_SHUFFLE(1, 0, 3, 2))),
+                        _mm_cmpeq_epi32(left, _mm_shuffle_epi32(right, _MM_SHUFFLE(2, 1, 0, 3)))));
+        // Совпадения записываются без ветвлений: позиция записи сдвигается только
+        // для совпавших элементов.
+        const int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        for (size_t k = 0; k < 4; ++k) {
+            out[count] = lhs[i + k];
+            count += (mask >> k) & 1;
+        }
+
+        // Блок, закончившийся раньше, больше ни с чем не совпадет.
+        const uint32_t leftLast = lhs[i + 3];
+        const uint32_t rightLast = rhs[j + 3];
+        if (leftLast <= rightLast) {
+            i += 4;
+        }
+        if (rightLast <= leftLast) {
+            j += 4;
+        }
+    }
+    result.resize(begin + count);
+#endif
+    intersectMerge(lhs, i, rhs, j, result);
+}
+
+} // namespace
+
+DocIdList intersectDocIds(const DocIdList &lhs, const DocIdList &rhs) {
+    const DocIdList &small = lhs.size() <= rhs.size() ? lhs : rhs;
+    const DocIdList &large = lhs.size() <= rhs.size() ? rhs : lhs;
+
+    DocIdList result;
+    if (small.empty()) {
+        return result;
+    }
+    result.reserve(small.size());
+    if (large.size() / small.size() >= gallopingRatio) {
+        intersectGalloping(small, large, result);
+    } else {
+        intersectBlocks(small, large, result);
+    }
+    return result;
+}
+
+DocIdList uniteDocIds(const DocIdList &lhs, const DocIdList &rhs) {
+    DocIdList result;
+    result.reserve(lhs.size() + rhs.size());
+    std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+    return result;
+}
+
+DocIdList subtractDocIds(const DocIdList &lhs, const DocIdList &rhs) {
+    DocIdList result;
+    result.reserve(lhs.size());
+    std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+            std::back_inserter(result));
+    return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//! Список идентификаторов документов по возрастанию без повторов.
+typedef std::vector<uint32_t> DocIdList;
+
+/**
+* @brief Найти документы, входящие в оба списка.
+* @details Если один список короче другого в десятки раз, каждый его элемент ищется
+* в длинном списке экспоненциальным (galloping) поиском от позиции предыдущего найденного,
+* и время зависит в основном от длины короткого списка. Списки сравнимой длины сливаются
+* блоками по 4 элемента: с SSE2 каждый блок одного списка сравнивается со всеми
+* сдвигами блока другого за 4 векторных сравнения.
+* @param lhs Первый список.
+* @param rhs Второй список.
+* @return Пересечение списков.
+*/
+DocIdList intersectDocIds(const DocIdList &lhs, const DocIdList &rhs);
+
+/**
+* @brief Найти документы, входящие хотя бы в один из списков.
+* @param lhs Первый список.
+* @param rhs Второй список.
+* @return Объединение списков.
+*/
+DocIdList uniteDocIds(const DocIdList &lhs, const DocIdList &rhs);
+
+/**
+* @brief Найти документы первого списка, не входящие во второй.
+* @param lhs Первый список.
+* @param rhs Второй список.
+* @return Разность списков.
+*/
+DocIdList subtractDocIds(const DocIdList &lhs, const DocIdList &rhs);
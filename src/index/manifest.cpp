@@ -0,0 +1,88 @@
+#include "manifest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+//! Имя файла манифеста в каталоге индекса.
+const char manifestName[] = "MANIFEST";
+
+} // namespace
+
+bool IndexManifest::load(const std::string &directory) {
+    std::ifstream file(directory + "/" + manifestName);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    IndexManifest manifest;
+    bool hasSnapshot = false;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if (key == "generation") {
+            ss >> manifest.generation;
+        } else if (key == "nextDocId") {
+            ss >> manifest.nextDocId;
+        } else if (key == "nextSegmentId") {
+            ss >> manifest.nextSegmentId;
+        } else if (key == "segment") {
+            std::string name;
+            ss >> name;
+            manifest.segments.push_back(name);
+        } else if (key == "snapshot") {
+            ss >> manifest.snapshot;
+            hasSnapshot = true;
+        } else if (key == "published") {
+            std::string name;
+            ss >> name;
+            manifest.published.push_back(name);
+        } else if (!key.empty()) {
+            std::cerr << "IndexManifest::load: Error: unknown key " << key << std::endl;
+            return false;
+        }
+    }
+
+    if (!hasSnapshot) {
+        manifest.snapshot = manifest.generation;
+        manifest.published = manifest.segments;
+    }
+    *this = manifest;
+    return true;
+}
+
+bool IndexManifest::save(const std::string &directory) const {
+    const std::string path = directory + "/" + manifestName;
+    const std::string tmpPath = path + ".tmp";
+
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << "generation " << generation << "\n";
+        file << "nextDocId " << nextDocId << "\n";
+        file << "nextSegmentId " << nextSegmentId << "\n";
+        for (const auto &segment : segments) {
+            file << "segment " << segment << "\n";
+        }
+        file << "snapshot " << snapshot << "\n";
+        for (const auto &segment : published) {
+            file << "published " << segment << "\n";
+        }
+        file.close();
+        if (file.fail()) {
+            std::cerr << "IndexManifest::save: Error: can't write " << tmpPath << std::endl;
+            return false;
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "IndexManifest::save: Error: can't rename " << tmpPath << std::endl;
+        return false;
+    }
+
+    return true;
+}
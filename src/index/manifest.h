@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+* @brief Манифест индекса.
+* @details Хранит список действующих сегментов, в которые пишет построитель, список
+* сегментов опубликованного снимка, который видит поиск, и счетчики идентификаторов.
+* Записывается во временный файл и атомарно переименовывается, поэтому читатель всегда
+* видит согласованные списки сегментов.
+*/
+struct IndexManifest {
+    uint64_t generation = 0; //!< Номер версии манифеста, растет при каждом изменении.
+    uint32_t nextDocId = 1; //!< Следующий свободный идентификатор документа.
+    uint32_t nextSegmentId = 1; //!< Следующий свободный номер сегмента.
+    std::vector<std::string> segments; //!< Имена файлов действующих сегментов.
+    uint64_t snapshot = 0; //!< Номер опубликованного снимка, растет при каждой публикации.
+    std::vector<std::string> published; //!< Имена файлов сегментов опубликованного снимка.
+
+    /**
+    * @brief Прочитать манифест из каталога индекса.
+    * @param directory Каталог индекса.
+    * @details В манифесте без снимка, записанном до появления публикации, опубликованными
+    * считаются все действующие сегменты.
+    * @return false, если манифест отсутствует или поврежден.
+    */
+    bool load(const std::string &directory);
+
+    /**
+    * @brief Записать манифест в каталог индекса.
+    * @param directory Каталог индекса.
+    * @return false при ошибке записи.
+    */
+    bool save(const std::string &directory) const;
+};
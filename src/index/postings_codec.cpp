@@ -0,0 +1,106 @@
+#include "postings_codec.h"
+
+namespace {
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+} // namespace
+
+void appendVarint(std::string &out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool readVarint(const char *&cursor, const char *end, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && cursor < end; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(*cursor++);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string encodePositions(const std::vector<uint32_t> &positions) {
+    std::string out;
+    out.reserve(positions.size() + 4);
+
+    appendVarint(out, static_cast<uint32_t>(positions.size()));
+    uint32_t previous = 0;
+    for (uint32_t position : positions) {
+        appendVarint(out, position - previous);
+        previous = position;
+    }
+
+    return out;
+}
+
+std::vector<uint32_t> decodePositions(const std::string &data) {
+    std::vector<uint32_t> positions;
+    const char *cursor = data.data();
+    const char *end = cursor + data.size();
+
+    uint32_t count = 0;
+    if (!readVarint(cursor, end, count)) {
+        return positions;
+    }
+
+    positions.reserve(count);
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t delta = 0;
+        if (!readVarint(cursor, end, delta)) {
+            break;
+        }
+        position += delta;
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+std::string toHex(const std::string &data) {
+    static const char digits[] = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(data.size() * 2);
+    for (unsigned char c : data) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0x0F];
+    }
+
+    return hex;
+}
+
+std::string fromHex(const std::string &hex) {
+    std::string data;
+    data.reserve(hex.size() / 2);
+
+    size_t i = (hex.compare(0, 2, "\\x") == 0) ? 2 : 0;
+    for (; i + 1 < hex.size(); i += 2) {
+        const int high = hexValue(hex[i]);
+        const int low = hexValue(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            break;
+        }
+        data += static_cast<char>((high << 4) | low);
+    }
+
+    return data;
+}
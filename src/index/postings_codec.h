@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+* @brief Дописать число в формате varint (7 бит на байт, старший бит - признак продолжения).
+* @param out Буфер для записи.
+* @param value Число.
+*/
+void appendVarint(std::string &out, uint32_t value);
+
+/**
+* @brief Прочитать число в формате varint.
+* @param cursor Указатель на текущий байт. Сдвигается за прочитанное число.
+* @param end Конец буфера.
+* @param value Прочитанное число.
+* @return false, если буфер закончился раньше числа.
+*/
+bool readVarint(const char *&cursor, const char *end, uint32_t &value);
+
+/**
+* @brief Закодировать возрастающую последовательность позиций разностями в формате varint.
+* @param positions Позиции слова в документе в порядке возрастания.
+* @return Закодированный блок.
+*/
+std::string encodePositions(const std::vector<uint32_t> &positions);
+
+/**
+* @brief Раскодировать блок позиций.
+* @param data Блок, полученный из encodePositions.
+* @return Позиции слова в порядке возрастания.
+*/
+std::vector<uint32_t> decodePositions(const std::string &data);
+
+/**
+* @brief Представить двоичные данные в виде шестнадцатеричной строки.
+* @details Используется для передачи bytea в PostgreSql через encode/decode(..., 'hex').
+*/
+std::string toHex(const std::string &data);
+
+/**
+* @brief Преобразовать шестнадцатеричную строку в двоичные данные.
+*/
+std::string fromHex(const std::string &hex);
@@ -0,0 +1,93 @@
+#include "proximity.h"
+
+#include <algorithm>
+
+size_t countPhraseMatches(const std::vector<PositionList> &positions,
+        const std::vector<uint32_t> &offsets) {
+    if (positions.empty() || positions.size() != offsets.size()) {
+        return 0;
+    }
+
+    std::vector<size_t> cursors(positions.size(), 0);
+    size_t matches = 0;
+
+    for (uint32_t first : positions[0]) {
+        if (first < offsets[0]) {
+            continue;
+        }
+        const uint32_t start = first - offsets[0];
+
+        bool matched = true;
+        for (size_t i = 1; i < positions.size() && matched; ++i) {
+            const uint32_t expected = start + offsets[i];
+            const PositionList &list = positions[i];
+            size_t &cursor = cursors[i];
+            while (cursor < list.size() && list[cursor] < expected) {
+                ++cursor;
+            }
+            matched = cursor < list.size() && list[cursor] == expected;
+        }
+
+        if (matched) {
+            ++matches;
+        }
+    }
+
+    return matches;
+}
+
+uint32_t minCoverWindow(const std::vector<PositionList> &positions) {
+    if (positions.empty()) {
+        return 0;
+    }
+    for (const auto &list : positions) {
+        if (list.empty()) {
+            return 0;
+        }
+    }
+
+    std::vector<size_t> cursors(positions.size(), 0);
+    uint32_t best = UINT32_MAX;
+
+    while (true) {
+        size_t minIndex = 0;
+        uint32_t minPosition = UINT32_MAX;
+        uint32_t maxPosition = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            const uint32_t position = positions[i][cursors[i]];
+            if (position < minPosition) {
+                minPosition = position;
+                minIndex = i;
+            }
+            maxPosition = std::max(maxPosition, position);
+        }
+
+        best = std::min(best, maxPosition - minPosition + 1);
+
+        if (++cursors[minIndex] == positions[minIndex].size()) {
+            break;
+        }
+    }
+
+    return best;
+}
+
+int proximityBonus(const std::vector<PositionList> &positions) {
+    std::vector<PositionList> present;
+    for (const auto &list : positions) {
+        if (!list.empty()) {
+            present.push_back(list);
+        }
+    }
+
+    if (present.size() < 2) {
+        return 0;
+    }
+
+    const uint32_t window = minCoverWindow(present);
+    if (window == 0) {
+        return 0;
+    }
+
+    return static_cast<int>(maxProximityBonus * present.size() / window);
+}
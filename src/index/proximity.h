@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Тип списка позиций одного слова в документе (по возрастанию).
+typedef std::vector<uint32_t> PositionList;
+
+//! Прибавка к релевантности для слов, стоящих подряд. Больше прибавки не бывает.
+const int maxProximityBonus = 10;
+
+/**
+* @brief Посчитать число вхождений фразы в документ.
+* @param positions Позиции каждого слова фразы в документе.
+* @param offsets Смещение каждого слова относительно начала фразы в запросе.
+* @return Число вхождений фразы.
+*/
+size_t countPhraseMatches(const std::vector<PositionList> &positions,
+        const std::vector<uint32_t> &offsets);
+
+/**
+* @brief Найти длину минимального окна документа, в котором встречаются все слова.
+* @param positions Позиции каждого слова в документе.
+* @return Длина окна в словах или 0, если какое-то слово не встречается.
+*/
+uint32_t minCoverWindow(const std::vector<PositionList> &positions);
+
+/**
+* @brief Получить прибавку к релевантности за близость слов запроса друг к другу.
+* @details Прибавка максимальна, когда слова стоят подряд, и убывает обратно пропорционально
+* длине минимального окна. Слова, которых нет в документе, не учитываются.
+* @param positions Позиции каждого слова запроса в документе.
+* @return Прибавка к релевантности.
+*/
+int proximityBonus(const std::vector<PositionList> &positions);
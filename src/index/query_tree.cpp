@@ -0,0 +1,170 @@
+#include "query_tree.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+/**
+* @brief Собрать слова поддерева запроса.
+* @param negated Поддерево находится под нечетным числом узлов NOT.
+*/
+void collectWords(const QueryNode &query, bool negated, std::vector<std::string> &positive,
+        std::vector<std::string> &all) {
+    switch (query.type) {
+        case QUERY_TERM:
+            all.push_back(query.value);
+            if (!negated) {
+                positive.push_back(query.value);
+            }
+            break;
+        case QUERY_PHRASE:
+            all.insert(all.end(), query.words.begin(), query.words.end());
+            if (!negated) {
+                positive.insert(positive.end(), query.words.begin(), query.words.end());
+            }
+            break;
+        default:
+            for (const auto &child : query.children) {
+                collectWords(child, negated != (query.type == QUERY_NOT), positive, all);
+            }
+    }
+}
+
+void sortUnique(std::vector<std::string> &words) {
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
+
+} // namespace
+
+bool isWordsQuery(const QueryNode &query, std::vector<std::string> &words) {
+    if (query.type == QUERY_TERM) {
+        words.push_back(query.value);
+        return true;
+    }
+    if (query.type != QUERY_OR) {
+        return false;
+    }
+    for (const auto &child : query.children) {
+        if (child.type != QUERY_TERM) {
+            return false;
+        }
+    }
+    for (const auto &child : query.children) {
+        words.push_back(child.value);
+    }
+    return true;
+}
+
+void collectQueryWords(const QueryNode &query, std::vector<std::string> &positive,
+        std::vector<std::string> &all) {
+    collectWords(query, false, positive, all);
+    sortUnique(positive);
+    sortUnique(all);
+}
+
+std::string urlHost(const std::string &url) {
+    size_t begin = url.find("://");
+    begin = begin == std::string::npos ? 0 : begin + 3;
+    const size_t end = url.find_first_of(":/?#", begin);
+
+    std::string host = url.substr(begin, end == std::string::npos ? end : end - begin);
+    std::transform(host.begin(), host.end(), host.begin(),
+            [](unsigned char ch) { return std::tolower(ch); });
+    return host;
+}
+
+bool matchesSite(const std::string &host, const std::string &site) {
+    if (host.size() < site.size() || host.compare(host.size() - site.size(), site.size(), site)) {
+        return false;
+    }
+    return host.size() == site.size() || host[host.size() - site.size() - 1] == '.';
+}
+
+bool matchesQuery(const QueryNode &query, const PageWords &words, const std::string &host) {
+    switch (query.type) {
+        case QUERY_TERM:
+            return words.count(query.value) != 0;
+        case QUERY_PHRASE: {
+            std::vector<PositionList> positions;
+            for (const auto &word : query.words) {
+                auto it = words.find(word);
+                if (it == words.end()) {
+                    return false;
+                }
+                positions.push_back(it->second);
+            }
+            return countPhraseMatches(positions, query.offsets) > 0;
+        }
+        case QUERY_SITE:
+            return matchesSite(host, query.value);
+        case QUERY_AND:
+            for (const auto &child : query.children) {
+                if (!matchesQuery(child, words, host)) {
+                    return false;
+                }
+            }
+            return true;
+        case QUERY_OR:
+            for (const auto &child : query.children) {
+                if (matchesQuery(child, words, host)) {
+                    return true;
+                }
+            }
+            return false;
+        case QUERY_NOT:
+            return !query.children.empty() && !matchesQuery(query.children.front(), words, host);
+    }
+    return false;
+}
+
+bool pruneQuery(QueryNode &query, const std::function<bool(const std::string &)> &known) {
+    switch (query.type) {
+        case QUERY_TERM:
+            return known(query.value);
+        case QUERY_PHRASE:
+            return std::all_of(query.words.begin(), query.words.end(), known);
+        case QUERY_SITE:
+            return true;
+        case QUERY_NOT: {
+            // NOT с пустым поддеревом совпадает со всеми страницами, удалить его можно
+            // только из AND.
+            if (!query.children.empty()) {
+                QueryNode child = query.children.front();
+                if (pruneQuery(child, known)) {
+                    query.children.front() = std::move(child);
+                }
+            }
+            return true;
+        }
+        case QUERY_AND:
+        case QUERY_OR: {
+            std::vector<QueryNode> children;
+            for (const auto &val : query.children) {
+                QueryNode child = val;
+                if (query.type == QUERY_AND && child.type == QUERY_NOT &&
+                        !child.children.empty()) {
+                    if (pruneQuery(child.children.front(), known)) {
+                        children.push_back(std::move(child));
+                    }
+                } else if (pruneQuery(child, known)) {
+                    children.push_back(std::move(child));
+                } else if (query.type == QUERY_AND) {
+                    return false;
+                }
+            }
+            if (children.empty()) {
+                return query.type == QUERY_AND;
+            }
+            query.children = std::move(children);
+            break;
+        }
+    }
+
+    if (query.children.size() == 1 && query.children.front().type != QUERY_NOT) {
+        QueryNode child = std::move(query.children.front());
+        query = std::move(child);
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "proximity.h"
+#include "../common_data.h"
+
+//! Позиции слов на странице по слову. Слов, которых на странице нет, в словаре нет.
+typedef std::map<std::string, PositionList> PageWords;
+
+/**
+* @brief Проверить, является ли запрос поиском страниц хотя бы с одним из слов.
+* @details Такой запрос - одно слово или OR из слов - выполняется отдельным быстрым путем
+* без вычисления дерева.
+* @param query Дерево запроса.
+* @param words Вектор для записи слов запроса.
+* @return true, если запрос состоит только из слов, объединенных OR.
+*/
+bool isWordsQuery(const QueryNode &query, std::vector<std::string> &words);
+
+/**
+* @brief Собрать слова запроса.
+* @param query Дерево запроса.
+* @param positive Вектор для записи слов вне NOT, по которым считается релевантность.
+* @param all Вектор для записи всех слов, включая слова под NOT.
+* @details Слова в обоих векторах упорядочены и не повторяются.
+*/
+void collectQueryWords(const QueryNode &query, std::vector<std::string> &positive,
+        std::vector<std::string> &all);
+
+/**
+* @brief Получить хост из URL страницы.
+* @param url URL со схемой или без нее.
+* @return Хост в нижнем регистре без порта.
+*/
+std::string urlHost(const std::string &url);
+
+/**
+* @brief Проверить, относится ли хост к сайту.
+* @param host Хост в нижнем регистре.
+* @param site Хост сайта из запроса site:.
+* @return true, если хост совпадает с хостом сайта или является его поддоменом.
+*/
+bool matchesSite(const std::string &host, const std::string &site);
+
+/**
+* @brief Проверить, подходит ли страница под запрос.
+* @param query Дерево запроса.
+* @param words Позиции слов запроса на странице.
+* @param host Хост страницы в нижнем регистре.
+* @return true, если страница подходит под запрос.
+*/
+bool matchesQuery(const QueryNode &query, const PageWords &words, const std::string &host);
+
+/**
+* @brief Убрать из запроса части, которые не могут совпасть ни с одной страницей.
+* @details Слово или фраза со словом, которого нет в индексе, не совпадают ни с чем: из OR
+* они удаляются, AND с ними пуст, а исключение NOT с ними ничего не исключает и тоже
+* удаляется. Узел AND или OR с единственным дочерним узлом заменяется им.
+* @param query Дерево запроса.
+* @param known Проверка слова: false, если слова точно нет в индексе.
+* @return false, если запрос не совпадает ни с одной страницей.
+*/
+bool pruneQuery(QueryNode &query, const std::function<bool(const std::string &)> &known);
@@ -0,0 +1,590 @@
+#include "segment.h"
+#include "postings_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//! Сигнатура файла сегмента.
+const uint32_t segmentMagic = 0x47455342; // "BSEG"
+
+//! Версия формата сегмента.
+const uint32_t segmentVersion = 3;
+
+/**
+* @brief Заголовок в конце файла сегмента.
+*/
+struct SegmentFooter {
+    uint32_t magic; //!< Сигнатура.
+    uint32_t version; //!< Версия формата.
+    uint64_t docsOffset; //!< Смещение таблицы документов.
+    uint64_t dictOffset; //!< Смещение словаря.
+    uint32_t docCount; //!< Число документов.
+    uint32_t termCount; //!< Число слов.
+};
+
+void appendVarint64(std::string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool readVarint64(const char *&cursor, const char *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 70 && cursor < end; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(*cursor++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendString(std::string &out, const std::string &value) {
+    appendVarint(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+bool readString(const char *&cursor, const char *end, std::string &value) {
+    uint32_t size = 0;
+    if (!readVarint(cursor, end, size) || static_cast<size_t>(end - cursor) < size) {
+        return false;
+    }
+    value.assign(cursor, size);
+    cursor += size;
+    return true;
+}
+
+} // namespace
+
+void SurfaceCounter::add(const SurfaceForm &form) {
+    if (!form.form.empty()) {
+        forms_[form.form] += form.docFreq;
+    }
+}
+
+SurfaceForm SurfaceCounter::best() const {
+    SurfaceForm best;
+    for (const auto &val : forms_) {
+        if (val.second > best.docFreq) {
+            best.form = val.first;
+            best.docFreq = val.second;
+        }
+    }
+    return best;
+}
+
+MemSegment::MemSegment() :
+docs_(),
+terms_(),
+surfaces_(),
+memoryUsage_(0) {
+}
+
+void MemSegment::addDocument(uint32_t docId, const std::string &url, const TermStorage &terms) {
+    uint32_t length = 0;
+    for (const auto &val : terms) {
+        length += static_cast<uint32_t>(val.second.count);
+    }
+    docs_.push_back(DocInfo {docId, url, length});
+    memoryUsage_ += sizeof(DocInfo) + url.size();
+
+    for (const auto &val : terms) {
+        Posting posting;
+        posting.docId = docId;
+        posting.impact = static_cast<uint32_t>(std::max(val.second.impact, 0));
+        posting.positions = encodePositions(val.second.positions);
+        posting.length = length;
+
+        std::vector<Posting> &postings = terms_[val.first];
+        if (postings.empty()) {
+            memoryUsage_ += sizeof(Posting) * 2 + val.first.size();
+        }
+        memoryUsage_ += sizeof(Posting) + posting.positions.size();
+        postings.push_back(std::move(posting));
+
+        if (!val.second.surface.empty()) {
+            memoryUsage_ += sizeof(SurfaceCounter) + val.second.surface.size();
+            surfaces_[val.first].add(SurfaceForm {val.second.surface, 1});
+        }
+    }
+}
+
+const std::vector<DocInfo> &MemSegment::docs() const {
+    return docs_;
+}
+
+const MemSegment::Terms &MemSegment::terms() const {
+    return terms_;
+}
+
+SurfaceForm MemSegment::surface(const std::string &term) const {
+    auto it = surfaces_.find(term);
+    return it != surfaces_.end() ? it->second.best() : SurfaceForm();
+}
+
+size_t MemSegment::memoryUsage() const {
+    return memoryUsage_;
+}
+
+bool MemSegment::empty() const {
+    return docs_.empty();
+}
+
+void MemSegment::clear() {
+    docs_.clear();
+    terms_.clear();
+    surfaces_.clear();
+    memoryUsage_ = 0;
+}
+
+PostingCursor::PostingCursor() :
+next_(nullptr),
+end_(nullptr),
+cursor_(nullptr),
+blockEnd_(nullptr),
+pending_(0),
+blockLeft_(0),
+blockLast_(0),
+blockMaxImpact_(0),
+blockMinLength_(0),
+maxImpact_(0),
+minLength_(0),
+docId_(noMoreDocs),
+impact_(0),
+positions_(nullptr),
+positionsSize_(0) {
+}
+
+PostingCursor::PostingCursor(const char *data, size_t size, uint32_t docFreq) :
+PostingCursor() {
+    next_ = data;
+    end_ = data + size;
+    pending_ = docFreq;
+    if (!readVarint(next_, end_, maxImpact_) || !readVarint(next_, end_, minLength_)) {
+        finish();
+        return;
+    }
+
+    docId_ = 0;
+    readPosting();
+}
+
+bool PostingCursor::valid() const {
+    return docId_ != noMoreDocs;
+}
+
+uint32_t PostingCursor::docId() const {
+    return docId_;
+}
+
+uint32_t PostingCursor::impact() const {
+    return impact_;
+}
+
+std::string PostingCursor::positions() const {
+    return std::string(positions_, positionsSize_);
+}
+
+void PostingCursor::next() {
+    if (valid()) {
+        readPosting();
+    }
+}
+
+void PostingCursor::advance(uint32_t target) {
+    if (!valid() || docId_ >= target) {
+        return;
+    }
+
+    // Блоки, целиком лежащие левее target, пропускаются без раскодирования вхождений.
+    while (target > blockLast_) {
+        docId_ = blockLast_;
+        if (!readBlock()) {
+            finish();
+            return;
+        }
+    }
+    while (valid() && docId_ < target) {
+        readPosting();
+    }
+}
+
+uint32_t PostingCursor::blockLastDocId() const {
+    return blockLast_;
+}
+
+uint32_t PostingCursor::blockMaxImpact() const {
+    return blockMaxImpact_;
+}
+
+uint32_t PostingCursor::blockMinLength() const {
+    return blockMinLength_;
+}
+
+uint32_t PostingCursor::maxImpact() const {
+    return maxImpact_;
+}
+
+uint32_t PostingCursor::minLength() const {
+    return minLength_;
+}
+
+bool PostingCursor::readBlock() {
+    if (pending_ == 0) {
+        return false;
+    }
+
+    uint32_t delta = 0;
+    uint32_t bodySize = 0;
+    if (!readVarint(next_, end_, delta) || !readVarint(next_, end_, blockMaxImpact_) ||
+            !readVarint(next_, end_, blockMinLength_) || !readVarint(next_, end_, bodySize) ||
+            static_cast<size_t>(end_ - next_) < bodySize) {
+        std::cerr << "PostingCursor::readBlock: Error: bad postings block" << std::endl;
+        return false;
+    }
+
+    // Разности идентификаторов в блоке отсчитываются от последнего документа
+    // предыдущего блока, который к этому моменту лежит в docId_.
+    blockLast_ = docId_ + delta;
+    blockLeft_ = std::min(pending_, postingsBlockSize);
+    pending_ -= blockLeft_;
+    cursor_ = next_;
+    blockEnd_ = next_ + bodySize;
+    next_ = blockEnd_;
+    return true;
+}
+
+void PostingCursor::readPosting() {
+    if (blockLeft_ == 0) {
+        docId_ = blockLast_;
+        if (!readBlock()) {
+            finish();
+            return;
+        }
+    }
+
+    uint32_t delta = 0;
+    if (!readVarint(cursor_, blockEnd_, delta) || !readVarint(cursor_, blockEnd_, impact_) ||
+            !readVarint(cursor_, blockEnd_, positionsSize_) ||
+            static_cast<size_t>(blockEnd_ - cursor_) < positionsSize_) {
+        std::cerr << "PostingCursor::readPosting: Error: bad posting" << std::endl;
+        finish();
+        return;
+    }
+    positions_ = cursor_;
+    cursor_ += positionsSize_;
+    docId_ += delta;
+    --blockLeft_;
+}
+
+void PostingCursor::finish() {
+    docId_ = noMoreDocs;
+    blockLeft_ = 0;
+    pending_ = 0;
+    blockLast_ = noMoreDocs;
+}
+
+SegmentWriter::SegmentWriter(const std::string &path) :
+file_(path, std::ios::binary | std::ios::trunc),
+offset_(0),
+docs_(),
+dictionary_() {
+    if (!file_.is_open()) {
+        std::cerr << "SegmentWriter::SegmentWriter: Error: can't create " << path << std::endl;
+    }
+}
+
+void SegmentWriter::addDoc(const DocInfo &doc) {
+    docs_.push_back(doc);
+}
+
+void SegmentWriter::addTerm(const std::string &term, const SurfaceForm &surface,
+        const std::vector<Posting> &postings) {
+    addTermBlock(term, surface, static_cast<uint32_t>(postings.size()), encodePostings(postings));
+}
+
+void SegmentWriter::addTermBlock(const std::string &term, const SurfaceForm &surface,
+        uint32_t docFreq, const std::string &block) {
+    file_.write(block.data(), block.size());
+    dictionary_.push_back(DictEntry {term, docFreq, offset_, block.size(), surface});
+    offset_ += block.size();
+}
+
+std::string SegmentWriter::encodePostings(const std::vector<Posting> &postings) {
+    // Заголовок списка: наибольший вклад и наименьшая длина документа во всем списке.
+    uint32_t maxImpact = 0;
+    uint32_t minLength = postings.empty() ? 0 : UINT32_MAX;
+    for (const auto &posting : postings) {
+        maxImpact = std::max(maxImpact, posting.impact);
+        minLength = std::min(minLength, posting.length);
+    }
+    std::string list;
+    appendVarint(list, maxImpact);
+    appendVarint(list, minLength);
+
+    uint32_t previous = 0;
+    for (size_t begin = 0; begin < postings.size(); begin += postingsBlockSize) {
+        const size_t end = std::min(postings.size(), begin + postingsBlockSize);
+
+        std::string body;
+        uint32_t blockMaxImpact = 0;
+        uint32_t blockMinLength = UINT32_MAX;
+        uint32_t docId = previous;
+        for (size_t i = begin; i < end; ++i) {
+            appendVarint(body, postings[i].docId - docId);
+            appendVarint(body, postings[i].impact);
+            appendString(body, postings[i].positions);
+            docId = postings[i].docId;
+            blockMaxImpact = std::max(blockMaxImpact, postings[i].impact);
+            blockMinLength = std::min(blockMinLength, postings[i].length);
+        }
+
+        appendVarint(list, docId - previous);
+        appendVarint(list, blockMaxImpact);
+        appendVarint(list, blockMinLength);
+        appendVarint(list, static_cast<uint32_t>(body.size()));
+        list += body;
+        previous = docId;
+    }
+
+    return list;
+}
+
+bool SegmentWriter::finish() {
+    std::sort(docs_.begin(), docs_.end(),
+            [](const DocInfo &lhs, const DocInfo &rhs) { return lhs.docId < rhs.docId; });
+
+    SegmentFooter footer;
+    footer.magic = segmentMagic;
+    footer.version = segmentVersion;
+
+    std::string block;
+    uint32_t previous = 0;
+    for (const auto &doc : docs_) {
+        appendVarint(block, doc.docId - previous);
+        appendString(block, doc.url);
+        appendVarint(block, doc.length);
+        previous = doc.docId;
+    }
+    footer.docsOffset = offset_;
+    footer.docCount = static_cast<uint32_t>(docs_.size());
+    file_.write(block.data(), block.size());
+    offset_ += block.size();
+
+    block.clear();
+    for (const auto &entry : dictionary_) {
+        appendString(block, entry.term);
+        appendVarint(block, entry.docFreq);
+        appendVarint64(block, entry.offset);
+        appendVarint64(block, entry.length);
+        appendString(block, entry.surface.form);
+        appendVarint(block, entry.surface.docFreq);
+    }
+    footer.dictOffset = offset_;
+    footer.termCount = static_cast<uint32_t>(dictionary_.size());
+    file_.write(block.data(), block.size());
+    offset_ += block.size();
+
+    file_.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+    file_.close();
+
+    return !file_.fail();
+}
+
+bool SegmentWriter::write(const std::string &path, const MemSegment &segment) {
+    SegmentWriter writer(path);
+    for (const auto &doc : segment.docs()) {
+        writer.addDoc(doc);
+    }
+    for (const auto &val : segment.terms()) {
+        writer.addTerm(val.first, segment.surface(val.first), val.second);
+    }
+
+    return writer.finish();
+}
+
+SegmentReader::SegmentReader() :
+path_(),
+data_(nullptr),
+size_(0),
+docs_(),
+totalLength_(0),
+dictionary_() {
+}
+
+SegmentReader::~SegmentReader() {
+    unmap();
+}
+
+bool SegmentReader::open(const std::string &path) {
+    unmap();
+    path_ = path;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "SegmentReader::open: Error: can't open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        std::cerr << "SegmentReader::open: Error: can't stat " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    SegmentFooter footer;
+    if (static_cast<size_t>(info.st_size) < sizeof(footer)) {
+        std::cerr << "SegmentReader::open: Error: truncated segment " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    // Отображение остается действительным после закрытия дескриптора и удаления файла
+    // слиянием, поэтому читатели старого снимка дорабатывают без ошибок.
+    void *mapped = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "SegmentReader::open: Error: can't map " << path << std::endl;
+        return false;
+    }
+    data_ = static_cast<const char *>(mapped);
+    size_ = info.st_size;
+
+    std::memcpy(&footer, data_ + size_ - sizeof(footer), sizeof(footer));
+    const uint64_t bodySize = size_ - sizeof(footer);
+    if (footer.magic == segmentMagic && footer.version != segmentVersion) {
+        std::cerr << "SegmentReader::open: Error: unsupported segment version "
+                  << footer.version << " in " << path << ", rebuild the index" << std::endl;
+        return false;
+    }
+    if (footer.magic != segmentMagic || footer.docsOffset > footer.dictOffset ||
+            footer.dictOffset > bodySize) {
+        std::cerr << "SegmentReader::open: Error: bad segment header " << path << std::endl;
+        return false;
+    }
+
+    const char *cursor = data_ + footer.docsOffset;
+    const char *end = data_ + footer.dictOffset;
+    docs_.clear();
+    docs_.reserve(footer.docCount);
+    totalLength_ = 0;
+    uint32_t docId = 0;
+    for (uint32_t i = 0; i < footer.docCount; ++i) {
+        uint32_t delta = 0;
+        DocInfo doc;
+        if (!readVarint(cursor, end, delta) || !readString(cursor, end, doc.url) ||
+                !readVarint(cursor, end, doc.length)) {
+            std::cerr << "SegmentReader::open: Error: bad doc table " << path << std::endl;
+            return false;
+        }
+        docId += delta;
+        doc.docId = docId;
+        totalLength_ += doc.length;
+        docs_.push_back(std::move(doc));
+    }
+
+    cursor = data_ + footer.dictOffset;
+    end = data_ + bodySize;
+    dictionary_.clear();
+    dictionary_.reserve(footer.termCount);
+    for (uint32_t i = 0; i < footer.termCount; ++i) {
+        DictEntry entry;
+        if (!readString(cursor, end, entry.term) || !readVarint(cursor, end, entry.docFreq) ||
+                !readVarint64(cursor, end, entry.offset) ||
+                !readVarint64(cursor, end, entry.length) ||
+                !readString(cursor, end, entry.surface.form) ||
+                !readVarint(cursor, end, entry.surface.docFreq) ||
+                entry.offset + entry.length > footer.docsOffset) {
+            std::cerr << "SegmentReader::open: Error: bad dictionary " << path << std::endl;
+            return false;
+        }
+        dictionary_.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+const DictEntry *SegmentReader::findTerm(const std::string &term) const {
+    auto it = std::lower_bound(dictionary_.begin(), dictionary_.end(), term,
+            [](const DictEntry &entry, const std::string &value) { return entry.term < value; });
+    if (it == dictionary_.end() || it->term != term) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::vector<Posting> SegmentReader::postings(const DictEntry &entry) const {
+    std::vector<Posting> postings;
+    postings.reserve(entry.docFreq);
+
+    // Вхождения и таблица документов упорядочены по идентификатору, поэтому длины
+    // документов подбираются одним проходом.
+    auto doc = docs_.begin();
+    for (PostingCursor cursor = this->cursor(entry); cursor.valid(); cursor.next()) {
+        Posting posting;
+        posting.docId = cursor.docId();
+        posting.impact = cursor.impact();
+        posting.positions = cursor.positions();
+        while (doc != docs_.end() && doc->docId < posting.docId) {
+            ++doc;
+        }
+        posting.length = (doc != docs_.end() && doc->docId == posting.docId) ? doc->length : 0;
+        postings.push_back(std::move(posting));
+    }
+    if (postings.size() != entry.docFreq) {
+        std::cerr << "SegmentReader::postings: Error: bad postings for " << entry.term
+                  << " in " << path_ << std::endl;
+    }
+
+    return postings;
+}
+
+PostingCursor SegmentReader::cursor(const DictEntry &entry) const {
+    return PostingCursor(data_ + entry.offset, entry.length, entry.docFreq);
+}
+
+const DocInfo *SegmentReader::findDoc(uint32_t docId) const {
+    auto it = std::lower_bound(docs_.begin(), docs_.end(), docId,
+            [](const DocInfo &doc, uint32_t value) { return doc.docId < value; });
+    if (it == docs_.end() || it->docId != docId) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+const std::vector<DocInfo> &SegmentReader::docs() const {
+    return docs_;
+}
+
+uint64_t SegmentReader::totalLength() const {
+    return totalLength_;
+}
+
+const std::vector<DictEntry> &SegmentReader::dictionary() const {
+    return dictionary_;
+}
+
+const std::string &SegmentReader::path() const {
+    return path_;
+}
+
+size_t SegmentReader::fileSize() const {
+    return size_;
+}
+
+void SegmentReader::unmap() {
+    if (data_) {
+        ::munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
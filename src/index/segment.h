@@ -0,0 +1,416 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../common_data.h"
+
+/**
+* @brief Вхождение слова в документ.
+*/
+struct Posting {
+    uint32_t docId; //!< Идентификатор документа.
+    uint32_t impact; //!< Вклад слова в релевантность документа.
+    std::string positions; //!< Позиции слова, закодированные encodePositions.
+    uint32_t length; //!< Число слов в документе; в списке не хранится.
+};
+
+//! Число вхождений в блоке списка вхождений.
+const uint32_t postingsBlockSize = 128;
+
+/**
+* @brief Запись таблицы документов сегмента.
+*/
+struct DocInfo {
+    uint32_t docId; //!< Идентификатор документа.
+    std::string url; //!< URL страницы.
+    uint32_t length; //!< Число слов в документе.
+};
+
+/**
+* @brief Форма слова до приведения к основе.
+*/
+struct SurfaceForm {
+    std::string form; //!< Форма в нижнем регистре, пустая - неизвестна.
+    uint32_t docFreq = 0; //!< Число документов, в которых эта форма слова самая частая.
+};
+
+/**
+* @brief Выбор самой частой формы слова из форм отдельных документов или сегментов.
+*/
+class SurfaceCounter {
+public:
+    /**
+    * @brief Учесть форму.
+    * @param form Форма слова; пустая форма не учитывается.
+    */
+    void add(const SurfaceForm &form);
+
+    /**
+    * @brief Получить форму с наибольшим числом документов.
+    */
+    SurfaceForm best() const;
+
+private:
+    std::map<std::string, uint32_t> forms_; //!< Число документов по формам.
+};
+
+/**
+* @brief Запись словаря сегмента.
+*/
+struct DictEntry {
+    std::string term; //!< Слово.
+    uint32_t docFreq; //!< Число документов, содержащих слово.
+    uint64_t offset; //!< Смещение списка вхождений в файле сегмента.
+    uint64_t length; //!< Длина списка вхождений в байтах.
+    SurfaceForm surface; //!< Самая частая форма слова для подсказок.
+};
+
+/**
+* @brief Изменяемый сегмент индекса в оперативной памяти.
+* @details Накапливает списки вхождений для множества документов. Документы должны
+* добавляться в порядке возрастания идентификаторов, тогда списки вхождений каждого слова
+* остаются отсортированными по идентификатору документа.
+*/
+class MemSegment {
+public:
+    //! Тип словаря: слово -> список вхождений по возрастанию идентификатора документа.
+    typedef std::map<std::string, std::vector<Posting> > Terms;
+    //! Тип форм слов: слово -> формы документов.
+    typedef std::map<std::string, SurfaceCounter> Surfaces;
+
+    /**
+    * @brief Конструктор.
+    */
+    MemSegment();
+
+    /**
+    * @brief Добавить документ.
+    * @param docId Идентификатор документа.
+    * @param url URL страницы.
+    * @param terms Слова страницы.
+    */
+    void addDocument(uint32_t docId, const std::string &url, const TermStorage &terms);
+
+    /**
+    * @brief Получить таблицу документов.
+    */
+    const std::vector<DocInfo> &docs() const;
+
+    /**
+    * @brief Получить словарь со списками вхождений.
+    */
+    const Terms &terms() const;
+
+    /**
+    * @brief Получить самую частую форму слова.
+    * @param term Слово.
+    * @return Форма или пустая форма, если она неизвестна.
+    */
+    SurfaceForm surface(const std::string &term) const;
+
+    /**
+    * @brief Получить приблизительный объем занимаемой памяти в байтах.
+    */
+    size_t memoryUsage() const;
+
+    /**
+    * @brief Проверить, пуст ли сегмент.
+    */
+    bool empty() const;
+
+    /**
+    * @brief Очистить сегмент.
+    */
+    void clear();
+
+private:
+    std::vector<DocInfo> docs_; //!< Таблица документов.
+    Terms terms_; //!< Словарь со списками вхождений.
+    Surfaces surfaces_; //!< Формы слов.
+    size_t memoryUsage_; //!< Приблизительный объем занимаемой памяти.
+};
+
+/**
+* @brief Курсор по списку вхождений слова в сегменте.
+* @details Список разбит на блоки по postingsBlockSize вхождений. Заголовок блока хранит
+* последний идентификатор документа в блоке, наибольший вклад слова и наименьшую длину
+* документа в блоке и размер блока в байтах, поэтому advance пропускает блоки, не
+* раскодируя их, а по заголовку можно оценить сверху релевантность любого документа блока.
+*/
+class PostingCursor {
+public:
+    //! Идентификатор документа исчерпанного курсора.
+    static const uint32_t noMoreDocs = UINT32_MAX;
+
+    /**
+    * @brief Конструктор пустого курсора.
+    */
+    PostingCursor();
+
+    /**
+    * @brief Конструктор. Устанавливает курсор на первое вхождение.
+    * @param data Список вхождений, закодированный SegmentWriter::encodePostings.
+    * @param size Длина списка в байтах.
+    * @param docFreq Число вхождений в списке.
+    */
+    PostingCursor(const char *data, size_t size, uint32_t docFreq);
+
+    /**
+    * @brief Проверить, что курсор не исчерпан.
+    */
+    bool valid() const;
+
+    /**
+    * @brief Получить идентификатор документа текущего вхождения или noMoreDocs.
+    */
+    uint32_t docId() const;
+
+    /**
+    * @brief Получить вклад слова в текущем вхождении.
+    */
+    uint32_t impact() const;
+
+    /**
+    * @brief Получить позиции слова в текущем вхождении, закодированные encodePositions.
+    */
+    std::string positions() const;
+
+    /**
+    * @brief Перейти к следующему вхождению.
+    */
+    void next();
+
+    /**
+    * @brief Перейти к первому вхождению с идентификатором документа не меньше target.
+    * @details Блоки, последний документ которых меньше target, пропускаются по заголовку.
+    * @param target Идентификатор документа.
+    */
+    void advance(uint32_t target);
+
+    /**
+    * @brief Получить последний идентификатор документа в текущем блоке.
+    */
+    uint32_t blockLastDocId() const;
+
+    /**
+    * @brief Получить наибольший вклад слова в текущем блоке.
+    */
+    uint32_t blockMaxImpact() const;
+
+    /**
+    * @brief Получить наименьшую длину документа в текущем блоке.
+    */
+    uint32_t blockMinLength() const;
+
+    /**
+    * @brief Получить наибольший вклад слова во всем списке.
+    */
+    uint32_t maxImpact() const;
+
+    /**
+    * @brief Получить наименьшую длину документа во всем списке.
+    */
+    uint32_t minLength() const;
+
+private:
+    const char *next_; //!< Начало следующего блока.
+    const char *end_; //!< Конец списка.
+    const char *cursor_; //!< Следующее вхождение текущего блока.
+    const char *blockEnd_; //!< Конец текущего блока.
+    uint32_t pending_; //!< Число вхождений в следующих блоках.
+    uint32_t blockLeft_; //!< Число нераскодированных вхождений текущего блока.
+    uint32_t blockLast_; //!< Последний идентификатор документа в текущем блоке.
+    uint32_t blockMaxImpact_; //!< Наибольший вклад в текущем блоке.
+    uint32_t blockMinLength_; //!< Наименьшая длина документа в текущем блоке.
+    uint32_t maxImpact_; //!< Наибольший вклад в списке.
+    uint32_t minLength_; //!< Наименьшая длина документа в списке.
+    uint32_t docId_; //!< Идентификатор документа текущего вхождения.
+    uint32_t impact_; //!< Вклад слова в текущем вхождении.
+    const char *positions_; //!< Позиции текущего вхождения.
+    uint32_t positionsSize_; //!< Длина позиций текущего вхождения в байтах.
+
+    /**
+    * @brief Прочитать заголовок следующего блока.
+    * @return false, если блоков больше нет или заголовок поврежден.
+    */
+    bool readBlock();
+
+    /**
+    * @brief Раскодировать следующее вхождение, при необходимости перейдя к следующему блоку.
+    */
+    void readPosting();
+
+    /**
+    * @brief Пометить курсор исчерпанным.
+    */
+    void finish();
+};
+
+/**
+* @brief Потоковая запись неизменяемого сегмента в файл.
+* @details Формат файла: списки вхождений, таблица документов, словарь и заголовок
+* фиксированной длины в конце файла. Все числа, кроме заголовка, записываются в формате
+* varint, идентификаторы документов в списках вхождений - разностями. Списки вхождений
+* разбиты на блоки с заголовками, см. PostingCursor.
+*/
+class SegmentWriter {
+public:
+    /**
+    * @brief Конструктор.
+    * @param path Путь к файлу сегмента.
+    */
+    explicit SegmentWriter(const std::string &path);
+
+    /**
+    * @brief Добавить документ в таблицу документов.
+    * @param doc Документ.
+    */
+    void addDoc(const DocInfo &doc);
+
+    /**
+    * @brief Добавить список вхождений слова.
+    * @details Слова должны добавляться в порядке возрастания, вхождения - в порядке
+    * возрастания идентификатора документа.
+    * @param term Слово.
+    * @param surface Самая частая форма слова.
+    * @param postings Список вхождений.
+    */
+    void addTerm(const std::string &term, const SurfaceForm &surface,
+            const std::vector<Posting> &postings);
+
+    /**
+    * @brief Добавить заранее закодированный список вхождений слова.
+    * @param term Слово.
+    * @param surface Самая частая форма слова.
+    * @param docFreq Число документов в списке.
+    * @param block Список вхождений, закодированный encodePostings.
+    */
+    void addTermBlock(const std::string &term, const SurfaceForm &surface, uint32_t docFreq,
+            const std::string &block);
+
+    /**
+    * @brief Закодировать список вхождений в формате сегмента.
+    * @param postings Список вхождений по возрастанию идентификатора документа с длинами
+    * документов.
+    * @return Закодированный список.
+    */
+    static std::string encodePostings(const std::vector<Posting> &postings);
+
+    /**
+    * @brief Дописать таблицу документов, словарь и заголовок и закрыть файл.
+    * @return false при ошибке записи.
+    */
+    bool finish();
+
+    /**
+    * @brief Записать сегмент из оперативной памяти в файл.
+    * @param path Путь к файлу сегмента.
+    * @param segment Сегмент.
+    * @return false при ошибке записи.
+    */
+    static bool write(const std::string &path, const MemSegment &segment);
+
+private:
+    std::ofstream file_; //!< Файл сегмента.
+    uint64_t offset_; //!< Текущее смещение в файле.
+    std::vector<DocInfo> docs_; //!< Таблица документов.
+    std::vector<DictEntry> dictionary_; //!< Словарь.
+};
+
+/**
+* @brief Чтение неизменяемого сегмента из файла.
+* @details Файл отображается в память только для чтения: списки вхождений не копируются
+* в кучу, а страницы файла подгружаются и вытесняются ядром по мере обращения.
+*/
+class SegmentReader {
+public:
+    /**
+    * @brief Конструктор.
+    */
+    SegmentReader();
+
+    /**
+    * @brief Деструктор. Снимает отображение файла.
+    */
+    ~SegmentReader();
+
+    SegmentReader(const SegmentReader &) = delete;
+    SegmentReader &operator=(const SegmentReader &) = delete;
+
+    /**
+    * @brief Открыть сегмент.
+    * @param path Путь к файлу сегмента.
+    * @return false, если файл не удалось прочитать или он поврежден.
+    */
+    bool open(const std::string &path);
+
+    /**
+    * @brief Найти слово в словаре.
+    * @param term Слово.
+    * @return Запись словаря или nullptr, если слова нет в сегменте.
+    */
+    const DictEntry *findTerm(const std::string &term) const;
+
+    /**
+    * @brief Раскодировать список вхождений слова.
+    * @param entry Запись словаря.
+    * @return Список вхождений по возрастанию идентификатора документа.
+    */
+    std::vector<Posting> postings(const DictEntry &entry) const;
+
+    /**
+    * @brief Получить курсор по списку вхождений слова.
+    * @details Курсор ссылается на отображенный файл и действителен, пока открыт сегмент.
+    * @param entry Запись словаря.
+    */
+    PostingCursor cursor(const DictEntry &entry) const;
+
+    /**
+    * @brief Найти документ по идентификатору.
+    * @param docId Идентификатор документа.
+    * @return Документ или nullptr, если документа нет в сегменте.
+    */
+    const DocInfo *findDoc(uint32_t docId) const;
+
+    /**
+    * @brief Получить таблицу документов по возрастанию идентификатора.
+    */
+    const std::vector<DocInfo> &docs() const;
+
+    /**
+    * @brief Получить суммарную длину документов сегмента.
+    */
+    uint64_t totalLength() const;
+
+    /**
+    * @brief Получить словарь по возрастанию слов.
+    */
+    const std::vector<DictEntry> &dictionary() const;
+
+    /**
+    * @brief Получить путь к файлу сегмента.
+    */
+    const std::string &path() const;
+
+    /**
+    * @brief Получить размер файла сегмента в байтах.
+    */
+    size_t fileSize() const;
+
+private:
+    std::string path_; //!< Путь к файлу сегмента.
+    const char *data_; //!< Отображенное в память содержимое файла сегмента.
+    size_t size_; //!< Размер файла сегмента.
+    std::vector<DocInfo> docs_; //!< Таблица документов.
+    uint64_t totalLength_; //!< Суммарная длина документов.
+    std::vector<DictEntry> dictionary_; //!< Словарь.
+
+    /**
+    * @brief Снять отображение файла.
+    */
+    void unmap();
+};
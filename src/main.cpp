@@ -1,11 +1,12 @@
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <pqxx/pqxx>
 
 #include "spider/spider.h"
 #include "spider/indexer/indexer.h"
-#include "database_manager/database_manager.h"
+#include "analyzer/analyzer.h"
+#include "storage/storage.h"
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
@@ -57,9 +58,11 @@ struct StartPageParams {
 * @brief Стартовая структура.
 */
 struct StartConfig {
-    std::string dbConnectionString;
+    StorageConfig storageConfig; //!< Параметры хранилища индекса.
     StartPageParams startPageParams;
     int recursiveCount; //! Глубина рекурсии.
+    AnalyzerConfig analyzerConfig; //!< Параметры анализатора текста.
+    FieldBoosts fieldBoosts; //!< Веса полей страницы.
 };
 
 /**
@@ -88,19 +91,54 @@ void readConfig(StartConfig &startConfig) {
     try {
         boost::property_tree::read_ini("../resources/config.ini", pt);
 
-        DatabaseConfig dbConfig;
-        dbConfig.host = pt.get<std::string>("Database.host");
-        dbConfig.port = pt.get<std::string>("Database.port");
-        dbConfig.dbname = pt.get<std::string>("Database.dbname");
-        dbConfig.user = pt.get<std::string>("Database.user");
-        dbConfig.password = pt.get<std::string>("Database.password");
-        startConfig.dbConnectionString = getConnectionString(dbConfig);
+        StorageConfig &storageConfig = startConfig.storageConfig;
+        storageConfig.backend = pt.get<std::string>("Storage.backend", "embedded");
+
+        // Встроенному хранилищу БД не нужна, и раздела [Database] в конфигурации может не быть.
+        if (storageConfig.backend != "embedded") {
+            DatabaseConfig dbConfig;
+            dbConfig.host = pt.get<std::string>("Database.host");
+            dbConfig.port = pt.get<std::string>("Database.port");
+            dbConfig.dbname = pt.get<std::string>("Database.dbname");
+            dbConfig.user = pt.get<std::string>("Database.user");
+            dbConfig.password = pt.get<std::string>("Database.password");
+            storageConfig.dbConnectionString = getConnectionString(dbConfig);
+        }
+        storageConfig.dbPoolSize = pt.get<size_t>("Database.poolSize", 4);
+        storageConfig.dbPartitions = pt.get<size_t>("Database.postingsPartitions", 1);
 
         startConfig.startPageParams.host =  pt.get<std::string>("StartPage.host");
         startConfig.startPageParams.port =  pt.get<std::string>("StartPage.port");
         startConfig.startPageParams.target =  pt.get<std::string>("StartPage.target");
 
         startConfig.recursiveCount =  pt.get<int>("Recursive.recursiveCount");
+
+        startConfig.analyzerConfig.stemming = pt.get<bool>("Analyzer.stemming", true);
+        startConfig.analyzerConfig.stopWordsRuPath =
+                pt.get<std::string>("Analyzer.stopWordsRu", "");
+        startConfig.analyzerConfig.stopWordsEnPath =
+                pt.get<std::string>("Analyzer.stopWordsEn", "");
+
+        startConfig.fieldBoosts.title = pt.get<int>("Ranking.titleBoost", 5);
+        startConfig.fieldBoosts.heading = pt.get<int>("Ranking.headingBoost", 3);
+        startConfig.fieldBoosts.body = pt.get<int>("Ranking.bodyBoost", 1);
+        startConfig.fieldBoosts.anchor = pt.get<int>("Ranking.anchorBoost", 4);
+
+        WriteBehindConfig &writeBehindConfig = storageConfig.writeBehindConfig;
+        writeBehindConfig.batchPages = pt.get<size_t>("WriteBehind.batchPages", 64);
+        writeBehindConfig.batchDelayMs = pt.get<int>("WriteBehind.batchDelayMs", 500);
+        writeBehindConfig.maxQueuedPages = pt.get<size_t>("WriteBehind.maxQueuedPages", 1024);
+        writeBehindConfig.maxRetries = pt.get<int>("WriteBehind.maxRetries", 5);
+        writeBehindConfig.retryDelayMs = pt.get<int>("WriteBehind.retryDelayMs", 1000);
+        writeBehindConfig.writerThreads = pt.get<size_t>("WriteBehind.writerThreads", 2);
+
+        IndexBuilderConfig &indexConfig = storageConfig.indexConfig;
+        indexConfig.directory = pt.get<std::string>("Index.directory", "../index");
+        indexConfig.flushThresholdBytes =
+                pt.get<size_t>("Index.flushThresholdMb", 64) * 1024 * 1024;
+        indexConfig.mergeFactor = pt.get<size_t>("Index.mergeFactor", 4);
+        indexConfig.checkpointRuns = pt.get<size_t>("Index.checkpointRuns", 4);
+        indexConfig.mergeThreads = pt.get<size_t>("Index.mergeThreads", 0);
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
@@ -112,16 +150,21 @@ int main(int argc, char **argv) {
 
     Spider spider;
     try {
-        DatabaseManager dbmanager(startConfig.dbConnectionString);
-        dbmanager.createTables();
+        std::unique_ptr<Storage> storage = Storage::create(startConfig.storageConfig);
+        spider.setStorage(storage.get());
 
         RequestConfig reqConfig;
         reqConfig.host = startConfig.startPageParams.host;
         reqConfig.port = startConfig.startPageParams.port;
         reqConfig.target = startConfig.startPageParams.target;
 
-        spider.setDbManager(&dbmanager);
-        spider.start(reqConfig, startConfig.recursiveCount);
+        Analyzer analyzer(startConfig.analyzerConfig);
+
+        spider.setAnalyzer(&analyzer);
+        spider.setFieldBoosts(startConfig.fieldBoosts);
+        if (!spider.start(reqConfig, startConfig.recursiveCount)) {
+            return 1;
+        }
     } catch (const std::exception &e) {
         std::cout << e.what() << std::endl;
     }
@@ -1,9 +1,65 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <map>
+#include "../common_data.h"
+#include "suggest_index.h"
+
+/**
+* @brief Закодировать строку для передачи в параметре URL.
+* @param value Строка.
+* @return Строка, в которой все символы, кроме букв, цифр и "-_.~", заменены на %XX.
+*/
+inline std::string urlEncode(const std::string &value) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string encoded;
+    for (unsigned char ch : value) {
+        if (std::isalnum(ch) || ch == '-' || ch == '_' || ch == '.' || ch == '~') {
+            encoded += static_cast<char>(ch);
+        } else {
+            encoded += '%';
+            encoded += digits[ch >> 4];
+            encoded += digits[ch & 0x0f];
+        }
+    }
+    return encoded;
+}
+
+/**
+* @brief Экранировать строку для вывода в тексте и атрибутах HTML.
+* @param value Строка.
+* @return Строка, в которой &, <, >, " и ' заменены на ссылки на символы.
+*/
+inline std::string htmlEscape(const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char ch : value) {
+        switch (ch) {
+            case '&':
+                escaped += "&amp;";
+                break;
+            case '<':
+                escaped += "&lt;";
+                break;
+            case '>':
+                escaped += "&gt;";
+                break;
+            case '"':
+                escaped += "&quot;";
+                break;
+            case '\'':
+                escaped += "&#39;";
+                break;
+            default:
+                escaped += ch;
+        }
+    }
+    return escaped;
+}
 
 /**
 * @brief Получить строку с HTML кодом стартовой страницы запроса.
@@ -97,6 +153,18 @@ inline std::string createSearchPage() {
         .search-button:active {
             transform: translateY(0);
         }
+
+        .fuzzy-option {
+            color: #666;
+            font-size: 0.95rem;
+            text-align: left;
+        }
+
+        .syntax-hint {
+            color: #888;
+            font-size: 0.85rem;
+            margin-top: 20px;
+        }
     </style>
 </head>
 <body>
@@ -104,9 +172,14 @@ inline std::string createSearchPage() {
         <div class="logo">Search</div>
         <p class="tagline">Find what you're looking for</p>
         <form method="POST" class="search-form">
-            <input type="text" name="query" placeholder="Enter your search query..." maxlength="100" required class="search-input">
+            <input type="text" name="query" placeholder="Enter your search query..." maxlength="500" required class="search-input">
+            <label class="fuzzy-option">
+                <input type="checkbox" name="fuzzy" value="1"> Fix typos
+            </label>
             <button type="submit" class="search-button">Search</button>
         </form>
+        <p class="syntax-hint">Use AND, OR, NOT (or -word), parentheses, "exact phrases"
+            and site:example.com</p>
     </div>
 </body>
 </html>
@@ -115,13 +188,19 @@ inline std::string createSearchPage() {
 
 /**
 * @brief Получить строку с HTML кодом страницы с ответами на запрос.
-* @param results Результаты поиска в БД.
+* @param results Результаты поиска по убыванию релевантности.
+* @param offset Номер первого выводимого результата.
+* @param limit Число выводимых результатов.
 * @param query Строка с запросом.
+* @param fuzzy В запросе исправлялись опечатки.
+* @param corrections Исправленные слова запроса.
 * @return Строка с HTML страницей.
 */
-inline std::string createResultsPage(
-        const std::map<int, std::string, std::greater<int>> &results, const std::string &query) {
+inline std::string createResultsPage(const SearchResults &results, size_t offset, size_t limit,
+        const std::string &query, bool fuzzy, const std::vector<Correction> &corrections) {
     std::stringstream html;
+    const size_t begin = std::min(offset, results.size());
+    const size_t end = std::min(results.size(), begin + limit);
 
     html << R"(
 <!DOCTYPE html>
@@ -129,7 +208,7 @@ inline std::string createResultsPage(
 <head>
     <meta charset="UTF-8">
     <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>Results for )" << query << R"(</title>
+    <title>Results for )" << htmlEscape(query) << R"(</title>
     <style>
         * {
             margin: 0;
@@ -169,6 +248,12 @@ inline std::string createResultsPage(
             margin-bottom: 20px;
         }
 
+        .corrections {
+            color: #666;
+            margin-bottom: 10px;
+            font-size: 1rem;
+        }
+
         .results-count {
             color: #666;
             margin-bottom: 25px;
@@ -248,7 +333,9 @@ inline std::string createResultsPage(
         }
 
         .footer {
-            text-align: center;
+            display: flex;
+            justify-content: center;
+            gap: 10px;
             margin-top: 40px;
         }
     </style>
@@ -257,17 +344,36 @@ inline std::string createResultsPage(
     <div class="header">
         <div class="container">
             <div class="logo">Search Results</div>
-            <div class="search-query">)" << query << R"(</div>
+            <div class="search-query">)" << htmlEscape(query) << R"(</div>
         </div>
     </div>
 
-    <div class="container" style="margin-top: 30px;">
+    <div class="container" style="margin-top: 30px;">)";
+
+    if (!corrections.empty()) {
+        html << R"(
+        <div class="corrections">Showing results for corrected words: )";
+        for (size_t i = 0; i < corrections.size(); ++i) {
+            html << (i > 0 ? ", " : "") << "<s>" << htmlEscape(corrections[i].word)
+                 << "</s> &rarr; ";
+            for (size_t j = 0; j < corrections[i].corrections.size(); ++j) {
+                html << (j > 0 ? " or " : "") << "<b>"
+                     << htmlEscape(corrections[i].corrections[j]) << "</b>";
+            }
+        }
+        html << R"(</div>)";
+    }
+
+    html << R"(
         <div class="results-count">)";
 
     if (results.empty()) {
         html << "No results found";
     } else {
         html << "Found " << results.size() << " result" << (results.size() != 1 ? "s" : "");
+        if (begin < end) {
+            html << ", showing " << begin + 1 << "-" << end;
+        }
     }
 
     html << R"(</div>)";
@@ -283,12 +389,13 @@ inline std::string createResultsPage(
         html << R"(
         <div class="results-list">)";
 
-        for (const auto &result : results) {
+        for (size_t i = begin; i < end; ++i) {
+            const SearchResult &result = results[i];
             html << R"(
             <div class="result-item">
-                <a href=")" << result.second << R"(" class="result-link" target="_blank">)"
-                   << result.second << R"(</a>
-                <div class="result-score">Relevance score: )" << result.first << R"(</div>
+                <a href=")" << htmlEscape(result.url) << R"(" class="result-link" target="_blank">)"
+                   << htmlEscape(result.url) << R"(</a>
+                <div class="result-score">Relevance score: )" << result.score << R"(</div>
             </div>)";
         }
 
@@ -297,7 +404,22 @@ inline std::string createResultsPage(
     }
 
     html << R"(
-        <div class="footer">
+        <div class="footer">)";
+
+    // Соседние страницы выдачи запрашиваются GET запросом с тем же текстом запроса.
+    const std::string pageLink = "/?q=" + urlEncode(query) + (fuzzy ? "&fuzzy=1" : "") +
+            "&offset=";
+    if (begin > 0) {
+        html << R"(
+            <a href=")" << pageLink << (begin > limit ? begin - limit : 0)
+             << R"(" class="back-button">Previous</a>)";
+    }
+    if (end < results.size()) {
+        html << R"(
+            <a href=")" << pageLink << end << R"(" class="back-button">Next</a>)";
+    }
+
+    html << R"(
             <a href="/" class="back-button">New Search</a>
         </div>
     </div>
@@ -393,7 +515,7 @@ inline std::string createErrorPage(const std::string &error) {
     <div class="container">
         <div class="error-icon">⚠️</div>
         <h1>Something went wrong</h1>
-        <div class="error-message">)" + error + R"(</div>
+        <div class="error-message">)" + htmlEscape(error) + R"(</div>
         <a href="/" class="back-button">Back to Search</a>
     </div>
 </body>
@@ -3,27 +3,53 @@
 #include <sstream>
 #include <algorithm>
 #include "html_tamplates.h"
+#include "json_templates.h"
+#include "../index/postings_codec.h"
 
-HTTPSession::HTTPSession(tcp::socket socket, DatabaseManager *dbManager) :
-socket_(std::move(socket)),
-dbManager_(dbManager) {
+HTTPSession::HTTPSession(tcp::socket socket, ServerContext &context) :
+stream_(std::move(socket)),
+context_(context) {
 }
 
 void HTTPSession::start() {
-    readRequest();
+    net::dispatch(stream_.get_executor(), [self = shared_from_this()]() {
+        self->readRequest();
+    });
 }
 
 void HTTPSession::readRequest() {
-    auto self = shared_from_this();
+    // Объект запроса переиспользуется соединением, поэтому очищается перед каждым чтением.
+    request_ = {};
+    stream_.expires_after(context_.idleTimeout);
 
-    http::async_read(socket_, buffer_, request_,
+    auto self = shared_from_this();
+    http::async_read(stream_, buffer_, request_,
             [self](beast::error_code ec, std::size_t bytes_transferred) {
-                if (!ec) {
-                    self->processRequest();
+                // Клиент закрыл соединение или оно простояло дольше времени ожидания.
+                if (ec == http::error::end_of_stream || ec == beast::error::timeout ||
+                        ec == net::error::operation_aborted) {
+                    self->closeConnection();
+                    return;
+                }
+                if (ec) {
+                    std::cerr << "HTTPSession::readRequest: Read error: " << ec.message()
+                              << std::endl;
+                    return;
                 }
+                self->processRequest();
             });
 }
 
+void HTTPSession::closeConnection() {
+    beast::error_code shutdown_ec;
+    stream_.socket().shutdown(tcp::socket::shutdown_send, shutdown_ec);
+
+    if (shutdown_ec && shutdown_ec != beast::errc::not_connected) {
+        std::cerr << "HTTPSession::closeConnection: Shutdown error: " << shutdown_ec.message()
+                  << std::endl;
+    }
+}
+
 void HTTPSession::processRequest() {
     // Игнорируем запросы к favicon.ico
     if (request_.target() == "/favicon.ico") {
@@ -39,8 +65,34 @@ void HTTPSession::processRequest() {
         return;
     }
 
-    // Обрабатываем только корневой путь
-    if (request_.target() != "/") {
+    const std::string target(request_.target());
+    const size_t question = target.find('?');
+    const std::string path = target.substr(0, question);
+    const std::map<std::string, std::string> params = (question == std::string::npos) ?
+            std::map<std::string, std::string>() : parseUrlParams(target.substr(question + 1));
+
+    if (path == "/api/search") {
+        if (request_.method() != http::verb::get) {
+            sendResponse(createErrorJson("Method not allowed"), http::status::method_not_allowed,
+                    "application/json");
+            return;
+        }
+        handleApiSearch(params);
+        return;
+    }
+
+    if (path == "/api/suggest") {
+        if (request_.method() != http::verb::get) {
+            sendResponse(createErrorJson("Method not allowed"), http::status::method_not_allowed,
+                    "application/json");
+            return;
+        }
+        handleApiSuggest(params);
+        return;
+    }
+
+    // Страница поиска обслуживается только по корневому пути
+    if (path != "/") {
         std::cout << " HTTPSession::processRequest: Unknown target: " << request_.target()
                   << std::endl;
         sendResponse("Not found", http::status::not_found);
@@ -49,7 +101,7 @@ void HTTPSession::processRequest() {
 
     switch (request_.method()) {
         case http::verb::get:
-            handleGet();
+            handleGet(params);
             break;
         case http::verb::post:
             handlePost();
@@ -59,141 +111,375 @@ void HTTPSession::processRequest() {
     }
 }
 
-void HTTPSession::handleGet() {
-    std::string html = createSearchPage();
-    sendResponse(html);
+void HTTPSession::handleGet(const std::map<std::string, std::string> &params) {
+    auto query = params.find("q");
+    if (query == params.end()) {
+        std::string html = createSearchPage();
+        sendResponse(html);
+        return;
+    }
+
+    SearchRequest request;
+    request.query = query->second;
+    request.limit = context_.pageSize;
+    if (!readSizeParam(params, "offset", request.offset) ||
+            !readFlagParam(params, "fuzzy", request.fuzzy)) {
+        sendError(request, "Invalid offset or fuzzy", http::status::bad_request);
+        return;
+    }
+    handleSearch(std::move(request));
 }
 
 void HTTPSession::handlePost() {
-    try {
-        std::string body = beast::buffers_to_string(request_.body().data());
-        std::string query = parseFormData(body);
+    // Поля формы кодируются так же, как параметры URL.
+    const std::map<std::string, std::string> form =
+            parseUrlParams(beast::buffers_to_string(request_.body().data()));
+
+    SearchRequest request;
+    auto query = form.find("query");
+    if (query != form.end()) {
+        request.query = query->second;
+    }
+    request.limit = context_.pageSize;
+    if (!readFlagParam(form, "fuzzy", request.fuzzy)) {
+        sendError(request, "Invalid fuzzy", http::status::bad_request);
+        return;
+    }
+    handleSearch(std::move(request));
+}
+
+void HTTPSession::handleApiSearch(const std::map<std::string, std::string> &params) {
+    SearchRequest request;
+    request.json = true;
+    request.limit = context_.pageSize;
+
+    auto query = params.find("q");
+    if (query == params.end()) {
+        sendError(request, "Missing parameter q", http::status::bad_request);
+        return;
+    }
+    request.query = query->second;
+
+    if (!readSizeParam(params, "offset", request.offset) ||
+            !readSizeParam(params, "limit", request.limit) ||
+            !readFlagParam(params, "fuzzy", request.fuzzy)) {
+        sendError(request, "Invalid offset, limit or fuzzy", http::status::bad_request);
+        return;
+    }
+    request.limit = std::min(std::max<size_t>(request.limit, 1), context_.maxPageSize);
+
+    auto cursor = params.find("cursor");
+    if (cursor != params.end()) {
+        request.cursor = cursor->second;
+    }
+    handleSearch(std::move(request));
+}
+
+void HTTPSession::handleApiSuggest(const std::map<std::string, std::string> &params) {
+    if (!context_.suggester) {
+        sendResponse(createErrorJson("Suggestions are disabled"), http::status::not_found,
+                "application/json");
+        return;
+    }
+
+    auto prefix = params.find("prefix");
+    if (prefix == params.end()) {
+        sendResponse(createErrorJson("Missing parameter prefix"), http::status::bad_request,
+                "application/json");
+        return;
+    }
 
+    size_t limit = context_.suggester->maxSuggestions();
+    if (!readSizeParam(params, "limit", limit)) {
+        sendResponse(createErrorJson("Invalid limit"), http::status::bad_request,
+                "application/json");
+        return;
+    }
+
+    const std::string normalized = context_.analyzer->normalizePrefix(prefix->second);
+    std::vector<Suggestion> suggestions;
+    if (!normalized.empty()) {
+        suggestions = context_.suggester->suggest(normalized, limit);
+    }
+    sendResponse(createSuggestJson(prefix->second, suggestions), http::status::ok,
+            "application/json");
+}
+
+void HTTPSession::handleSearch(SearchRequest request) {
+    try {
         // std::cout << "HTTPSession::processRequest: Search query: " << query << std::endl;
 
-        auto words = parseQuery(query);
-        if (words.empty() || words.size() > 4) {
-            sendResponse(createErrorPage("Query must contain 1-4 words"),
-                    http::status::bad_request);
-            return;
+        // Поколение читается до обращения к кэшу и к хранилищу: результаты поиска, начатого
+        // до очистки кэша, в кэш не попадут.
+        if (context_.cache) {
+            request.cacheGeneration = context_.cache->generation();
         }
 
-        for (auto &val : words) {
-            std::cout << val << std::endl;
+        // Готовая страница популярного запроса отдается без разбора и поиска. Страницы с
+        // исправлениями опечаток не кэшируются: они зависят от словаря, а не только от запроса.
+        if (context_.cache && !request.json && !request.fuzzy) {
+            std::shared_ptr<const std::string> cached =
+                    context_.cache->getHtml(request.query, request.offset);
+            if (cached) {
+                sendResponse(*cached);
+                return;
+            }
         }
 
-        std::map<int, std::string, std::greater<int> > results;
-        dbManager_->searchWords(results, words);
-        if (results.empty()) {
-            sendResponse(createErrorPage("Not found"),
-                    http::status::bad_request);
+        QueryNode query;
+        std::string error;
+        if (!context_.parser->parse(request.query, query, error)) {
+            sendError(request, error, http::status::bad_request);
             return;
         }
-        // for (auto &val : results) {
-        //     std::cout << val.first << " " << val.second << std::endl;
-        // }
-
-        // std::string test_html = R"(
-        //     <!DOCTYPE html>
-        //     <html>
-        //     <head><title>Search Results</title></head>
-        //     <body>
-        //         <h1>Search Results</h1>
-        //         <p>Query: )" + query + R"(</p>
-        //         <p>Search functionality not implemented yet</p>
-        //         <a href="/">New search</a>
-        //     </body>
-        //     </html>
-        // )";
-
-        std::string html = createResultsPage(results, query);
-        sendResponse(html);
+
+        // Исправление ищется в памяти за микросекунды, поэтому выполняется до кэша и пула:
+        // исправленный запрос ищется и кэшируется как обычный.
+        if (request.fuzzy && context_.suggester) {
+            request.corrections = context_.suggester->correct(query);
+        }
+
+        std::string key;
+        if (context_.cache) {
+            key = QueryParser::canonical(query);
+            std::shared_ptr<const QueryCache::Results> cached = context_.cache->getResults(key);
+            if (cached) {
+                sendResults(*cached, std::move(request));
+                return;
+            }
+        }
+
+        searchAsync(std::move(query), std::move(key), std::move(request));
 
     } catch (const std::exception &e) {
-        std::cerr << "HTTPSession::handlePost: Error processing POST request: " << e.what()
+        std::cerr << "HTTPSession::handleSearch: Error processing search request: " << e.what()
                   << std::endl;
-        sendResponse(createErrorPage("Internal server error"), http::status::internal_server_error);
+        sendError(request, "Internal server error", http::status::internal_server_error);
     }
 }
 
-void HTTPSession::sendResponse(const std::string &content, http::status status) {
+void HTTPSession::sendResponse(const std::string &content, http::status status,
+        const std::string &contentType) {
+    response_ = {};
+    response_.version(request_.version());
+    response_.keep_alive(request_.keep_alive());
     response_.result(status);
     response_.set(http::field::server, "Search Engine");
-    response_.set(http::field::content_type, "text/html; charset=utf-8");
+    response_.set(http::field::content_type, contentType);
     beast::ostream(response_.body()) << content;
 
     response_.prepare_payload();
+    stream_.expires_after(context_.idleTimeout);
 
     auto self = shared_from_this();
-    http::async_write(socket_, response_,
+    http::async_write(stream_, response_,
             [self](beast::error_code ec, std::size_t bytes_transferred) {
-                if (!ec) {
-                    std::cout
-                            << "HTTPSession::sendResponse: Response sent successfully for session: "
-                            << self.get() << std::endl;
-                } else {
+                if (ec) {
                     std::cerr << "HTTPSession::sendResponse:: Write error: " << ec.message()
                               << std::endl;
+                    return;
                 }
 
-                beast::error_code shutdown_ec;
-                self->socket_.shutdown(tcp::socket::shutdown_send, shutdown_ec);
-
-                if (shutdown_ec && shutdown_ec != beast::errc::not_connected) {
-                    std::cerr << "HTTPSession::sendResponse: Shutdown error: "
-                              << shutdown_ec.message() << std::endl;
+                // Соединение остается открытым для следующего запроса, если клиент
+                // не просил его закрыть.
+                if (self->response_.need_eof()) {
+                    self->closeConnection();
+                    return;
                 }
-
-                // self->socket_.shutdown(tcp::socket::shutdown_send, ec);
+                self->readRequest();
             });
 }
 
-std::string HTTPSession::parseFormData(const std::string &body) {
-    if (body.find("query=") == 0) {
-        std::string encoded_query = body.substr(6);
-
-        std::string decoded;
-        for (size_t i = 0; i < encoded_query.size(); ++i) {
-            if (encoded_query[i] == '+') {
-                decoded += ' ';
-            } else if (encoded_query[i] == '%' && i + 2 < encoded_query.size()) {
-                std::string hex = encoded_query.substr(i + 1, 2);
-                char ch = static_cast<char>(std::stoi(hex, nullptr, 16));
-                decoded += ch;
-                i += 2;
-            } else {
-                decoded += encoded_query[i];
-            }
+void HTTPSession::sendError(const SearchRequest &request, const std::string &error,
+        http::status status) {
+    if (request.json) {
+        sendResponse(createErrorJson(error), status, "application/json");
+    } else {
+        sendResponse(createErrorPage(error), status);
+    }
+}
+
+std::string HTTPSession::urlDecode(const std::string &encoded) {
+    std::string decoded;
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        if (encoded[i] == '+') {
+            decoded += ' ';
+        } else if (encoded[i] == '%' && i + 2 < encoded.size() &&
+                std::isxdigit(static_cast<unsigned char>(encoded[i + 1])) &&
+                std::isxdigit(static_cast<unsigned char>(encoded[i + 2]))) {
+            std::string hex = encoded.substr(i + 1, 2);
+            char ch = static_cast<char>(std::stoi(hex, nullptr, 16));
+            decoded += ch;
+            i += 2;
+        } else {
+            decoded += encoded[i];
+        }
+    }
+    return decoded;
+}
+
+std::map<std::string, std::string> HTTPSession::parseUrlParams(const std::string &params) {
+    std::map<std::string, std::string> result;
+    std::stringstream ss(params);
+    std::string pair;
+
+    while (std::getline(ss, pair, '&')) {
+        const size_t equals = pair.find('=');
+        if (equals == std::string::npos) {
+            result[urlDecode(pair)] = "";
+        } else {
+            result[urlDecode(pair.substr(0, equals))] = urlDecode(pair.substr(equals + 1));
         }
-        return decoded;
     }
-    return "";
+
+    return result;
 }
 
-std::vector<std::string> HTTPSession::parseQuery(const std::string &query) {
-    std::vector<std::string> words;
-    std::stringstream ss(query);
-    std::string word;
+bool HTTPSession::readSizeParam(const std::map<std::string, std::string> &params,
+        const std::string &name, size_t &value) {
+    auto it = params.find(name);
+    if (it == params.end()) {
+        return true;
+    }
+    if (it->second.empty() || it->second.size() > 9 ||
+            !std::all_of(it->second.begin(), it->second.end(), ::isdigit)) {
+        return false;
+    }
+    value = std::stoul(it->second);
+    return true;
+}
 
-    while (ss >> word) {
-        word.erase(std::remove_if(word.begin(), word.end(), [](char c) { return std::ispunct(c); }),
-                word.end());
+bool HTTPSession::readFlagParam(const std::map<std::string, std::string> &params,
+        const std::string &name, bool &value) {
+    auto it = params.find(name);
+    if (it == params.end()) {
+        return true;
+    }
+    if (it->second == "1" || it->second == "true" || it->second == "on") {
+        value = true;
+    } else if (it->second == "0" || it->second == "false") {
+        value = false;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+std::string HTTPSession::makeCursor(const SearchResult &result) {
+    return toHex(std::to_string(result.score) + ":" + result.url);
+}
 
-        if (!word.empty()) {
-            words.push_back(word);
+bool HTTPSession::resolveCursor(const SearchResults &results, const std::string &cursor,
+        size_t &offset) {
+    const std::string decoded = fromHex(cursor);
+    const size_t colon = decoded.find(':');
+    if (colon == std::string::npos || colon == 0 || decoded.size() != cursor.size() / 2) {
+        return false;
+    }
+
+    int score = 0;
+    try {
+        score = std::stoi(decoded.substr(0, colon));
+    } catch (const std::exception &) {
+        return false;
+    }
+    const std::string url = decoded.substr(colon + 1);
+
+    // Результаты упорядочены по убыванию оценки, равные оценки - в порядке поступления.
+    // Выдача продолжается сразу после последнего выданного результата; если его больше нет,
+    // то с первого результата с меньшей оценкой.
+    offset = results.size();
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].score == score && results[i].url == url) {
+            offset = i + 1;
+            break;
+        }
+        if (results[i].score < score) {
+            offset = i;
+            break;
         }
     }
+    return true;
+}
+
+std::shared_ptr<const QueryCache::Results> HTTPSession::search(const QueryNode &query,
+        const std::string &key, uint64_t generation) {
+    QueryCache::Results results;
+    context_.storage->search(results, query);
+
+    if (context_.cache) {
+        return context_.cache->putResults(key, std::move(results), generation);
+    }
+    return std::make_shared<const QueryCache::Results>(std::move(results));
+}
 
-    return words;
+void HTTPSession::searchAsync(QueryNode query, std::string key, SearchRequest request) {
+    // Очередь пула ограничена: при перегрузке хранилища запрос отклоняется сразу, а не
+    // ждет, пока истечет время ожидания клиента.
+    if (context_.pendingSearches.fetch_add(1) >= context_.maxPendingSearches) {
+        --context_.pendingSearches;
+        sendError(request, "Server is busy, try again later", http::status::service_unavailable);
+        return;
+    }
+
+    auto self = shared_from_this();
+    net::post(*context_.searchPool, [self, query = std::move(query), key = std::move(key),
+            request = std::move(request)]() mutable {
+        std::shared_ptr<const QueryCache::Results> results;
+        try {
+            results = self->search(query, key, request.cacheGeneration);
+        } catch (const std::exception &e) {
+            std::cerr << "HTTPSession::searchAsync: Error: " << e.what() << std::endl;
+        }
+        --self->context_.pendingSearches;
+
+        net::post(self->stream_.get_executor(), [self, results,
+                request = std::move(request)]() mutable {
+            if (!results) {
+                self->sendError(request, "Internal server error",
+                        http::status::internal_server_error);
+                return;
+            }
+            self->sendResults(*results, std::move(request));
+        });
+    });
+}
+
+void HTTPSession::sendResults(const QueryCache::Results &results, SearchRequest request) {
+    if (!request.cursor.empty() && !resolveCursor(results, request.cursor, request.offset)) {
+        sendError(request, "Invalid cursor", http::status::bad_request);
+        return;
+    }
+
+    if (request.json) {
+        // Пустой результат в API - не ошибка, а пустая страница выдачи.
+        std::string nextCursor;
+        if (request.offset + request.limit < results.size()) {
+            nextCursor = makeCursor(results[request.offset + request.limit - 1]);
+        }
+        sendResponse(createSearchJson(results, request.offset, request.limit, request.query,
+                request.corrections, nextCursor), http::status::ok, "application/json");
+        return;
+    }
+
+    if (results.empty()) {
+        sendResponse(createErrorPage("Not found"), http::status::bad_request);
+        return;
+    }
+
+    std::string html = createResultsPage(results, request.offset, request.limit, request.query,
+            request.fuzzy, request.corrections);
+    if (context_.cache && !request.fuzzy) {
+        context_.cache->putHtml(request.query, request.offset, html, request.cacheGeneration);
+    }
+    sendResponse(html);
 }
 
 HTTPServer::HTTPServer(net::io_context &ioc, const tcp::endpoint &endpoint,
-        DatabaseManager *dbManager) :
+        ServerContext &context) :
 ioc_(ioc),
 acceptor_(ioc),
-dbManager_(dbManager) {
+context_(context) {
     beast::error_code ec;
 
     acceptor_.open(endpoint.protocol(), ec);
@@ -223,9 +509,13 @@ void HTTPServer::start() {
 }
 
 void HTTPServer::acceptConnection() {
-    acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+    // Каждое соединение получает свой strand: обработчики одной сессии не выполняются
+    // параллельно, даже когда io_context обслуживают несколько потоков.
+    acceptor_.async_accept(net::make_strand(ioc_), [this](beast::error_code ec,
+            tcp::socket socket) {
         if (!ec) {
-            std::make_shared<HTTPSession>(std::move(socket), dbManager_)->start();
+            auto session = std::make_shared<HTTPSession>(std::move(socket), context_);
+            session->start();
         } else {
             std::cerr << "HTTPServer::acceptConnection: Accept error: " << ec.message()
                       << std::endl;
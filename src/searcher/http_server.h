@@ -2,26 +2,72 @@
 
 #include <boost/beast.hpp>
 #include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
 #include <string>
-#include "../database_manager/database_manager.h"
+#include "../storage/storage.h"
+#include "query_cache.h"
+#include "query_parser.h"
+#include "suggest_index.h"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
 
+/**
+* @brief Общие для всех сессий объекты сервера.
+*/
+struct ServerContext {
+    Storage *storage = nullptr; //!< Хранилище индекса.
+    const QueryParser *parser = nullptr; //!< Разбор строки запроса в дерево.
+    const Analyzer *analyzer = nullptr; //!< Нормализация префикса для автодополнения.
+    const Suggester *suggester = nullptr; //!< Подсказки, nullptr - выключены.
+    QueryCache *cache = nullptr; //!< Кэш результатов поиска, nullptr - без кэша.
+    net::thread_pool *searchPool = nullptr; //!< Пул потоков для поиска в хранилище.
+    size_t maxPendingSearches = 256; //!< Число ожидающих поисков, сверх которого - отказ.
+    std::atomic<size_t> pendingSearches {0}; //!< Число поисков в очереди пула и в работе.
+    std::chrono::seconds idleTimeout {30}; //!< Время ожидания запроса и отправки ответа.
+    size_t pageSize = 10; //!< Число результатов на странице выдачи по умолчанию.
+    size_t maxPageSize = 100; //!< Наибольшее число результатов на странице выдачи.
+};
+
+/**
+* @brief Поисковый запрос с параметрами страницы выдачи.
+* @details Общий для HTML страницы результатов и JSON API: оба ответа строятся по одним
+* и тем же результатам поиска, различается только формат.
+*/
+struct SearchRequest {
+    std::string query; //!< Исходный текст запроса.
+    size_t offset = 0; //!< Номер первого выдаваемого результата.
+    size_t limit = 10; //!< Число выдаваемых результатов.
+    std::string cursor; //!< Курсор продолжения выдачи; если задан, offset вычисляется по нему.
+    bool json = false; //!< Ответ в формате JSON.
+    bool fuzzy = false; //!< Исправлять опечатки в словах запроса.
+    std::vector<Correction> corrections; //!< Исправленные слова запроса.
+    uint64_t cacheGeneration = 0; //!< Поколение кэша на момент получения запроса.
+};
+
 /**
 * @brief HTTP сессия.
+* @details Обслуживает постоянное соединение HTTP/1.1: после ответа читает следующий запрос,
+* пока клиент не попросит закрыть соединение (Connection: close, HTTP/1.0 без keep-alive)
+* или соединение не простоит дольше времени ожидания. Запросы, отправленные конвейером,
+* обрабатываются по очереди: следующий читается из буфера только после отправки ответа
+* на предыдущий.
+* Поиск в хранилище блокирует поток, поэтому выполняется в пуле searchPool, а результат
+* возвращается в strand сессии: потоки io_context заняты только сетевым вводом-выводом.
 */
 class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
 public:
     /**
     * @brief Конструктор.
-    * @param socket Сокет.
-    * @param dbManager Указатель на класс менеджера БД.
+    * @param socket Сокет, привязанный к strand сессии.
+    * @param context Общие объекты сервера.
     */
-    HTTPSession(tcp::socket socket, DatabaseManager *dbManager);
+    HTTPSession(tcp::socket socket, ServerContext &context);
 
     /**
     * @brief Запустить сессию.
@@ -34,47 +80,150 @@ private:
     */
     void readRequest();
 
+    /**
+    * @brief Закрыть соединение на запись после последнего ответа.
+    */
+    void closeConnection();
+
     /**
     * @brief Обработать запрос.
     */
     void processRequest();
 
     /**
-    * @brief Обработать GET запрос.
+    * @brief Обработать GET запрос к странице поиска.
+    * @details Без параметра q отдает стартовую страницу, с ним - страницу результатов.
+    * @param params Параметры URL.
     */
-    void handleGet();
+    void handleGet(const std::map<std::string, std::string> &params);
 
     /**
-    * @brief Обработать POST запрос.
+    * @brief Обработать POST запрос формы поиска.
     */
     void handlePost();
 
+    /**
+    * @brief Обработать GET запрос к /api/search.
+    * @param params Параметры URL: q, offset, limit, cursor, fuzzy.
+    */
+    void handleApiSearch(const std::map<std::string, std::string> &params);
+
+    /**
+    * @brief Обработать GET запрос к /api/suggest.
+    * @details Дополнение ищется в памяти за микросекунды, поэтому выполняется прямо в
+    * потоке ввода-вывода, без пула поиска.
+    * @param params Параметры URL: prefix, limit.
+    */
+    void handleApiSuggest(const std::map<std::string, std::string> &params);
+
+    /**
+    * @brief Разобрать запрос, найти результаты в кэше или передать поиск в пул.
+    * @param request Поисковый запрос.
+    */
+    void handleSearch(SearchRequest request);
+
     /**
     * @brief Отправить ответ на запрос.
-    * @param content Строка с HTML кодом страницы-ответа.
+    * @param content Строка с телом ответа.
     * @param status Статус.
+    * @param contentType Тип содержимого.
+    */
+    void sendResponse(const std::string &content, http::status status = http::status::ok,
+            const std::string &contentType = "text/html; charset=utf-8");
+
+    /**
+    * @brief Отправить ошибку в формате запроса: HTML страницу или JSON объект.
+    * @param request Поисковый запрос.
+    * @param error Ошибка.
+    * @param status Статус.
+    */
+    void sendError(const SearchRequest &request, const std::string &error, http::status status);
+
+    /**
+    * @brief Раскодировать строку из параметра URL или формы: "+" и %XX.
+    * @param encoded Закодированная строка.
+    * @return Раскодированная строка.
+    */
+    static std::string urlDecode(const std::string &encoded);
+
+    /**
+    * @brief Разобрать строку параметров вида "a=1&b=2".
+    * @param params Строка параметров без "?".
+    * @return Раскодированные параметры по имени.
+    */
+    static std::map<std::string, std::string> parseUrlParams(const std::string &params);
+
+    /**
+    * @brief Прочитать неотрицательное целое из параметра.
+    * @param params Параметры URL.
+    * @param name Имя параметра.
+    * @param value Значение; не меняется, если параметра нет.
+    * @return false, если параметр задан и не является числом.
+    */
+    static bool readSizeParam(const std::map<std::string, std::string> &params,
+            const std::string &name, size_t &value);
+
+    /**
+    * @brief Прочитать флаг из параметра: "1", "true" или "on" - да, "0" или "false" - нет.
+    * @param params Параметры URL.
+    * @param name Имя параметра.
+    * @param value Значение; не меняется, если параметра нет.
+    * @return false, если параметр задан и не является флагом.
+    */
+    static bool readFlagParam(const std::map<std::string, std::string> &params,
+            const std::string &name, bool &value);
+
+    /**
+    * @brief Построить курсор продолжения выдачи после результата.
+    * @details Курсор хранит оценку и URL последнего выданного результата, поэтому
+    * следующая страница продолжается с того же места, даже если результаты перед ним
+    * изменились после обновления индекса.
+    * @param result Последний выданный результат.
+    * @return Непрозрачная строка курсора.
+    */
+    static std::string makeCursor(const SearchResult &result);
+
+    /**
+    * @brief Найти номер первого результата страницы, продолжающей выдачу после курсора.
+    * @param results Результаты поиска.
+    * @param cursor Курсор из makeCursor.
+    * @param offset Номер первого результата для записи.
+    * @return false, если курсор поврежден.
+    */
+    static bool resolveCursor(const SearchResults &results, const std::string &cursor,
+            size_t &offset);
+
+    /**
+    * @brief Выполнить поиск в хранилище и сохранить результаты в кэш.
+    * @details Блокирует поток, вызывается в пуле searchPool.
+    * @param query Дерево запроса.
+    * @param key Ключ запроса в кэше.
+    * @param generation Поколение кэша, прочитанное до поиска.
+    * @return Результаты поиска.
     */
-    void sendResponse(const std::string &content, http::status status = http::status::ok);
+    std::shared_ptr<const QueryCache::Results> search(const QueryNode &query,
+            const std::string &key, uint64_t generation);
 
     /**
-    * @brief Получить слова для поиска из строки с запросом.
-    * @param body Строка с HTML кодом запроса.
-    * @return Строка со словами запроса.
+    * @brief Передать поиск в пул searchPool и отправить ответ по его завершении.
+    * @param query Дерево запроса.
+    * @param key Ключ запроса в кэше.
+    * @param request Поисковый запрос.
     */
-    std::string parseFormData(const std::string &body);
+    void searchAsync(QueryNode query, std::string key, SearchRequest request);
 
     /**
-    * @brief Разить строку со словами на отдельные строки.
-    * @param query Строка со словами.
-    * @return Вектор из отдельных слов запроса.
+    * @brief Отправить страницу результатов поиска.
+    * @param results Результаты поиска.
+    * @param request Поисковый запрос.
     */
-    std::vector<std::string> parseQuery(const std::string &query);
+    void sendResults(const QueryCache::Results &results, SearchRequest request);
 
-    tcp::socket socket_; //!< Сокет.
+    beast::tcp_stream stream_; //!< Поток соединения с тайм-аутами.
     beast::flat_buffer buffer_ {8192}; //!< Буффер.
     http::request<http::dynamic_body> request_; //!< Запрос.
     http::response<http::dynamic_body> response_; //!< Ответ.
-    DatabaseManager *dbManager_; //!< Объект взаимодействия с psql.
+    ServerContext &context_; //!< Общие объекты сервера.
 };
 
 /**
@@ -82,7 +231,7 @@ private:
 */
 class HTTPServer {
 public:
-    HTTPServer(net::io_context &ioc, const tcp::endpoint &endpoint, DatabaseManager *dbManager);
+    HTTPServer(net::io_context &ioc, const tcp::endpoint &endpoint, ServerContext &context);
 
     /**
     * @brief Запустить сервер.
@@ -94,5 +243,5 @@ private:
 
     net::io_context &ioc_;
     tcp::acceptor acceptor_;
-    DatabaseManager *dbManager_;
+    ServerContext &context_;
 };
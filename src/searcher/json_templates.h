@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "../common_data.h"
+#include "suggest_index.h"
+
+/**
+* @brief Экранировать строку для записи в JSON.
+* @param value Строка в UTF-8.
+* @return Строка без кавычек вокруг, в которой экранированы кавычки, обратная косая черта
+* и управляющие символы.
+*/
+inline std::string jsonEscape(const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (unsigned char ch : value) {
+        switch (ch) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (ch < 0x20) {
+                    char code[7];
+                    std::snprintf(code, sizeof(code), "\\u%04x", ch);
+                    escaped += code;
+                } else {
+                    escaped += static_cast<char>(ch);
+                }
+        }
+    }
+    return escaped;
+}
+
+/**
+* @brief Получить JSON ответ с одной страницей результатов поиска.
+* @param results Результаты поиска по убыванию релевантности.
+* @param offset Номер первого выдаваемого результата.
+* @param limit Число выдаваемых результатов.
+* @param query Строка с запросом.
+* @param corrections Исправленные слова запроса.
+* @param nextCursor Курсор следующей страницы, пустой - страница последняя.
+* @return Строка с JSON объектом.
+*/
+inline std::string createSearchJson(const SearchResults &results, size_t offset, size_t limit,
+        const std::string &query, const std::vector<Correction> &corrections,
+        const std::string &nextCursor) {
+    const size_t begin = std::min(offset, results.size());
+    const size_t end = std::min(results.size(), begin + limit);
+
+    std::stringstream json;
+    json << "{\"query\":\"" << jsonEscape(query) << "\",\"corrections\":[";
+    for (size_t i = 0; i < corrections.size(); ++i) {
+        json << (i > 0 ? "," : "") << "{\"word\":\"" << jsonEscape(corrections[i].word)
+             << "\",\"corrections\":[";
+        for (size_t j = 0; j < corrections[i].corrections.size(); ++j) {
+            json << (j > 0 ? "," : "") << "\"" << jsonEscape(corrections[i].corrections[j])
+                 << "\"";
+        }
+        json << "]}";
+    }
+    json << "],\"total\":" << results.size()
+         << ",\"offset\":" << begin << ",\"limit\":" << limit << ",\"results\":[";
+    for (size_t i = begin; i < end; ++i) {
+        json << (i > begin ? "," : "") << "{\"rank\":" << i + 1
+             << ",\"score\":" << results[i].score
+             << ",\"url\":\"" << jsonEscape(results[i].url) << "\"}";
+    }
+    json << "],\"next_cursor\":";
+    if (nextCursor.empty()) {
+        json << "null";
+    } else {
+        json << "\"" << nextCursor << "\"";
+    }
+    json << "}";
+
+    return json.str();
+}
+
+/**
+* @brief Получить JSON ответ с дополнениями префикса.
+* @param prefix Префикс из запроса.
+* @param suggestions Дополнения по убыванию частоты.
+* @return Строка с JSON объектом.
+*/
+inline std::string createSuggestJson(const std::string &prefix,
+        const std::vector<Suggestion> &suggestions) {
+    std::stringstream json;
+    json << "{\"prefix\":\"" << jsonEscape(prefix) << "\",\"suggestions\":[";
+    for (size_t i = 0; i < suggestions.size(); ++i) {
+        json << (i > 0 ? "," : "") << "{\"term\":\"" << jsonEscape(suggestions[i].term)
+             << "\",\"frequency\":" << suggestions[i].frequency << "}";
+    }
+    json << "]}";
+
+    return json.str();
+}
+
+/**
+* @brief Получить JSON ответ с ошибкой.
+* @param error Ошибка.
+* @return Строка с JSON объектом.
+*/
+inline std::string createErrorJson(const std::string &error) {
+    return "{\"error\":\"" + jsonEscape(error) + "\"}";
+}
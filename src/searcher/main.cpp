@@ -1,19 +1,33 @@
 #include "http_server.h"
 // #include "database.hpp"
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
-#include "../database_manager/database_manager.h"
+#include "../analyzer/analyzer.h"
+#include "../storage/storage.h"
 
 /**
 * @brief Стартовая структура.
 */
 struct StartConfig {
-    std::string dbConnectionString;
-    int port;
+    StorageConfig storageConfig; //!< Параметры хранилища индекса.
+    int port = 8080; //!< Порт HTTP сервера.
+    int idleTimeoutSeconds = 30; //!< Время простоя постоянного соединения, с.
+    int ioThreads = 2; //!< Число потоков сетевого ввода-вывода.
+    size_t searchThreads = 4; //!< Число потоков поиска в хранилище.
+    size_t maxPendingSearches = 256; //!< Число ожидающих поисков, сверх которого - отказ.
+    size_t pageSize = 10; //!< Число результатов на странице выдачи по умолчанию.
+    size_t maxPageSize = 100; //!< Наибольшее число результатов на странице выдачи.
+    size_t maxQueryTerms = 32; //!< Наибольшее число слов и условий site: в запросе.
+    AnalyzerConfig analyzerConfig; //!< Параметры анализатора текста.
+    QueryCacheConfig cacheConfig; //!< Параметры кэша результатов поиска.
+    SuggestConfig suggestConfig; //!< Параметры подсказок.
 };
 
 /**
@@ -53,28 +67,122 @@ void readConfig(StartConfig &startConfig) {
     try {
         boost::property_tree::read_ini("../resources/config.ini", pt);
 
-        DatabaseConfig dbConfig;
-        dbConfig.host = pt.get<std::string>("Database.host");
-        dbConfig.port = pt.get<std::string>("Database.port");
-        dbConfig.dbname = pt.get<std::string>("Database.dbname");
-        dbConfig.user = pt.get<std::string>("Database.user");
-        dbConfig.password = pt.get<std::string>("Database.password");
-        startConfig.dbConnectionString = getConnectionString(dbConfig);
+        StorageConfig &storageConfig = startConfig.storageConfig;
+        storageConfig.backend = pt.get<std::string>("Storage.backend", "embedded");
+
+        // Встроенному хранилищу БД не нужна, и раздела [Database] в конфигурации может не быть.
+        if (storageConfig.backend != "embedded") {
+            DatabaseConfig dbConfig;
+            dbConfig.host = pt.get<std::string>("Database.host");
+            dbConfig.port = pt.get<std::string>("Database.port");
+            dbConfig.dbname = pt.get<std::string>("Database.dbname");
+            dbConfig.user = pt.get<std::string>("Database.user");
+            dbConfig.password = pt.get<std::string>("Database.password");
+            storageConfig.dbConnectionString = getConnectionString(dbConfig);
+        }
+        storageConfig.dbPoolSize = pt.get<size_t>("Database.poolSize", 4);
 
         startConfig.port = pt.get<int>("Server.port");
+        startConfig.idleTimeoutSeconds = pt.get<int>("Server.idleTimeoutSeconds", 30);
+        startConfig.ioThreads = pt.get<int>("Server.ioThreads", 2);
+        // По умолчанию поисков одновременно столько, сколько подключений к БД.
+        startConfig.searchThreads =
+                pt.get<size_t>("Server.searchThreads", storageConfig.dbPoolSize);
+        startConfig.maxPendingSearches = pt.get<size_t>("Server.maxPendingSearches", 256);
+        storageConfig.resultLimit = pt.get<size_t>("Server.resultLimit", 100);
+        startConfig.pageSize = pt.get<size_t>("Server.pageSize", 10);
+        startConfig.maxPageSize = pt.get<size_t>("Server.maxPageSize", 100);
+        startConfig.maxQueryTerms = pt.get<size_t>("Server.maxQueryTerms", 32);
+
+        startConfig.analyzerConfig.stemming = pt.get<bool>("Analyzer.stemming", true);
+        startConfig.analyzerConfig.stopWordsRuPath =
+                pt.get<std::string>("Analyzer.stopWordsRu", "");
+        startConfig.analyzerConfig.stopWordsEnPath =
+                pt.get<std::string>("Analyzer.stopWordsEn", "");
+
+        storageConfig.indexConfig.directory = pt.get<std::string>("Index.directory", "../index");
+
+        startConfig.cacheConfig.enabled = pt.get<bool>("Cache.enabled", true);
+        startConfig.cacheConfig.capacity = pt.get<size_t>("Cache.capacity", 10000);
+        startConfig.cacheConfig.htmlCapacity = pt.get<size_t>("Cache.htmlCapacity", 1000);
+        startConfig.cacheConfig.shards = pt.get<size_t>("Cache.shards", 16);
+        startConfig.cacheConfig.ttlSeconds = pt.get<int>("Cache.ttlSeconds", 60);
+
+        LexiconCacheConfig &lexiconCache = storageConfig.lexiconCache;
+        lexiconCache.enabled = pt.get<bool>("LexiconCache.enabled", false);
+        lexiconCache.hotTerms = pt.get<size_t>("LexiconCache.hotTerms", 1000);
+        lexiconCache.falsePositiveRate = pt.get<double>("LexiconCache.falsePositiveRate", 0.01);
+
+        startConfig.suggestConfig.enabled = pt.get<bool>("Suggest.enabled", true);
+        startConfig.suggestConfig.maxSuggestions = pt.get<size_t>("Suggest.maxSuggestions", 10);
+        startConfig.suggestConfig.rebuildDelaySeconds =
+                pt.get<int>("Suggest.rebuildDelaySeconds", 60);
+        startConfig.suggestConfig.maxEditDistance = pt.get<size_t>("Suggest.maxEditDistance", 2);
+        startConfig.suggestConfig.maxCorrections = pt.get<size_t>("Suggest.maxCorrections", 3);
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
 }
 
+/**
+* @brief Подписка на изменения хранилища на время жизни объекта.
+* @details Слушатель снимается в деструкторе, в том числе при выходе по исключению, поэтому
+* хранилище не уведомляет уже удаленные кэш и автодополнение.
+*/
+class ChangeListenerGuard {
+public:
+    /**
+    * @brief Конструктор. Устанавливает слушателя.
+    * @param storage Хранилище.
+    * @param listener Слушатель изменений.
+    */
+    ChangeListenerGuard(Storage &storage, std::function<void()> listener) :
+    storage_(storage) {
+        storage_.setChangeListener(std::move(listener));
+    }
+
+    /**
+    * @brief Деструктор. Снимает слушателя.
+    */
+    ~ChangeListenerGuard() {
+        storage_.setChangeListener(nullptr);
+    }
+
+    ChangeListenerGuard(const ChangeListenerGuard &) = delete;
+    ChangeListenerGuard &operator=(const ChangeListenerGuard &) = delete;
+
+private:
+    Storage &storage_; //!< Хранилище.
+};
+
 int main() {
     try {
         StartConfig startConfig;
         readConfig(startConfig);
 
-        // TODO
-        const int thread_count = 2; // Количество потоков
-        DatabaseManager dbmanager(startConfig.dbConnectionString);
+        const int thread_count = std::max(startConfig.ioThreads, 1); // Количество потоков
+        std::unique_ptr<Storage> storage = Storage::create(startConfig.storageConfig);
+        std::unique_ptr<QueryCache> cache;
+        if (startConfig.cacheConfig.enabled) {
+            cache = std::make_unique<QueryCache>(startConfig.cacheConfig);
+        }
+        std::unique_ptr<Suggester> suggester;
+        if (startConfig.suggestConfig.enabled) {
+            suggester = std::make_unique<Suggester>(*storage, startConfig.suggestConfig);
+        }
+        QueryCache *cachePtr = cache.get();
+        Suggester *suggesterPtr = suggester.get();
+        // Объявлена после кэша и автодополнения и снимает слушателя раньше их удаления.
+        ChangeListenerGuard listenerGuard(*storage, [cachePtr, suggesterPtr]() {
+            if (cachePtr) {
+                cachePtr->invalidate();
+            }
+            if (suggesterPtr) {
+                suggesterPtr->invalidate();
+            }
+        });
+        Analyzer analyzer(startConfig.analyzerConfig);
+        QueryParser parser(analyzer, startConfig.maxQueryTerms);
 
         std::cout << "Starting Search Engine Server..." << std::endl;
 
@@ -85,8 +193,24 @@ int main() {
         auto const address = net::ip::make_address("0.0.0.0");
         tcp::endpoint endpoint {address, static_cast<unsigned short>(startConfig.port)};
 
+        // Поиск в хранилище блокирует поток, поэтому выполняется в отдельном пуле,
+        // размер которого не зависит от числа потоков ввода-вывода.
+        net::thread_pool searchPool(std::max<size_t>(startConfig.searchThreads, 1));
+
+        ServerContext context;
+        context.storage = storage.get();
+        context.parser = &parser;
+        context.analyzer = &analyzer;
+        context.suggester = suggester.get();
+        context.cache = cache.get();
+        context.searchPool = &searchPool;
+        context.maxPendingSearches = startConfig.maxPendingSearches;
+        context.idleTimeout = std::chrono::seconds(startConfig.idleTimeoutSeconds);
+        context.maxPageSize = std::max<size_t>(startConfig.maxPageSize, 1);
+        context.pageSize = std::min(std::max<size_t>(startConfig.pageSize, 1), context.maxPageSize);
+
         // Создаем и запускаем HTTP сервер
-        HTTPServer server(ioc, endpoint, &dbmanager);
+        HTTPServer server(ioc, endpoint, context);
         server.start();
 
         std::cout << "Server running on http://localhost:" << startConfig.port << std::endl;
@@ -114,6 +238,7 @@ int main() {
         for (auto &t : threads) {
             t.join();
         }
+        searchPool.join();
 
         std::cout << "Server stopped" << std::endl;
 
@@ -0,0 +1,49 @@
+#include "query_cache.h"
+
+#include <iostream>
+
+QueryCache::QueryCache(const QueryCacheConfig &config) :
+generation_(0),
+results_(config.capacity, config.shards, std::chrono::seconds(config.ttlSeconds)),
+html_(config.htmlCapacity, config.shards, std::chrono::seconds(config.ttlSeconds)) {
+}
+
+std::shared_ptr<const QueryCache::Results> QueryCache::getResults(const std::string &key) {
+    return current(results_.get(key));
+}
+
+std::shared_ptr<const QueryCache::Results> QueryCache::putResults(const std::string &key,
+        Results results, uint64_t generation) {
+    auto stored = std::make_shared<const Results>(std::move(results));
+    if (generation == generation_.load()) {
+        results_.put(key, Entry<Results> {generation, stored});
+    }
+    return stored;
+}
+
+std::shared_ptr<const std::string> QueryCache::getHtml(const std::string &query,
+        size_t offset) {
+    return current(html_.get(std::to_string(offset) + " " + query));
+}
+
+void QueryCache::putHtml(const std::string &query, size_t offset, std::string html,
+        uint64_t generation) {
+    if (generation == generation_.load()) {
+        html_.put(std::to_string(offset) + " " + query,
+                Entry<std::string> {generation, std::make_shared<const std::string>(
+                        std::move(html))});
+    }
+}
+
+uint64_t QueryCache::generation() const {
+    return generation_.load();
+}
+
+void QueryCache::invalidate() {
+    // Поколение меняется до очистки: запись, вставленная после очистки поиском старого
+    // поколения, уже не совпадет с текущим.
+    generation_++;
+    results_.clear();
+    html_.clear();
+    std::cout << "QueryCache::invalidate: cache cleared" << std::endl;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common_data.h"
+#include "../utils/lru_cache.h"
+
+/**
+* @brief Параметры кэша поисковых запросов.
+*/
+struct QueryCacheConfig {
+    bool enabled = true; //!< Использовать кэш.
+    size_t capacity = 10000; //!< Число хранимых результатов поиска.
+    size_t htmlCapacity = 1000; //!< Число хранимых HTML страниц результатов.
+    size_t shards = 16; //!< Число сегментов кэша.
+    int ttlSeconds = 60; //!< Время жизни записи, с.
+};
+
+/**
+* @brief Кэш результатов поиска и готовых HTML страниц результатов.
+* @details Результаты хранятся по ключу дерева запроса из QueryParser::canonical, поэтому
+* запросы, отличающиеся только порядком и повторами операндов AND и OR, разделяют одну
+* запись. HTML страница зависит еще и от исходного текста запроса, который в ней
+* выводится, поэтому хранится по исходному тексту и номеру первого результата. Записи
+* устаревают через ttlSeconds; invalidate удаляет все записи при изменении индекса.
+* Поиск, начатый до invalidate, может закончиться после него, поэтому записи помечаются
+* поколением кэша, прочитанным до поиска: запись старого поколения не сохраняется, а если
+* invalidate успел между проверкой и вставкой, не выдается.
+*/
+class QueryCache {
+public:
+    //! Найденные страницы по убыванию релевантности.
+    typedef SearchResults Results;
+
+    /**
+    * @brief Конструктор.
+    * @param config Параметры кэша.
+    */
+    explicit QueryCache(const QueryCacheConfig &config);
+
+    /**
+    * @brief Найти результаты поиска.
+    * @param key Ключ запроса.
+    * @return Результаты или nullptr.
+    */
+    std::shared_ptr<const Results> getResults(const std::string &key);
+
+    /**
+    * @brief Сохранить результаты поиска.
+    * @param key Ключ запроса.
+    * @param results Результаты.
+    * @param generation Поколение кэша, прочитанное до начала поиска.
+    * @return Результаты; не сохраняются, если кэш с тех пор очищен.
+    */
+    std::shared_ptr<const Results> putResults(const std::string &key, Results results,
+            uint64_t generation);
+
+    /**
+    * @brief Найти HTML страницу результатов.
+    * @param query Исходный текст запроса.
+    * @param offset Номер первого результата на странице.
+    * @return Страница или nullptr.
+    */
+    std::shared_ptr<const std::string> getHtml(const std::string &query, size_t offset);
+
+    /**
+    * @brief Сохранить HTML страницу результатов.
+    * @param query Исходный текст запроса.
+    * @param offset Номер первого результата на странице.
+    * @param html Страница.
+    * @param generation Поколение кэша, прочитанное до начала поиска.
+    */
+    void putHtml(const std::string &query, size_t offset, std::string html,
+            uint64_t generation);
+
+    /**
+    * @brief Получить текущее поколение кэша. Читается до начала поиска.
+    */
+    uint64_t generation() const;
+
+    /**
+    * @brief Удалить все записи. Вызывается при изменении индекса.
+    */
+    void invalidate();
+
+private:
+    /**
+    * @brief Запись кэша с поколением, в котором начат поиск.
+    */
+    template <typename T>
+    struct Entry {
+        uint64_t generation; //!< Поколение кэша.
+        std::shared_ptr<const T> value; //!< Значение.
+    };
+
+    std::atomic<uint64_t> generation_; //!< Текущее поколение, растет при каждом invalidate.
+    LruCache<std::string, Entry<Results> > results_; //!< Результаты поиска.
+    LruCache<std::string, Entry<std::string> > html_; //!< HTML страницы результатов.
+
+    /**
+    * @brief Получить значение записи текущего поколения.
+    * @return Значение или nullptr, если записи нет или она из прошлого поколения.
+    */
+    template <typename T>
+    std::shared_ptr<const T> current(const std::shared_ptr<const Entry<T> > &entry) const {
+        if (!entry || entry->generation != generation_.load()) {
+            return nullptr;
+        }
+        return entry->value;
+    }
+};
@@ -0,0 +1,434 @@
+#include "query_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+namespace {
+
+//! Наибольшая длина строки запроса в байтах: 500 символов формы поиска в UTF-8 с запасом.
+const size_t maxQueryBytes = 2048;
+
+//! Наибольшая вложенность скобок и NOT: ограничивает глубину рекурсии разбора.
+const size_t maxNestingDepth = 32;
+
+/**
+* @brief Тип лексемы запроса.
+*/
+enum LexemeType {
+    LEXEME_WORD = 0, //!< Слово.
+    LEXEME_PHRASE, //!< Текст в кавычках.
+    LEXEME_SITE, //!< Хост из site:.
+    LEXEME_AND, //!< AND или &.
+    LEXEME_OR, //!< OR или |.
+    LEXEME_NOT, //!< NOT или - перед операндом.
+    LEXEME_OPEN, //!< Открывающая скобка.
+    LEXEME_CLOSE, //!< Закрывающая скобка.
+    LEXEME_END //!< Конец запроса.
+};
+
+/**
+* @brief Лексема запроса.
+*/
+struct Lexeme {
+    LexemeType type; //!< Тип.
+    std::string text; //!< Текст слова, фразы или хоста.
+};
+
+bool isSpace(char ch) {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+/**
+* @brief Проверить, завершает ли символ слово.
+*/
+bool isDelimiter(char ch) {
+    return isSpace(ch) || ch == '(' || ch == ')' || ch == '"' || ch == '|' || ch == '&';
+}
+
+/**
+* @brief Разбить строку запроса на лексемы.
+* @param text Строка запроса.
+* @return Лексемы, последняя - LEXEME_END.
+*/
+std::vector<Lexeme> splitLexemes(const std::string &text) {
+    std::vector<Lexeme> lexemes;
+    size_t i = 0;
+    while (i < text.size()) {
+        const char ch = text[i];
+        if (isSpace(ch)) {
+            ++i;
+        } else if (ch == '(' || ch == ')') {
+            lexemes.push_back(Lexeme {ch == '(' ? LEXEME_OPEN : LEXEME_CLOSE, ""});
+            ++i;
+        } else if (ch == '|' || ch == '&') {
+            lexemes.push_back(Lexeme {ch == '|' ? LEXEME_OR : LEXEME_AND, ""});
+            ++i;
+        } else if (ch == '"') {
+            // Кавычка без пары закрывается концом запроса.
+            const size_t end = std::min(text.find('"', i + 1), text.size());
+            lexemes.push_back(Lexeme {LEXEME_PHRASE, text.substr(i + 1, end - i - 1)});
+            i = end + 1;
+        } else if (ch == '-' && i + 1 < text.size() && !isDelimiter(text[i + 1])) {
+            lexemes.push_back(Lexeme {LEXEME_NOT, ""});
+            ++i;
+        } else {
+            size_t end = i;
+            while (end < text.size() && !isDelimiter(text[end])) {
+                ++end;
+            }
+            const std::string word = text.substr(i, end - i);
+            std::string prefix = word.substr(0, 5);
+            std::transform(prefix.begin(), prefix.end(), prefix.begin(),
+                    [](unsigned char c) { return std::tolower(c); });
+            if (word == "AND") {
+                lexemes.push_back(Lexeme {LEXEME_AND, ""});
+            } else if (word == "OR") {
+                lexemes.push_back(Lexeme {LEXEME_OR, ""});
+            } else if (word == "NOT") {
+                lexemes.push_back(Lexeme {LEXEME_NOT, ""});
+            } else if (prefix == "site:") {
+                lexemes.push_back(Lexeme {LEXEME_SITE, word.substr(5)});
+            } else {
+                lexemes.push_back(Lexeme {LEXEME_WORD, word});
+            }
+            i = end;
+        }
+    }
+    lexemes.push_back(Lexeme {LEXEME_END, ""});
+    return lexemes;
+}
+
+/**
+* @brief Добавить дочерний узел, раскрыв вложенный узел того же типа.
+* @param parent Узел AND или OR.
+* @param child Дочерний узел.
+*/
+void addChild(QueryNode &parent, QueryNode child) {
+    if (child.type == parent.type) {
+        for (auto &val : child.children) {
+            parent.children.push_back(std::move(val));
+        }
+    } else {
+        parent.children.push_back(std::move(child));
+    }
+}
+
+/**
+* @brief Заменить узел AND или OR с одним дочерним узлом этим узлом.
+* @param node Узел.
+* @return false, если дочерних узлов нет.
+*/
+bool collapse(QueryNode &node) {
+    if (node.children.empty()) {
+        return false;
+    }
+    if (node.children.size() == 1) {
+        QueryNode child = std::move(node.children.front());
+        node = std::move(child);
+    }
+    return true;
+}
+
+/**
+* @brief Разбор лексем запроса рекурсивным спуском.
+* @details Методы разбора возвращают false, если операнд не дал узла: например, состоит
+* только из стоп-слов или это оператор без операнда. Такие операнды пропускаются.
+*/
+class Parser {
+public:
+    /**
+    * @brief Конструктор.
+    * @param analyzer Анализатор текста.
+    * @param text Строка запроса.
+    */
+    Parser(const Analyzer &analyzer, const std::string &text) :
+    analyzer_(analyzer),
+    lexemes_(splitLexemes(text)),
+    pos_(0),
+    depth_(0),
+    error_() {
+    }
+
+    /**
+    * @brief Разобрать запрос целиком.
+    * @param node Узел для записи.
+    * @return false, если запрос не дал узла или содержит ошибку.
+    */
+    bool parseQuery(QueryNode &node) {
+        const bool found = parseOr(node);
+        if (error_.empty() && peek() != LEXEME_END) {
+            error_ = "Unbalanced parentheses";
+        }
+        return found && error_.empty();
+    }
+
+    /**
+    * @brief Получить ошибку разбора.
+    */
+    const std::string &error() const {
+        return error_;
+    }
+
+private:
+    const Analyzer &analyzer_; //!< Анализатор текста.
+    std::vector<Lexeme> lexemes_; //!< Лексемы.
+    size_t pos_; //!< Номер текущей лексемы.
+    size_t depth_; //!< Текущая вложенность скобок и NOT.
+    std::string error_; //!< Ошибка разбора.
+
+    LexemeType peek() const {
+        return lexemes_[pos_].type;
+    }
+
+    /**
+    * @brief Войти на следующий уровень вложенности.
+    * @return false, если вложенность превысила maxNestingDepth; ошибка записывается.
+    */
+    bool enter() {
+        if (depth_ == maxNestingDepth) {
+            error_ = "Query must contain at most " + std::to_string(maxNestingDepth) +
+                    " nested parentheses and NOT";
+            return false;
+        }
+        ++depth_;
+        return true;
+    }
+
+    bool parseOr(QueryNode &node) {
+        QueryNode result;
+        result.type = QUERY_OR;
+        while (true) {
+            QueryNode child;
+            if (parseAnd(child)) {
+                addChild(result, std::move(child));
+            }
+            if (!error_.empty() || peek() != LEXEME_OR) {
+                break;
+            }
+            ++pos_;
+        }
+        node = std::move(result);
+        return collapse(node);
+    }
+
+    bool parseAnd(QueryNode &node) {
+        QueryNode result;
+        result.type = QUERY_AND;
+        while (error_.empty() && peek() != LEXEME_OR && peek() != LEXEME_CLOSE &&
+                peek() != LEXEME_END) {
+            if (peek() == LEXEME_AND) {
+                ++pos_;
+                continue;
+            }
+            QueryNode child;
+            if (parseUnary(child)) {
+                addChild(result, std::move(child));
+            }
+        }
+        node = std::move(result);
+        return collapse(node);
+    }
+
+    bool parseUnary(QueryNode &node) {
+        if (peek() != LEXEME_NOT) {
+            return parsePrimary(node);
+        }
+        ++pos_;
+        if (!enter()) {
+            return false;
+        }
+        QueryNode child;
+        const bool found = parseUnary(child);
+        --depth_;
+        if (!found) {
+            return false;
+        }
+        if (child.type == QUERY_NOT) {
+            // Двойное исключение.
+            QueryNode inner = std::move(child.children.front());
+            node = std::move(inner);
+        } else {
+            node.type = QUERY_NOT;
+            node.children.push_back(std::move(child));
+        }
+        return true;
+    }
+
+    bool parsePrimary(QueryNode &node) {
+        const Lexeme &lexeme = lexemes_[pos_];
+        switch (lexeme.type) {
+            case LEXEME_OPEN: {
+                ++pos_;
+                if (!enter()) {
+                    return false;
+                }
+                const bool found = parseOr(node);
+                --depth_;
+                if (peek() != LEXEME_CLOSE) {
+                    if (error_.empty()) {
+                        error_ = "Unbalanced parentheses";
+                    }
+                    return false;
+                }
+                ++pos_;
+                return found;
+            }
+            case LEXEME_WORD:
+            case LEXEME_PHRASE:
+                ++pos_;
+                return parseWords(lexeme.text, node);
+            case LEXEME_SITE:
+                ++pos_;
+                return parseSite(lexeme.text, node);
+            default:
+                // Оператор без операнда, например NOT в конце запроса: лексема остается
+                // для вызывающего метода.
+                return false;
+        }
+    }
+
+    bool parseWords(const std::string &text, QueryNode &node) {
+        auto tokens = analyzer_.tokenize(text);
+        if (tokens.empty()) {
+            return false;
+        }
+        if (tokens.size() == 1) {
+            node.type = QUERY_TERM;
+            node.value = std::move(tokens.front().term);
+            node.surfaces.push_back(std::move(tokens.front().surface));
+            return true;
+        }
+        node.type = QUERY_PHRASE;
+        for (auto &token : tokens) {
+            node.offsets.push_back(token.position - tokens.front().position);
+            node.words.push_back(std::move(token.term));
+            node.surfaces.push_back(std::move(token.surface));
+        }
+        return true;
+    }
+
+    bool parseSite(std::string host, QueryNode &node) {
+        std::transform(host.begin(), host.end(), host.begin(),
+                [](unsigned char ch) { return std::tolower(ch); });
+        // Хост подставляется в условия LIKE, поэтому допускаются только символы имени хоста.
+        const bool valid = !host.empty() && host.front() != '.' && host.back() != '.' &&
+                std::all_of(host.begin(), host.end(), [](unsigned char ch) {
+                    return std::isalnum(ch) || ch == '.' || ch == '-';
+                });
+        if (!valid) {
+            error_ = "Invalid site: " + host;
+            return false;
+        }
+        node.type = QUERY_SITE;
+        node.value = std::move(host);
+        return true;
+    }
+};
+
+/**
+* @brief Посчитать слова и условия site: в дереве.
+*/
+size_t countTerms(const QueryNode &query) {
+    switch (query.type) {
+        case QUERY_TERM:
+        case QUERY_SITE:
+            return 1;
+        case QUERY_PHRASE:
+            return query.words.size();
+        default: {
+            size_t count = 0;
+            for (const auto &child : query.children) {
+                count += countTerms(child);
+            }
+            return count;
+        }
+    }
+}
+
+/**
+* @brief Проверить, что каждый узел NOT - дочерний узел AND со словами для поиска.
+* @param query Дерево запроса.
+* @param parentAnd Родитель узла - AND.
+*/
+bool validNegations(const QueryNode &query, bool parentAnd) {
+    if (query.type == QUERY_NOT) {
+        return parentAnd && validNegations(query.children.front(), false);
+    }
+    if (query.type == QUERY_AND &&
+            std::all_of(query.children.begin(), query.children.end(),
+                    [](const QueryNode &child) { return child.type == QUERY_NOT; })) {
+        return false;
+    }
+    for (const auto &child : query.children) {
+        if (!validNegations(child, query.type == QUERY_AND)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+QueryParser::QueryParser(const Analyzer &analyzer, size_t maxTerms) :
+analyzer_(analyzer),
+maxTerms_(maxTerms) {
+}
+
+bool QueryParser::parse(const std::string &text, QueryNode &query, std::string &error) const {
+    // Длина проверяется до разбора: ограничение формы поиска действует только в браузере.
+    if (text.size() > maxQueryBytes) {
+        error = "Query must be at most " + std::to_string(maxQueryBytes) + " bytes long";
+        return false;
+    }
+
+    Parser parser(analyzer_, text);
+    if (!parser.parseQuery(query)) {
+        error = parser.error().empty() ? "Query must contain at least one word" : parser.error();
+        return false;
+    }
+    if (!validNegations(query, false)) {
+        error = "NOT must be combined by AND with words to search for";
+        return false;
+    }
+    if (countTerms(query) > maxTerms_) {
+        error = "Query must contain at most " + std::to_string(maxTerms_) + " words";
+        return false;
+    }
+    return true;
+}
+
+std::string QueryParser::canonical(const QueryNode &query) {
+    // Нормализованные слова и хосты не содержат пробелов и скобок.
+    switch (query.type) {
+        case QUERY_TERM:
+            return query.value;
+        case QUERY_SITE:
+            return "site:" + query.value;
+        case QUERY_PHRASE: {
+            std::string key = "\"";
+            for (size_t i = 0; i < query.words.size(); ++i) {
+                key += (i > 0 ? " " : "") + std::to_string(query.offsets[i]) + ":" +
+                        query.words[i];
+            }
+            return key + "\"";
+        }
+        case QUERY_NOT:
+            return "-" + canonical(query.children.front());
+        default:
+            break;
+    }
+
+    std::vector<std::string> children;
+    for (const auto &child : query.children) {
+        children.push_back(canonical(child));
+    }
+    std::sort(children.begin(), children.end());
+    children.erase(std::unique(children.begin(), children.end()), children.end());
+
+    std::string key = query.type == QUERY_AND ? "(and" : "(or";
+    for (const auto &child : children) {
+        key += " " + child;
+    }
+    return key + ")";
+}
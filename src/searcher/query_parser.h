@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+#include "../analyzer/analyzer.h"
+#include "../common_data.h"
+
+/**
+* @brief Разбор строки поискового запроса в дерево.
+* @details Грамматика запроса:
+* - запрос := выражение { (OR | "|") выражение }
+* - выражение := операнд { [AND | "&"] операнд }, слова подряд объединяются через AND;
+* - операнд := (NOT | "-") операнд | "(" запрос ")" | "фраза" | site:хост | слово.
+*
+* Операторы AND, OR и NOT распознаются только в верхнем регистре, иначе это обычные слова.
+* Слова и фразы нормализуются тем же анализатором, что и при индексации: стоп-слова
+* отбрасываются, слово, которое анализатор делит на несколько, становится фразой.
+*/
+class QueryParser {
+public:
+    /**
+    * @brief Конструктор.
+    * @param analyzer Анализатор текста, общий с индексатором.
+    * @param maxTerms Наибольшее число слов и условий site: в запросе.
+    */
+    QueryParser(const Analyzer &analyzer, size_t maxTerms);
+
+    /**
+    * @brief Разобрать строку запроса.
+    * @param text Строка запроса.
+    * @param query Дерево для записи.
+    * @param error Строка для записи ошибки.
+    * @return false, если запрос некорректен: пуст, слишком длинный или слишком глубоко
+    * вложенный, со скобками без пары или с исключением NOT, не объединенным через AND со
+    * словами для поиска.
+    */
+    bool parse(const std::string &text, QueryNode &query, std::string &error) const;
+
+    /**
+    * @brief Построить ключ запроса для кэша.
+    * @details Дочерние узлы AND и OR сортируются, повторы удаляются, поэтому
+    * "кошка собака" и "собака AND кошка" разделяют один ключ.
+    * @param query Дерево запроса.
+    * @return Строка, однозначно задающая множество и порядок найденных страниц.
+    */
+    static std::string canonical(const QueryNode &query);
+
+private:
+    const Analyzer &analyzer_; //!< Анализатор текста.
+    size_t maxTerms_; //!< Наибольшее число слов и условий site: в запросе.
+};
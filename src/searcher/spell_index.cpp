@@ -0,0 +1,224 @@
+#include "spell_index.h"
+
+#include <algorithm>
+#include <numeric>
+#include <boost/locale.hpp>
+
+namespace {
+
+/**
+* @brief Посчитать хэш строки (FNV-1a по кодовым точкам).
+*/
+uint32_t hashString(const std::u32string &value) {
+    uint32_t hash = 2166136261u;
+    for (char32_t ch : value) {
+        hash = (hash ^ static_cast<uint32_t>(ch)) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+* @brief Посчитать расстояние Дамерау-Левенштейна (с перестановкой соседних символов).
+* @param lhs Первое слово.
+* @param rhs Второе слово.
+* @param limit Наибольшее интересующее расстояние.
+* @return Расстояние или limit + 1, если оно больше limit.
+*/
+size_t editDistance(const std::u32string &lhs, const std::u32string &rhs, size_t limit) {
+    const size_t length = rhs.size();
+    if (std::max(lhs.size(), length) - std::min(lhs.size(), length) > limit) {
+        return limit + 1;
+    }
+
+    // Хранятся три последние строки матрицы: перестановка смотрит на две строки назад.
+    std::vector<size_t> beforePrevious(length + 1);
+    std::vector<size_t> previous(length + 1);
+    std::vector<size_t> current(length + 1);
+    std::iota(previous.begin(), previous.end(), 0);
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = i;
+        size_t rowMin = current[0];
+        for (size_t j = 1; j <= length; ++j) {
+            const size_t cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1]) {
+                current[j] = std::min(current[j], beforePrevious[j - 2] + 1);
+            }
+            rowMin = std::min(rowMin, current[j]);
+        }
+        // Значения в следующих строках не меньше минимума текущей.
+        if (rowMin > limit) {
+            return limit + 1;
+        }
+        beforePrevious.swap(previous);
+        previous.swap(current);
+    }
+    return std::min(previous[length], limit + 1);
+}
+
+} // namespace
+
+SpellIndex::SpellIndex(std::vector<SpellTerm> terms, size_t maxDistance) :
+maxDistance_(maxDistance),
+chars_(),
+offsets_(),
+frequencies_(),
+surfaces_(),
+surfaceOffsets_(),
+deletes_() {
+    std::stable_sort(terms.begin(), terms.end(), [](const SpellTerm &lhs, const SpellTerm &rhs) {
+        return lhs.term < rhs.term;
+    });
+
+    // Порядок строк UTF-8 совпадает с порядком кодовых точек, поэтому слова в chars_ тоже
+    // упорядочены и ищутся двоичным поиском.
+    offsets_.reserve(terms.size() + 1);
+    frequencies_.reserve(terms.size());
+    surfaceOffsets_.reserve(terms.size() + 1);
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (terms[i].term.empty()) {
+            continue;
+        }
+        if (i > 0 && terms[i].term == terms[i - 1].term) {
+            frequencies_.back() += terms[i].frequency;
+            continue;
+        }
+        offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+        chars_ += boost::locale::conv::utf_to_utf<char32_t>(terms[i].term);
+        frequencies_.push_back(terms[i].frequency);
+        surfaceOffsets_.push_back(static_cast<uint32_t>(surfaces_.size()));
+        surfaces_ += terms[i].surface.empty() ? terms[i].term : terms[i].surface;
+    }
+    offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+    surfaceOffsets_.push_back(static_cast<uint32_t>(surfaces_.size()));
+    chars_.shrink_to_fit();
+    surfaces_.shrink_to_fit();
+
+    for (uint32_t i = 0; i < frequencies_.size(); ++i) {
+        for (uint32_t hash : deleteHashes(term(i), maxDistance_)) {
+            deletes_.emplace_back(hash, i);
+        }
+    }
+    std::sort(deletes_.begin(), deletes_.end());
+    deletes_.shrink_to_fit();
+}
+
+std::vector<SpellTerm> SpellIndex::correct(const std::string &word, size_t limit) const {
+    std::vector<SpellTerm> corrections;
+    const std::u32string source = boost::locale::conv::utf_to_utf<char32_t>(word);
+    size_t distance = 0;
+    if (source.size() >= 6) {
+        distance = maxDistance_;
+    } else if (source.size() >= 3) {
+        distance = std::min<size_t>(maxDistance_, 1);
+    }
+    if (distance == 0 || limit == 0 || frequencies_.empty() || find(source) != size()) {
+        return corrections;
+    }
+
+    std::vector<uint32_t> candidates;
+    for (uint32_t hash : deleteHashes(source, distance)) {
+        auto range = std::equal_range(deletes_.begin(), deletes_.end(),
+                std::make_pair(hash, uint32_t(0)),
+                [](const std::pair<uint32_t, uint32_t> &lhs,
+                        const std::pair<uint32_t, uint32_t> &rhs) {
+                    return lhs.first < rhs.first;
+                });
+        for (auto it = range.first; it != range.second; ++it) {
+            candidates.push_back(it->second);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Совпадение хэшей удалений из начала слова только отбирает кандидатов: расстояние
+    // между словами целиком проверяется явно, что заодно отсеивает коллизии хэшей.
+    size_t bestDistance = distance + 1;
+    std::vector<uint32_t> best;
+    for (uint32_t candidate : candidates) {
+        const size_t current = editDistance(source, term(candidate), distance);
+        if (current < bestDistance) {
+            bestDistance = current;
+            best.clear();
+        }
+        if (current == bestDistance && current <= distance) {
+            best.push_back(candidate);
+        }
+    }
+
+    std::sort(best.begin(), best.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return frequencies_[lhs] != frequencies_[rhs] ? frequencies_[lhs] > frequencies_[rhs]
+                                                      : lhs < rhs;
+    });
+    if (best.size() > limit) {
+        best.resize(limit);
+    }
+    for (uint32_t candidate : best) {
+        corrections.push_back(SpellTerm {boost::locale::conv::utf_to_utf<char>(term(candidate)),
+                surface(candidate), frequencies_[candidate]});
+    }
+    return corrections;
+}
+
+size_t SpellIndex::size() const {
+    return frequencies_.size();
+}
+
+size_t SpellIndex::memoryUsage() const {
+    return chars_.capacity() * sizeof(char32_t) + offsets_.capacity() * sizeof(uint32_t) +
+            frequencies_.capacity() * sizeof(uint64_t) + surfaces_.capacity() +
+            surfaceOffsets_.capacity() * sizeof(uint32_t) +
+            deletes_.capacity() * sizeof(std::pair<uint32_t, uint32_t>);
+}
+
+std::vector<uint32_t> SpellIndex::deleteHashes(const std::u32string &word, size_t maxDistance) {
+    std::vector<std::u32string> level {word.substr(0, prefixLength)};
+    std::vector<uint32_t> hashes {hashString(level.front())};
+    for (size_t distance = 0; distance < maxDistance; ++distance) {
+        std::vector<std::u32string> next;
+        for (const auto &val : level) {
+            for (size_t i = 0; i < val.size(); ++i) {
+                next.push_back(val.substr(0, i) + val.substr(i + 1));
+            }
+        }
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+
+        for (const auto &val : next) {
+            hashes.push_back(hashString(val));
+        }
+        level = std::move(next);
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+}
+
+std::u32string SpellIndex::term(uint32_t index) const {
+    return chars_.substr(offsets_[index], offsets_[index + 1] - offsets_[index]);
+}
+
+std::string SpellIndex::surface(uint32_t index) const {
+    return surfaces_.substr(surfaceOffsets_[index],
+            surfaceOffsets_[index + 1] - surfaceOffsets_[index]);
+}
+
+uint32_t SpellIndex::find(const std::u32string &word) const {
+    uint32_t first = 0;
+    uint32_t last = static_cast<uint32_t>(size());
+    while (first < last) {
+        const uint32_t middle = first + (last - first) / 2;
+        const int order = chars_.compare(offsets_[middle], offsets_[middle + 1] - offsets_[middle],
+                word);
+        if (order == 0) {
+            return middle;
+        }
+        if (order < 0) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return static_cast<uint32_t>(size());
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Слово словаря исправления опечаток.
+*/
+struct SpellTerm {
+    std::string term; //!< Слово в нормализованной форме.
+    std::string surface; //!< Самая частая форма слова до приведения к основе.
+    uint64_t frequency; //!< Число документов со словом.
+};
+
+/**
+* @brief Неизменяемый индекс исправления опечаток по словарю (symmetric delete).
+* @details Для каждого слова словаря заранее перечисляются строки, получаемые удалением
+* из его начала до maxDistance символов; в индексе хранятся хэши этих строк с номером слова.
+* Для слова запроса перечисляются такие же удаления, и слова с совпавшими хэшами
+* проверяются расстоянием Дамерау-Левенштейна. Удаления берутся только из первых
+* prefixLength символов, поэтому их число на слово ограничено константой и поиск не
+* зависит ни от размера словаря, ни от длины слова. Символы - кодовые точки Unicode.
+* Расстояние считается между нормализованными словами, а для показа пользователю у каждого
+* слова хранится его самая частая форма.
+*/
+class SpellIndex {
+public:
+    /**
+    * @brief Конструктор. Строит индекс.
+    * @param terms Слова с формами и частотами; повторяющиеся слова объединяются, частоты
+    * складываются, остается первая форма.
+    * @param maxDistance Наибольшее расстояние исправления.
+    */
+    SpellIndex(std::vector<SpellTerm> terms, size_t maxDistance);
+
+    /**
+    * @brief Найти исправления слова, которого нет в словаре.
+    * @details Допустимое расстояние зависит от длины слова: 1 для слов из 3-5 символов,
+    * maxDistance для более длинных; слова короче 3 символов не исправляются. Исправления -
+    * все слова на наименьшем расстоянии.
+    * @param word Слово в нормализованной форме.
+    * @param limit Наибольшее число исправлений.
+    * @return Исправления по убыванию частоты; пусто, если слово есть в словаре или
+    * исправление не найдено.
+    */
+    std::vector<SpellTerm> correct(const std::string &word, size_t limit) const;
+
+    /**
+    * @brief Получить число слов.
+    */
+    size_t size() const;
+
+    /**
+    * @brief Получить объем занимаемой памяти в байтах.
+    */
+    size_t memoryUsage() const;
+
+private:
+    //! Число первых символов слова, из которых берутся удаления.
+    static const size_t prefixLength = 7;
+
+    size_t maxDistance_; //!< Наибольшее расстояние исправления.
+    std::u32string chars_; //!< Слова подряд в порядке возрастания.
+    std::vector<uint32_t> offsets_; //!< Начала слов в chars_ и конец последнего слова.
+    std::vector<uint64_t> frequencies_; //!< Частоты слов.
+    std::string surfaces_; //!< Формы слов подряд в UTF-8 в порядке слов.
+    std::vector<uint32_t> surfaceOffsets_; //!< Начала форм в surfaces_ и конец последней.
+    //! Хэши удалений с номерами слов по возрастанию хэша.
+    std::vector<std::pair<uint32_t, uint32_t> > deletes_;
+
+    /**
+    * @brief Перечислить удаления из начала слова.
+    * @param word Слово.
+    * @param maxDistance Наибольшее число удаляемых символов.
+    * @return Хэши удалений без повторов, включая хэш самого начала слова.
+    */
+    static std::vector<uint32_t> deleteHashes(const std::u32string &word, size_t maxDistance);
+
+    /**
+    * @brief Получить слово по номеру.
+    */
+    std::u32string term(uint32_t index) const;
+
+    /**
+    * @brief Получить форму слова по номеру.
+    */
+    std::string surface(uint32_t index) const;
+
+    /**
+    * @brief Найти номер слова.
+    * @return Номер слова или size(), если слова нет.
+    */
+    uint32_t find(const std::u32string &word) const;
+};
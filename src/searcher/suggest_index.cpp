@@ -0,0 +1,374 @@
+#include "suggest_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <numeric>
+
+SuggestIndex::SuggestIndex(std::vector<std::pair<std::string, uint64_t> > terms,
+        size_t maxSuggestions) :
+maxSuggestions_(std::max<size_t>(maxSuggestions, 1)),
+chars_(),
+offsets_(),
+frequencies_(),
+nodes_(),
+top_() {
+    std::sort(terms.begin(), terms.end());
+
+    offsets_.reserve(terms.size() + 1);
+    frequencies_.reserve(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (terms[i].first.empty()) {
+            continue;
+        }
+        if (i > 0 && terms[i].first == terms[i - 1].first) {
+            frequencies_.back() += terms[i].second;
+            continue;
+        }
+        offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+        chars_ += terms[i].first;
+        frequencies_.push_back(terms[i].second);
+    }
+    offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+
+    if (!frequencies_.empty()) {
+        nodes_.push_back(Node());
+        build(0, 0, static_cast<uint32_t>(frequencies_.size()));
+    }
+    nodes_.shrink_to_fit();
+    top_.shrink_to_fit();
+}
+
+void SuggestIndex::build(uint32_t index, uint32_t firstTerm, uint32_t lastTerm) {
+    // Слова упорядочены, поэтому общий префикс диапазона - общий префикс первого и
+    // последнего слова.
+    uint32_t depth = termLength(firstTerm);
+    if (lastTerm - firstTerm > 1) {
+        const uint32_t length = std::min(depth, termLength(lastTerm - 1));
+        depth = 0;
+        while (depth < length && termByte(firstTerm, depth) == termByte(lastTerm - 1, depth)) {
+            ++depth;
+        }
+    }
+
+    // Слово, совпадающее с префиксом узла, стоит первым; остальные делятся на потомков
+    // по следующему байту.
+    const uint32_t next = termLength(firstTerm) == depth ? firstTerm + 1 : firstTerm;
+    std::vector<uint32_t> bounds;
+    for (uint32_t i = next; i < lastTerm; ++i) {
+        if (i == next || termByte(i, depth) != termByte(i - 1, depth)) {
+            bounds.push_back(i);
+        }
+    }
+    bounds.push_back(lastTerm);
+
+    Node node {depth, static_cast<uint32_t>(nodes_.size()),
+            static_cast<uint32_t>(bounds.size() - 1), firstTerm, lastTerm, 0, 0};
+    nodes_.resize(nodes_.size() + node.childCount);
+    for (uint32_t i = 0; i < node.childCount; ++i) {
+        build(node.firstChild + i, bounds[i], bounds[i + 1]);
+    }
+
+    if (lastTerm - firstTerm > maxSuggestions_) {
+        std::vector<uint32_t> candidates;
+        if (next != firstTerm) {
+            candidates.push_back(firstTerm);
+        }
+        for (uint32_t i = 0; i < node.childCount; ++i) {
+            const std::vector<uint32_t> child = best(nodes_[node.firstChild + i], maxSuggestions_);
+            candidates.insert(candidates.end(), child.begin(), child.end());
+        }
+        selectBest(candidates, maxSuggestions_);
+        node.firstTop = static_cast<uint32_t>(top_.size());
+        node.topCount = static_cast<uint32_t>(candidates.size());
+        top_.insert(top_.end(), candidates.begin(), candidates.end());
+    }
+    nodes_[index] = node;
+}
+
+std::vector<Suggestion> SuggestIndex::suggest(const std::string &prefix, size_t limit) const {
+    limit = std::min(limit, maxSuggestions_);
+    if (nodes_.empty() || limit == 0) {
+        return {};
+    }
+
+    uint32_t index = 0;
+    uint32_t matched = 0;
+    while (true) {
+        const Node &node = nodes_[index];
+        // Метка ребра - байты первого слова диапазона от префикса родителя до префикса узла.
+        const uint32_t end = static_cast<uint32_t>(std::min<size_t>(node.depth, prefix.size()));
+        if (prefix.compare(matched, end - matched, chars_, offsets_[node.firstTerm] + matched,
+                end - matched) != 0) {
+            return {};
+        }
+        if (prefix.size() <= node.depth) {
+            std::vector<Suggestion> suggestions;
+            for (uint32_t term : best(node, limit)) {
+                suggestions.push_back(Suggestion {this->term(term), frequencies_[term]});
+            }
+            return suggestions;
+        }
+
+        matched = node.depth;
+        const unsigned char next = static_cast<unsigned char>(prefix[matched]);
+        const Node *first = &nodes_[node.firstChild];
+        const Node *last = first + node.childCount;
+        const Node *child = std::lower_bound(first, last, next,
+                [this, matched](const Node &lhs, unsigned char value) {
+                    return termByte(lhs.firstTerm, matched) < value;
+                });
+        if (child == last || termByte(child->firstTerm, matched) != next) {
+            return {};
+        }
+        index = static_cast<uint32_t>(child - nodes_.data());
+    }
+}
+
+size_t SuggestIndex::size() const {
+    return frequencies_.size();
+}
+
+size_t SuggestIndex::memoryUsage() const {
+    return chars_.capacity() + offsets_.capacity() * sizeof(uint32_t) +
+            frequencies_.capacity() * sizeof(uint64_t) + nodes_.capacity() * sizeof(Node) +
+            top_.capacity() * sizeof(uint32_t);
+}
+
+std::vector<uint32_t> SuggestIndex::best(const Node &node, size_t limit) const {
+    if (node.topCount > 0) {
+        const size_t count = std::min<size_t>(limit, node.topCount);
+        return std::vector<uint32_t>(top_.begin() + node.firstTop,
+                top_.begin() + node.firstTop + count);
+    }
+
+    std::vector<uint32_t> terms(node.lastTerm - node.firstTerm);
+    std::iota(terms.begin(), terms.end(), node.firstTerm);
+    selectBest(terms, limit);
+    return terms;
+}
+
+void SuggestIndex::selectBest(std::vector<uint32_t> &terms, size_t limit) const {
+    // Номера слов идут по алфавиту, поэтому при равной частоте выше стоит меньший номер.
+    auto better = [this](uint32_t lhs, uint32_t rhs) {
+        if (frequencies_[lhs] != frequencies_[rhs]) {
+            return frequencies_[lhs] > frequencies_[rhs];
+        }
+        return lhs < rhs;
+    };
+    if (terms.size() > limit) {
+        std::partial_sort(terms.begin(), terms.begin() + limit, terms.end(), better);
+        terms.resize(limit);
+    } else {
+        std::sort(terms.begin(), terms.end(), better);
+    }
+}
+
+std::string SuggestIndex::term(uint32_t index) const {
+    return chars_.substr(offsets_[index], termLength(index));
+}
+
+uint32_t SuggestIndex::termLength(uint32_t index) const {
+    return offsets_[index + 1] - offsets_[index];
+}
+
+unsigned char SuggestIndex::termByte(uint32_t index, uint32_t position) const {
+    return static_cast<unsigned char>(chars_[offsets_[index] + position]);
+}
+
+Suggester::Suggester(Storage &storage, const SuggestConfig &config) :
+storage_(storage),
+config_(config),
+index_(std::make_unique<SuggestIndex>(std::vector<std::pair<std::string, uint64_t> >(),
+        config.maxSuggestions)),
+spellIndex_(std::make_unique<SpellIndex>(std::vector<SpellTerm>(), config.maxEditDistance)),
+mutex_(),
+condition_(),
+dirty_(true),
+stop_(false),
+thread_() {
+    thread_ = std::thread(&Suggester::run, this);
+}
+
+Suggester::~Suggester() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::vector<Suggestion> Suggester::suggest(const std::string &prefix, size_t limit) const {
+    auto index = index_.read();
+    return index->suggest(prefix, std::min(limit, config_.maxSuggestions));
+}
+
+std::vector<Correction> Suggester::correct(QueryNode &query) const {
+    std::vector<Correction> corrections;
+    if (config_.maxEditDistance == 0) {
+        return corrections;
+    }
+
+    auto index = spellIndex_.read();
+    const size_t limit = std::max<size_t>(config_.maxCorrections, 1);
+    std::map<std::string, std::vector<SpellTerm> > found;
+    auto lookup = [&index, &found, limit](const std::string &word)
+            -> const std::vector<SpellTerm> & {
+        auto it = found.find(word);
+        if (it == found.end()) {
+            it = found.emplace(word, index->correct(word, limit)).first;
+        }
+        return it->second;
+    };
+    // Слово сообщается один раз, даже если оно исправлено и отдельно, и во фразе.
+    auto report = [&corrections](const QueryNode &node, size_t i, const std::string &word,
+            const std::string &correction) {
+        const std::string &surface = i < node.surfaces.size() ? node.surfaces[i] : word;
+        auto it = std::find_if(corrections.begin(), corrections.end(),
+                [&surface](const Correction &val) { return val.word == surface; });
+        if (it == corrections.end()) {
+            it = corrections.insert(corrections.end(), Correction {surface, {}});
+        }
+        if (std::find(it->corrections.begin(), it->corrections.end(), correction) ==
+                it->corrections.end()) {
+            it->corrections.push_back(correction);
+        }
+    };
+
+    std::vector<QueryNode *> stack {&query};
+    while (!stack.empty()) {
+        QueryNode *node = stack.back();
+        stack.pop_back();
+        if (node->type == QUERY_NOT) {
+            continue;
+        }
+        if (node->type == QUERY_TERM) {
+            const std::vector<SpellTerm> &candidates = lookup(node->value);
+            for (const auto &candidate : candidates) {
+                report(*node, 0, node->value, candidate.surface);
+            }
+            if (candidates.size() == 1) {
+                node->value = candidates.front().term;
+                node->surfaces.assign(1, candidates.front().surface);
+            } else if (!candidates.empty()) {
+                QueryNode expanded;
+                expanded.type = QUERY_OR;
+                for (const auto &candidate : candidates) {
+                    QueryNode term;
+                    term.value = candidate.term;
+                    term.surfaces.push_back(candidate.surface);
+                    expanded.children.push_back(std::move(term));
+                }
+                *node = std::move(expanded);
+            }
+            continue;
+        }
+        if (node->type == QUERY_PHRASE) {
+            for (size_t i = 0; i < node->words.size(); ++i) {
+                const std::vector<SpellTerm> &candidates = lookup(node->words[i]);
+                if (!candidates.empty()) {
+                    report(*node, i, node->words[i], candidates.front().surface);
+                    node->words[i] = candidates.front().term;
+                    if (i < node->surfaces.size()) {
+                        node->surfaces[i] = candidates.front().surface;
+                    }
+                }
+            }
+        }
+        // Дочерние узлы кладутся в обратном порядке, чтобы обходиться слева направо.
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+            stack.push_back(&*it);
+        }
+    }
+    return corrections;
+}
+
+void Suggester::invalidate() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        dirty_ = true;
+    }
+    condition_.notify_all();
+}
+
+size_t Suggester::maxSuggestions() const {
+    return config_.maxSuggestions;
+}
+
+void Suggester::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this]() { return stop_ || dirty_; });
+        if (stop_) {
+            return;
+        }
+        dirty_ = false;
+
+        lock.unlock();
+        rebuild();
+        lock.lock();
+
+        // Изменения хранилища за время паузы собираются в одно перестроение: при записи
+        // в БД они приходят после каждого пакета.
+        condition_.wait_for(lock, std::chrono::seconds(std::max(config_.rebuildDelaySeconds, 0)),
+                [this]() { return stop_; });
+        index_.reclaim();
+        spellIndex_.reclaim();
+    }
+}
+
+void Suggester::rebuild() {
+    try {
+        std::map<std::string, std::map<std::string, uint64_t> > surfaces;
+        storage_.forEachTerm([&surfaces](const std::string &term, const std::string &surface,
+                uint64_t frequency) {
+            surfaces[term][surface] += frequency;
+        });
+
+        // Дополняются формы слов, а не основы: основа вроде "программ" не похожа на слово,
+        // и префикс, который длиннее основы, иначе ничего бы не находил. Каждую основу
+        // представляет самая частая форма с суммарной частотой основы.
+        std::vector<SpellTerm> terms;
+        terms.reserve(surfaces.size());
+        for (const auto &val : surfaces) {
+            auto best = val.second.begin();
+            uint64_t frequency = 0;
+            for (auto it = val.second.begin(); it != val.second.end(); ++it) {
+                frequency += it->second;
+                if (it->second > best->second) {
+                    best = it;
+                }
+            }
+            terms.push_back(SpellTerm {val.first, best->first, frequency});
+        }
+        surfaces.clear();
+
+        std::vector<std::pair<std::string, uint64_t> > completions;
+        completions.reserve(terms.size());
+        for (const auto &term : terms) {
+            completions.emplace_back(term.surface, term.frequency);
+        }
+
+        // Опечатки ищутся по основам, как они хранятся в индексе, а пользователю
+        // показываются формы.
+        if (config_.maxEditDistance > 0) {
+            auto spellIndex = std::make_unique<SpellIndex>(std::move(terms),
+                    config_.maxEditDistance);
+            std::cout << "Suggester::rebuild: spelling " << spellIndex->size() << " words, "
+                      << spellIndex->memoryUsage() / 1024 << " KiB" << std::endl;
+            spellIndex_.publish(std::move(spellIndex));
+        }
+
+        auto index = std::make_unique<SuggestIndex>(std::move(completions),
+                config_.maxSuggestions);
+        std::cout << "Suggester::rebuild: " << index->size() << " words, "
+                  << index->memoryUsage() / 1024 << " KiB" << std::endl;
+        index_.publish(std::move(index));
+    } catch (const std::exception &e) {
+        std::cerr << "Suggester::rebuild: Error: " << e.what() << std::endl;
+    }
+}
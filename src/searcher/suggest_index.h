@@ -0,0 +1,213 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "spell_index.h"
+#include "../common_data.h"
+#include "../storage/storage.h"
+#include "../utils/rcu_pointer.h"
+
+/**
+* @brief Параметры подсказок: автодополнения и исправления опечаток.
+*/
+struct SuggestConfig {
+    bool enabled = true; //!< Строить индексы подсказок.
+    size_t maxSuggestions = 10; //!< Наибольшее число дополнений в ответе.
+    size_t maxEditDistance = 2; //!< Наибольшее расстояние исправления опечатки, 0 - не исправлять.
+    size_t maxCorrections = 3; //!< Наибольшее число исправлений одного слова запроса.
+    int rebuildDelaySeconds = 60; //!< Наименьший интервал между перестроениями индекса.
+};
+
+/**
+* @brief Дополнение префикса.
+*/
+struct Suggestion {
+    std::string term; //!< Самая частая форма слова словаря.
+    uint64_t frequency; //!< Число документов со словом.
+};
+
+/**
+* @brief Исправленное слово запроса.
+*/
+struct Correction {
+    std::string word; //!< Слово запроса, которого нет в словаре, в том виде, как оно введено.
+    std::vector<std::string> corrections; //!< Формы слов словаря, которыми оно заменено.
+};
+
+/**
+* @brief Неизменяемое сжатое префиксное дерево словаря для автодополнения.
+* @details Слова хранятся одной строкой в порядке возрастания. Узел дерева - общий префикс
+* диапазона слов: метка ребра не копируется, а берется из первого слова диапазона, цепочки
+* из одного потомка схлопываются. У узлов, под которыми больше maxSuggestions слов, заранее
+* посчитаны лучшие по частоте слова, у остальных они отбираются перебором диапазона,
+* поэтому поиск занимает время порядка длины префикса.
+*/
+class SuggestIndex {
+public:
+    /**
+    * @brief Конструктор. Строит дерево.
+    * @param terms Слова с частотами; повторяющиеся слова объединяются, частоты
+    * складываются.
+    * @param maxSuggestions Наибольшее число дополнений в ответе.
+    */
+    SuggestIndex(std::vector<std::pair<std::string, uint64_t> > terms, size_t maxSuggestions);
+
+    /**
+    * @brief Найти самые частые слова, начинающиеся с префикса.
+    * @param prefix Префикс в нормализованной форме.
+    * @param limit Число дополнений, не больше maxSuggestions.
+    * @return Дополнения по убыванию частоты, при равной частоте - по алфавиту.
+    */
+    std::vector<Suggestion> suggest(const std::string &prefix, size_t limit) const;
+
+    /**
+    * @brief Получить число слов.
+    */
+    size_t size() const;
+
+    /**
+    * @brief Получить объем занимаемой памяти в байтах.
+    */
+    size_t memoryUsage() const;
+
+private:
+    /**
+    * @brief Узел дерева: общий префикс диапазона слов.
+    */
+    struct Node {
+        uint32_t depth; //!< Длина префикса узла в байтах.
+        uint32_t firstChild; //!< Номер первого потомка, потомки лежат подряд.
+        uint32_t childCount; //!< Число потомков.
+        uint32_t firstTerm; //!< Номер первого слова диапазона.
+        uint32_t lastTerm; //!< Номер слова за последним словом диапазона.
+        uint32_t firstTop; //!< Начало лучших слов узла в top_.
+        uint32_t topCount; //!< Число лучших слов узла, 0 - не посчитаны.
+    };
+
+    size_t maxSuggestions_; //!< Наибольшее число дополнений в ответе.
+    std::string chars_; //!< Слова подряд в порядке возрастания.
+    std::vector<uint32_t> offsets_; //!< Начала слов в chars_ и конец последнего слова.
+    std::vector<uint64_t> frequencies_; //!< Частоты слов.
+    std::vector<Node> nodes_; //!< Узлы дерева, корень - первый.
+    std::vector<uint32_t> top_; //!< Номера лучших слов узлов.
+
+    /**
+    * @brief Заполнить узел и его поддерево.
+    * @param index Номер узла.
+    * @param firstTerm Номер первого слова диапазона.
+    * @param lastTerm Номер слова за последним словом диапазона.
+    */
+    void build(uint32_t index, uint32_t firstTerm, uint32_t lastTerm);
+
+    /**
+    * @brief Получить лучшие слова узла.
+    * @param node Узел.
+    * @param limit Число слов.
+    * @return Номера слов по убыванию частоты.
+    */
+    std::vector<uint32_t> best(const Node &node, size_t limit) const;
+
+    /**
+    * @brief Отобрать лучшие слова в начало списка и отбросить остальные.
+    */
+    void selectBest(std::vector<uint32_t> &terms, size_t limit) const;
+
+    /**
+    * @brief Получить слово по номеру.
+    */
+    std::string term(uint32_t index) const;
+
+    /**
+    * @brief Получить длину слова по номеру.
+    */
+    uint32_t termLength(uint32_t index) const;
+
+    /**
+    * @brief Получить байт слова по номеру слова и позиции.
+    */
+    unsigned char termByte(uint32_t index, uint32_t position) const;
+};
+
+/**
+* @brief Подсказки по словарю хранилища: автодополнение и исправление опечаток.
+* @details Оба индекса строятся фоновым потоком по одному чтению словаря при запуске и
+* перестраиваются после изменения хранилища, но не чаще раза в rebuildDelaySeconds. Готовые
+* индексы подменяются через RcuPointer, поэтому запросы не ждут ни перестроения, ни
+* блокировок. Автодополнение строится по формам слов до приведения к основе: каждое слово
+* словаря представлено своей самой частой формой.
+*/
+class Suggester {
+public:
+    /**
+    * @brief Конструктор. Запускает фоновый поток построения индекса.
+    * @param storage Хранилище индекса.
+    * @param config Параметры автодополнения.
+    */
+    Suggester(Storage &storage, const SuggestConfig &config);
+
+    /**
+    * @brief Деструктор. Останавливает фоновый поток.
+    */
+    ~Suggester();
+
+    Suggester(const Suggester &) = delete;
+    Suggester &operator=(const Suggester &) = delete;
+
+    /**
+    * @brief Найти самые частые слова, начинающиеся с префикса.
+    * @param prefix Префикс в нормализованной форме.
+    * @param limit Число дополнений, ограничивается maxSuggestions.
+    * @return Дополнения по убыванию частоты; пустой список, пока индекс не построен.
+    */
+    std::vector<Suggestion> suggest(const std::string &prefix, size_t limit) const;
+
+    /**
+    * @brief Исправить опечатки в словах запроса.
+    * @details Исправляются только слова, которых нет в словаре и для которых нашлось
+    * исправление. Отдельное слово заменяется объединением OR всех слов на наименьшем
+    * расстоянии, но не больше maxCorrections самых частых; слово фразы - самым частым из
+    * них, так как позиции фразы допускают одно слово. Слова под NOT не исправляются:
+    * исключение слова с опечаткой ничего не исключает, а исключение исправленного слова
+    * могло бы отбросить нужные страницы. Пока индекс не построен, запрос не меняется.
+    * @param query Дерево запроса.
+    * @return Исправления без повторов в порядке слов запроса.
+    */
+    std::vector<Correction> correct(QueryNode &query) const;
+
+    /**
+    * @brief Отметить, что словарь хранилища изменился и индекс нужно перестроить.
+    */
+    void invalidate();
+
+    /**
+    * @brief Получить наибольшее число дополнений в ответе.
+    */
+    size_t maxSuggestions() const;
+
+private:
+    Storage &storage_; //!< Хранилище индекса.
+    SuggestConfig config_; //!< Параметры автодополнения.
+    RcuPointer<SuggestIndex> index_; //!< Текущий индекс автодополнения.
+    RcuPointer<SpellIndex> spellIndex_; //!< Текущий индекс исправления опечаток.
+    std::mutex mutex_; //!< Мьютекс для работы с флагами.
+    std::condition_variable condition_; //!< Условие изменения флагов.
+    bool dirty_; //!< Индекс нужно перестроить.
+    bool stop_; //!< Флаг остановки фонового потока.
+    std::thread thread_; //!< Фоновый поток построения индекса.
+
+    /**
+    * @brief Цикл фонового потока.
+    */
+    void run();
+
+    /**
+    * @brief Прочитать словарь хранилища и построить индексы.
+    */
+    void rebuild();
+};
@@ -1,22 +1,28 @@
 #include "indexer.h"
 #include "../utils/secondary_function.h"
 
-#include <pqxx/pqxx>
+#include <unordered_map>
 
-Indexer::Indexer() :
+Indexer::Indexer(const Analyzer &analyzer, const FieldBoosts &boosts) :
 parser_(),
+analyzer_(analyzer),
+boosts_(boosts),
 storage_(),
 text_() {
 }
 
-void Indexer::setPage(const std::string &htmlPage) {
+void Indexer::setPage(const std::string &htmlPage, const std::string &anchorText) {
     parser_.parse(htmlPage);
     text_ = parser_.getText();
     calcCountWords();
+    calcFieldCounts(FIELD_TITLE, parser_.getField(FIELD_TITLE));
+    calcFieldCounts(FIELD_HEADING, parser_.getField(FIELD_HEADING));
+    calcFieldCounts(FIELD_ANCHOR, anchorText);
+    calcImpacts();
 }
 
-void Indexer::saveDataToDb(DatabaseManager &dbManager, const RequestConfig &requestConfig) {
-    dbManager.writeData(requestConfig, storage_);
+void Indexer::saveData(StorageWriter &writer, const RequestConfig &requestConfig) {
+    writer.addPage(requestConfig, storage_);
 }
 
 std::string Indexer::getText() {
@@ -24,18 +30,34 @@ std::string Indexer::getText() {
 }
 
 void Indexer::calcCountWords() {
-    std::string word;
-
-    for (int i = 0; i < text_.length(); ++i) {
-        if (text_[i] == ' ') {
-            continue;
+    // Форма однозначно определяет основу, поэтому вхождения форм считаются по всему тексту.
+    std::unordered_map<std::string, int> surfaceCounts;
+    for (auto &token : analyzer_.tokenize(text_)) {
+        TermEntry &entry = storage_[token.term];
+        entry.count++;
+        entry.fieldCounts[FIELD_BODY]++;
+        entry.positions.push_back(token.position);
+
+        const int count = ++surfaceCounts[token.surface];
+        if (entry.surface.empty() || count > surfaceCounts[entry.surface]) {
+            entry.surface = std::move(token.surface);
         }
+    }
+}
+
+void Indexer::calcFieldCounts(DocumentField field, const std::string &text) {
+    for (auto &word : analyzer_.analyze(text)) {
+        storage_[word].fieldCounts[field]++;
+    }
+}
 
-        word = "";
-        while (i < text_.length() && text_[i] != ' ') {
-            word += text_[i];
-            ++i;
+void Indexer::calcImpacts() {
+    for (auto &val : storage_) {
+        TermEntry &entry = val.second;
+        entry.impact = 0;
+        for (int field = 0; field < FIELD_COUNT; ++field) {
+            const DocumentField documentField = static_cast<DocumentField>(field);
+            entry.impact += entry.fieldCounts[field] * boosts_.get(documentField);
         }
-        storage_[word]++;
     }
 }
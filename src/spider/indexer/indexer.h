@@ -2,10 +2,10 @@
 #include <iostream>
 #include <string>
 #include <map>
-#include <pqxx/pqxx>
 
 #include "../parser/parser.h"
-#include "../database_manager/database_manager.h"
+#include "../../analyzer/analyzer.h"
+#include "../../storage/storage.h"
 #include "../common_data.h"
 
 /**
@@ -13,21 +13,24 @@
 */
 class Indexer {
 public:
-    //TODO Вынести отдельно. Используется и в классе БД.
-    //! Тип хранилища счетчика слов.
-    typedef std::map<std::string, int> Storage;
+    //! Тип хранилища слов страницы.
+    typedef TermStorage Storage;
 
     /**
     * @brief Конструктор.
+    * @param analyzer Анализатор, приводящий слова страницы к нормализованной форме.
+    * @param boosts Веса полей страницы.
     */
-    Indexer();
+    explicit Indexer(const Analyzer &analyzer, const FieldBoosts &boosts = FieldBoosts());
 
     /**
     * @brief Установить HTML страницу.
-    * @details Очищает HTML страницу от знаков тегов и знаков препинания.
+    * @details Очищает HTML страницу от знаков тегов и знаков препинания, считает число
+    * вхождений слов в каждое поле и вклад слов в релевантность страницы.
     * @param htmlPage Необработанная HTML строка.
+    * @param anchorText Текст ссылки, по которой была найдена страница.
     */
-    void setPage(const std::string &htmlPage);
+    void setPage(const std::string &htmlPage, const std::string &anchorText = "");
 
     /**
     * @brief Получить обработанную HTML страницу.
@@ -36,20 +39,34 @@ public:
     std::string getText();
 
     /**
-    * @brief Сохранить запись в БД.
-    * @param dbManager Ссылка на объект БД.
+    * @brief Записать слова страницы в хранилище индекса.
+    * @param writer Объект записи текущего потока.
     * @param requestConfig Параметры подключения к странице.
     */
-    void saveDataToDb(DatabaseManager &dbManager, const RequestConfig &requestConfig);
+    void saveData(StorageWriter &writer, const RequestConfig &requestConfig);
 
 private:
     Parser parser_; //!< Парсер HTML страницы.
-    Storage storage_; //!< Хранилище счетчика слов.
+    const Analyzer &analyzer_; //!< Анализатор текста.
+    FieldBoosts boosts_; //!< Веса полей страницы.
+    Storage storage_; //!< Хранилище счетчиков и позиций слов.
     //! HTML станица в виде строки без тегов и знаков препинания, в нижнем регистре.
     std::string text_;
 
     /**
-    * @brief Посчитать количество каждого слова в строке.
+    * @brief Посчитать количество и позиции каждого нормализованного слова в строке.
     */
     void calcCountWords();
+
+    /**
+    * @brief Посчитать количество вхождений нормализованных слов в поле страницы.
+    * @param field Поле.
+    * @param text Текст поля.
+    */
+    void calcFieldCounts(DocumentField field, const std::string &text);
+
+    /**
+    * @brief Рассчитать вклад каждого слова в релевантность страницы с учетом весов полей.
+    */
+    void calcImpacts();
 };
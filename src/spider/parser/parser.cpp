@@ -5,29 +5,73 @@
 #include <libxml/xpath.h>
 #include <boost/locale.hpp>
 
+namespace {
+
+/**
+* @brief Собрать текст всех узлов, найденных XPath выражением.
+* @param doc HTML документ.
+* @param expression XPath выражение.
+* @return Текст узлов, разделенный пробелами.
+*/
+std::string extractText(htmlDocPtr doc, const char *expression) {
+    std::string text;
+
+    xmlXPathContextPtr xpathCtx = xmlXPathNewContext(doc);
+    if (xpathCtx == nullptr) {
+        return text;
+    }
+
+    xmlXPathObjectPtr xpathObj = xmlXPathEvalExpression(BAD_CAST expression, xpathCtx);
+    if (xpathObj != nullptr && xpathObj->nodesetval != nullptr) {
+        for (int i = 0; i < xpathObj->nodesetval->nodeNr; ++i) {
+            xmlChar *content = xmlNodeGetContent(xpathObj->nodesetval->nodeTab[i]);
+            if (content != nullptr) {
+                text += reinterpret_cast<char *>(content);
+                text += ' ';
+                xmlFree(content);
+            }
+        }
+    }
+
+    xmlXPathFreeObject(xpathObj);
+    xmlXPathFreeContext(xpathCtx);
+    return text;
+}
+
+} // namespace
+
 Parser::Parser() :
 sourceStr_(),
-text_() {
+fields_() {
 }
 
 void Parser::parse(const std::string &source) {
     try {
         sourceStr_ = source;
         clearTags();
-        clearPunctuation();
-        toLowerRegistr();
+        for (auto &text : fields_) {
+            clearPunctuation(text);
+            toLowerRegistr(text);
+        }
     } catch (std::exception &err) {
         std::cerr << "Parser::parse: Error: " << err.what() << std::endl;
     }
 }
 
 std::string Parser::getText() const {
-    return text_;
+    return fields_[FIELD_BODY];
+}
+
+std::string Parser::getField(DocumentField field) const {
+    return field < FIELD_COUNT ? fields_[field] : std::string();
 }
 
 void Parser::clearTags() {
+    for (auto &text : fields_) {
+        text.clear();
+    }
+
     if (sourceStr_.empty()) {
-        text_ = "";
         return;
     }
 
@@ -44,28 +88,32 @@ void Parser::clearTags() {
         return;
     }
 
-    // Удаление тегов
-    xmlChar *textWithoutTags = xmlNodeGetContent(xmlDocGetRootElement(doc));
-    text_ = reinterpret_cast<char *>(textWithoutTags);
-    xmlFree(textWithoutTags);
+    // Удаление тегов. Текстовые узлы разделяются пробелами, чтобы слова соседних блоков
+    // не склеивались; содержимое скриптов и стилей не является текстом страницы.
+    fields_[FIELD_BODY] = extractText(doc, "//text()[not(ancestor::script)][not(ancestor::style)]");
+
+    fields_[FIELD_TITLE] = extractText(doc, "//title");
+    fields_[FIELD_HEADING] = extractText(doc, "//h1 | //h2 | //h3");
+
+    xmlFreeDoc(doc);
 }
 
-void Parser::clearPunctuation() {
-    if (text_.empty()) {
+void Parser::clearPunctuation(std::string &text) {
+    if (text.empty()) {
         return;
     }
 
-    for (size_t i = 0; i < text_.size(); ++i) {
-        if (ispunct((unsigned char)text_[i])) {
-            text_[i] = ' ';
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (ispunct((unsigned char)text[i])) {
+            text[i] = ' ';
         }
     }
 }
 
-void Parser::toLowerRegistr() {
+void Parser::toLowerRegistr(std::string &text) {
     boost::locale::generator gen;
     std::locale loc = gen("ru_RU.UTF-8");
     std::locale::global(loc);
 
-    text_ = boost::locale::to_lower(text_);
+    text = boost::locale::to_lower(text);
 }
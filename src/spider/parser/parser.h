@@ -1,14 +1,18 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <string>
 #include <libxml/HTMLparser.h>
 #include <libxml/xpath.h>
 
+#include "../../common_data.h"
+
 /**
 * @brief Парсер.
 * @details Очищает строку от HTML тегов и знаков препинания, переводит все слова в
-* нижний регистр.
+* нижний регистр. Помимо всего текста страницы отдельно извлекает заголовок страницы и
+* заголовки разделов.
 */
 class Parser {
 public:
@@ -29,22 +33,32 @@ public:
     */
     std::string getText() const;
 
+    /**
+    * @brief Получить обработанный текст поля страницы.
+    * @details Текст входящих ссылок парсер не извлекает, для него возвращается пустая строка.
+    * @param field Поле.
+    * @return Текст поля.
+    */
+    std::string getField(DocumentField field) const;
+
 private:
     std::string sourceStr_; //!< Исходная HTML страница в виде строки.
-    std::string text_; //!< Преобразованная HTML страница.
+    std::array<std::string, FIELD_COUNT> fields_; //!< Преобразованный текст полей страницы.
 
     /**
-    * @brief Очистить HTML страницу от тегов.
+    * @brief Очистить HTML страницу от тегов и разложить текст по полям.
     */
     void clearTags();
 
     /**
-    * @brief Очистить HTML страницу от знаков препинания.
+    * @brief Очистить текст от знаков препинания.
+    * @param text Текст.
     */
-    void clearPunctuation();
+    void clearPunctuation(std::string &text);
 
     /**
-    * @brief Перевести слова HTML страницы в нижний регистр.
+    * @brief Перевести слова текста в нижний регистр.
+    * @param text Текст.
     */
-    void toLowerRegistr();
+    void toLowerRegistr(std::string &text);
 };
@@ -2,7 +2,9 @@
 #include "../utils/secondary_function.h"
 
 Spider::Spider() :
-dbmanager_(nullptr),
+storage_(nullptr),
+analyzer_(nullptr),
+fieldBoosts_(),
 stop_(false),
 maxRecursiveCount_(1) {
     setThreadCount(std::thread::hardware_concurrency());
@@ -23,9 +25,17 @@ Spider::~Spider() {
     }
 }
 
-void Spider::setDbManager(DatabaseManager *dbManager) {
-    dbmanager_ = dbManager;
-    dbmanager_->clearDatabase();
+void Spider::setStorage(Storage *storage) {
+    storage_ = storage;
+    storage_->clear();
+}
+
+void Spider::setAnalyzer(const Analyzer *analyzer) {
+    analyzer_ = analyzer;
+}
+
+void Spider::setFieldBoosts(const FieldBoosts &boosts) {
+    fieldBoosts_ = boosts;
 }
 
 void Spider::setThreadCount(size_t count) {
@@ -56,6 +66,9 @@ void Spider::addTask(const QueueParams &task) {
 }
 
 void Spider::workerThread() {
+    // Объект записи уничтожается при выходе из потока и передает остаток страниц хранилищу.
+    std::unique_ptr<StorageWriter> writer;
+
     while (true) {
         QueueParams task;
 
@@ -77,7 +90,7 @@ void Spider::workerThread() {
             }
         }
 
-        processTask(task);
+        processTask(task, writer);
         activeTasks_--;
 
         if (tasksQueue_.empty() && activeTasks_ == 0) {
@@ -86,7 +99,8 @@ void Spider::workerThread() {
     }
 }
 
-void Spider::processTask(const QueueParams &queueParams) {
+void Spider::processTask(const QueueParams &queueParams,
+        std::unique_ptr<StorageWriter> &writer) {
     try {
         // std::cout << "Spider::processTask: start task: "
         //           << "host: " << queueParams.requestConfig.host
@@ -95,13 +109,13 @@ void Spider::processTask(const QueueParams &queueParams) {
 
         auto client = std::make_unique<PageLoader>();
         std::string responseStr = client->get(queueParams.requestConfig);
-        auto indexer = std::make_unique<Indexer>();
-        indexer->setPage(responseStr);
+        auto indexer = std::make_unique<Indexer>(*analyzer_, fieldBoosts_);
+        indexer->setPage(responseStr, queueParams.anchorText);
 
-        {
-            std::unique_lock<std::mutex> dbLock(dbMutex_);
-            indexer->saveDataToDb(*dbmanager_, queueParams.requestConfig);
+        if (!writer) {
+            writer = storage_->createWriter();
         }
+        indexer->saveData(*writer, queueParams.requestConfig);
 
         // std::vector<RequestConfig> configs;
         // {
@@ -109,11 +123,13 @@ void Spider::processTask(const QueueParams &queueParams) {
         //     extractAllLinks(responseStr, configs);
         // }
         std::vector<RequestConfig> targetConfigs;
-        extractAllLinks(responseStr, targetConfigs, queueParams.requestConfig);
+        std::vector<std::string> anchorTexts;
+        extractAllLinks(responseStr, targetConfigs, queueParams.requestConfig, &anchorTexts);
 
-        for (auto &config : targetConfigs) {
+        for (size_t i = 0; i < targetConfigs.size(); ++i) {
             if (queueParams.recursiveCount < maxRecursiveCount_) {
-                addTask(QueueParams(config, queueParams.recursiveCount + 1));
+                addTask(QueueParams(targetConfigs[i], queueParams.recursiveCount + 1,
+                        anchorTexts[i]));
             }
         }
     } catch (std::exception &err) {
@@ -121,7 +137,7 @@ void Spider::processTask(const QueueParams &queueParams) {
     }
 }
 
-void Spider::start(const RequestConfig &startRequestConfig, int recursiveCount) {
+bool Spider::start(const RequestConfig &startRequestConfig, int recursiveCount) {
     maxRecursiveCount_ = recursiveCount;
     addTask(QueueParams(startRequestConfig, 1));
 
@@ -130,4 +146,18 @@ void Spider::start(const RequestConfig &startRequestConfig, int recursiveCount)
 
     stop_ = true;
     condition_.notify_all();
+    lock.unlock();
+
+    // Дожидаемся, пока потоки передадут свои страницы, и дописываем их в хранилище.
+    for (std::thread &worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (!storage_->flush()) {
+        std::cerr << "Spider::start: Error: not all pages were written to the storage"
+                  << std::endl;
+        return false;
+    }
+    return true;
 }
@@ -10,9 +10,10 @@
 #include <atomic>
 #include <condition_variable>
 #include <future>
+#include <memory>
 
 #include "indexer/indexer.h"
-#include "../database_manager/database_manager.h"
+#include "../storage/storage.h"
 #include "../common_data.h"
 #include "page_loader/page_loader.h"
 
@@ -22,15 +23,19 @@
 struct QueueParams {
     RequestConfig requestConfig; //!< Параметры подключения к HTML странице.
     size_t recursiveCount; //!< Текущая глубина рекурсии.
+    std::string anchorText; //!< Текст ссылки, по которой найдена страница.
 
     /**
     * @brief Конструктор.
     * @param reqConfig Параметры подключения к HTML странице.
     * @param recursiveCnt //!< Текущая глубина рекурсии.
+    * @param anchor Текст ссылки, по которой найдена страница.
     */
-    QueueParams(const RequestConfig &reqConfig, size_t recursiveCnt) {
+    QueueParams(const RequestConfig &reqConfig, size_t recursiveCnt,
+            const std::string &anchor = "") {
         requestConfig = reqConfig;
         recursiveCount = recursiveCnt;
+        anchorText = anchor;
     }
 
     /**
@@ -59,13 +64,25 @@ public:
     * @brief Запустить стартовую задачу.
     * @param startRequestConfig Параметры подключения к HTML странице.
     * @param recursiveCount //!< Максимальная глубина рекурсии.
+    * @return false, если не все страницы записаны в хранилище.
     */
-    void start(const RequestConfig &startRequestConfig, int recursiveCount);
+    bool start(const RequestConfig &startRequestConfig, int recursiveCount);
 
     /**
-    * @brief Установить объект взаимодействия с БД.
+    * @brief Установить хранилище индекса. Хранилище очищается.
+    * @details Каждый рабочий поток записывает страницы через собственный объект записи.
     */
-    void setDbManager(DatabaseManager *dbManager);
+    void setStorage(Storage *storage);
+
+    /**
+    * @brief Установить анализатор текста, общий для всех рабочих потоков.
+    */
+    void setAnalyzer(const Analyzer *analyzer);
+
+    /**
+    * @brief Установить веса полей страницы при расчете релевантности.
+    */
+    void setFieldBoosts(const FieldBoosts &boosts);
 
     /**
     * @brief Установить число потоков.
@@ -73,11 +90,12 @@ public:
     void setThreadCount(size_t count);
 
 private:
-    DatabaseManager *dbmanager_; //!< Объект взаимодействия с БД PostgreSql.
+    Storage *storage_; //!< Хранилище индекса.
+    const Analyzer *analyzer_; //!< Анализатор текста.
+    FieldBoosts fieldBoosts_; //!< Веса полей страницы.
     std::queue<QueueParams> tasksQueue_; //!< Очередь задач.
     std::vector<std::thread> workers_; //!< Контейнер рабочих потоков.
     std::mutex queueMutex_; //!< Мьютекс для работы с очередью.
-    std::mutex dbMutex_; //!< Мьютекс для работы с БД.
     std::condition_variable condition_;
     std::atomic<bool> stop_; //!< Условие остановки.
     std::atomic<size_t> activeTasks_ {0}; //!< Счетчик активных задач.
@@ -91,8 +109,10 @@ private:
 
     /**
     * @brief Запустить задачу скачивания и индексации HTML страницы.
+    * @param queueParams Параметры задачи.
+    * @param writer Объект записи текущего потока, создается при первой записи.
     */
-    void processTask(const QueueParams &queueParams);
+    void processTask(const QueueParams &queueParams, std::unique_ptr<StorageWriter> &writer);
 
     /**
     * @brief Добавить задачу скачивания и индексации HTML страницы в очередь.
@@ -0,0 +1,85 @@
+#include "embedded_storage.h"
+#include "../utils/secondary_function.h"
+
+namespace {
+
+/**
+* @brief Запись страниц в локальный раздел индекса потока.
+*/
+class EmbeddedWriter : public StorageWriter {
+public:
+    /**
+    * @brief Конструктор.
+    * @param builder Построитель индекса.
+    */
+    explicit EmbeddedWriter(IndexBuilder &builder) :
+    partition_(builder) {
+    }
+
+    void addPage(const RequestConfig &requestConfig, const TermStorage &terms) override {
+        partition_.addDocument(makeUrlFromRequestConfig(requestConfig), terms);
+    }
+
+private:
+    IndexPartition partition_; //!< Раздел индекса потока.
+};
+
+} // namespace
+
+EmbeddedStorage::EmbeddedStorage(const StorageConfig &config) :
+indexConfig_(config.indexConfig),
+resultLimit_(config.resultLimit),
+mutex_(),
+builder_(),
+searcherOnce_(),
+searcher_() {
+}
+
+void EmbeddedStorage::clear() {
+    builder().clear();
+}
+
+std::unique_ptr<StorageWriter> EmbeddedStorage::createWriter() {
+    return std::make_unique<EmbeddedWriter>(builder());
+}
+
+bool EmbeddedStorage::flush() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!builder_) {
+            return true;
+        }
+    }
+
+    // Обход, записанный не полностью, не публикуется.
+    if (!builder_->flush()) {
+        return false;
+    }
+    builder_->publish();
+    return true;
+}
+
+void EmbeddedStorage::search(SearchResults &results, const QueryNode &query) {
+    searcher().search(results, query);
+}
+
+void EmbeddedStorage::forEachTerm(const TermConsumer &consumer) {
+    searcher().forEachTerm(consumer);
+}
+
+IndexBuilder &EmbeddedStorage::builder() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!builder_) {
+        builder_ = std::make_unique<IndexBuilder>(indexConfig_);
+    }
+    return *builder_;
+}
+
+IndexSearcher &EmbeddedStorage::searcher() {
+    std::call_once(searcherOnce_, [this]() {
+        searcher_ = std::make_unique<IndexSearcher>(indexConfig_.directory);
+        searcher_->setResultLimit(resultLimit_);
+        searcher_->setRefreshListener([this](uint64_t) { notifyChanged(); });
+    });
+    return *searcher_;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "storage.h"
+#include "../index/index_builder.h"
+#include "../index/index_searcher.h"
+
+/**
+* @brief Встроенное хранилище индекса в локальных файлах.
+* @details Страницы записываются в сегменты через IndexBuilder, поиск выполняется по
+* отображенным в память сегментам через IndexSearcher. Внешние сервисы не нужны.
+* Построитель и поисковик создаются при первом обращении. Поиск видит только снимки,
+* опубликованные flush в конце обхода.
+*/
+class EmbeddedStorage : public Storage {
+public:
+    /**
+    * @brief Конструктор.
+    * @param config Параметры хранилища.
+    */
+    explicit EmbeddedStorage(const StorageConfig &config);
+
+    void clear() override;
+    std::unique_ptr<StorageWriter> createWriter() override;
+    bool flush() override;
+    void search(SearchResults &results, const QueryNode &query) override;
+    void forEachTerm(const TermConsumer &consumer) override;
+
+private:
+    IndexBuilderConfig indexConfig_; //!< Параметры индекса.
+    size_t resultLimit_; //!< Число лучших страниц в результатах поиска.
+    std::mutex mutex_; //!< Мьютекс для создания построителя.
+    std::unique_ptr<IndexBuilder> builder_; //!< Построитель индекса.
+    std::once_flag searcherOnce_; //!< Флаг создания поисковика без мьютекса на пути запроса.
+    std::unique_ptr<IndexSearcher> searcher_; //!< Поиск по индексу.
+
+    /**
+    * @brief Получить построитель индекса, при необходимости создав его.
+    */
+    IndexBuilder &builder();
+
+    /**
+    * @brief Получить поиск по индексу, при необходимости создав его.
+    */
+    IndexSearcher &searcher();
+};
@@ -0,0 +1,89 @@
+#include "postgres_storage.h"
+#include "../database_manager/database_manager.h"
+#include "../database_manager/write_behind_queue.h"
+
+namespace {
+
+/**
+* @brief Запись страниц в очередь отложенной записи.
+*/
+class PostgresWriter : public StorageWriter {
+public:
+    /**
+    * @brief Конструктор.
+    * @param queue Очередь отложенной записи.
+    */
+    explicit PostgresWriter(WriteBehindQueue &queue) :
+    queue_(queue) {
+    }
+
+    void addPage(const RequestConfig &requestConfig, const TermStorage &terms) override {
+        queue_.push(PageTerms {requestConfig, terms});
+    }
+
+private:
+    WriteBehindQueue &queue_; //!< Очередь отложенной записи.
+};
+
+} // namespace
+
+PostgresStorage::PostgresStorage(const StorageConfig &config) :
+writeBehindConfig_(config.writeBehindConfig),
+dbManager_(std::make_unique<DatabaseManager>(config.dbConnectionString, config.dbPoolSize)),
+mutex_(),
+writeQueue_() {
+    dbManager_->setResultLimit(config.resultLimit);
+    dbManager_->setPostingsPartitions(config.dbPartitions);
+    if (config.backend == "fulltext") {
+        dbManager_->setSchema(SCHEMA_FULLTEXT);
+    } else if (config.lexiconCache.enabled) {
+        dbManager_->enableLexiconCache(config.lexiconCache, [this]() { notifyChanged(); });
+    }
+}
+
+PostgresStorage::~PostgresStorage() {
+    // Очередь пишет через dbManager_, поэтому останавливается раньше него.
+    writeQueue_.reset();
+}
+
+void PostgresStorage::clear() {
+    dbManager_->createTables();
+    dbManager_->clearDatabase();
+}
+
+std::unique_ptr<StorageWriter> PostgresStorage::createWriter() {
+    return std::make_unique<PostgresWriter>(writeQueue());
+}
+
+bool PostgresStorage::flush() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!writeQueue_) {
+            return true;
+        }
+    }
+
+    // Если БД недоступна, перестраивать индекс бесполезно: страницы остаются в очереди.
+    if (!writeQueue_->flush()) {
+        return false;
+    }
+    dbManager_->clusterPostings();
+    notifyChanged();
+    return true;
+}
+
+void PostgresStorage::search(SearchResults &results, const QueryNode &query) {
+    dbManager_->search(results, query);
+}
+
+void PostgresStorage::forEachTerm(const TermConsumer &consumer) {
+    dbManager_->readLexicon(consumer);
+}
+
+WriteBehindQueue &PostgresStorage::writeQueue() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!writeQueue_) {
+        writeQueue_ = std::make_unique<WriteBehindQueue>(*dbManager_, writeBehindConfig_);
+    }
+    return *writeQueue_;
+}
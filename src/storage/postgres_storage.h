@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "storage.h"
+
+class DatabaseManager;
+class WriteBehindQueue;
+
+/**
+* @brief Хранилище индекса в БД PostgreSql.
+* @details Страницы записываются пакетами через очередь отложенной записи, которая
+* создается при первом запросе объекта записи, поэтому поисковик ее не запускает.
+* Снимков нет: во время обхода поисковик видит недописанный индекс.
+* Заголовки libpqxx подключаются только в postgres_storage.cpp.
+*/
+class PostgresStorage : public Storage {
+public:
+    /**
+    * @brief Конструктор. Открывает пул подключений к БД.
+    * @param config Параметры хранилища.
+    */
+    explicit PostgresStorage(const StorageConfig &config);
+
+    /**
+    * @brief Деструктор. Дописывает страницы из очереди.
+    */
+    ~PostgresStorage() override;
+
+    void clear() override;
+    std::unique_ptr<StorageWriter> createWriter() override;
+    bool flush() override;
+    void search(SearchResults &results, const QueryNode &query) override;
+    void forEachTerm(const TermConsumer &consumer) override;
+
+private:
+    WriteBehindConfig writeBehindConfig_; //!< Параметры очереди отложенной записи.
+    std::unique_ptr<DatabaseManager> dbManager_; //!< Объект взаимодействия с БД.
+    std::mutex mutex_; //!< Мьютекс для создания очереди.
+    std::unique_ptr<WriteBehindQueue> writeQueue_; //!< Очередь отложенной записи.
+
+    /**
+    * @brief Получить очередь отложенной записи, при необходимости создав ее.
+    */
+    WriteBehindQueue &writeQueue();
+};
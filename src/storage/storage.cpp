@@ -0,0 +1,32 @@
+#include "storage.h"
+#include "embedded_storage.h"
+#include "postgres_storage.h"
+
+#include <stdexcept>
+
+std::unique_ptr<Storage> Storage::create(const StorageConfig &config) {
+    if (config.backend == "postgres" || config.backend == "fulltext") {
+        return std::make_unique<PostgresStorage>(config);
+    }
+    if (config.backend == "embedded") {
+        return std::make_unique<EmbeddedStorage>(config);
+    }
+
+    throw std::runtime_error("Storage::create: unknown backend " + config.backend);
+}
+
+void Storage::setChangeListener(std::function<void()> listener) {
+    std::unique_lock<std::mutex> lock(listenerMutex_);
+    listener_ = std::move(listener);
+}
+
+void Storage::notifyChanged() {
+    std::function<void()> listener;
+    {
+        std::unique_lock<std::mutex> lock(listenerMutex_);
+        listener = listener_;
+    }
+    if (listener) {
+        listener();
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../common_data.h"
+#include "../database_manager/database_config.h"
+#include "../index/index_builder.h"
+
+/**
+* @brief Параметры хранилища индекса.
+*/
+struct StorageConfig {
+    std::string backend = "embedded"; //!< Реализация: embedded, postgres или fulltext.
+    std::string dbConnectionString; //!< Строка подключения к БД PostgreSql.
+    size_t dbPoolSize = 4; //!< Число подключений к БД.
+    size_t dbPartitions = 1; //!< Число хеш-секций таблицы вхождений в БД.
+    size_t resultLimit = 100; //!< Число лучших страниц в результатах поиска.
+    WriteBehindConfig writeBehindConfig; //!< Параметры очереди отложенной записи в БД.
+    LexiconCacheConfig lexiconCache; //!< Параметры словаря БД в памяти поисковика.
+    IndexBuilderConfig indexConfig; //!< Параметры встроенного индекса.
+};
+
+/**
+* @brief Запись страниц в хранилище из одного потока.
+* @details Каждый рабочий поток паука получает собственный объект записи, поэтому
+* реализации могут обходиться без блокировок на пути добавления страницы.
+*/
+class StorageWriter {
+public:
+    /**
+    * @brief Деструктор. Передает хранилищу накопленные страницы.
+    */
+    virtual ~StorageWriter() = default;
+
+    /**
+    * @brief Добавить страницу.
+    * @param requestConfig Параметры подключения к странице.
+    * @param terms Слова страницы.
+    */
+    virtual void addPage(const RequestConfig &requestConfig, const TermStorage &terms) = 0;
+};
+
+/**
+* @brief Хранилище инвертированного индекса.
+* @details Общий интерфейс для паука и поисковика. Реализации: PostgresStorage - таблицы
+* в БД PostgreSql (fulltext - документы tsvector вместо таблиц вхождений),
+* EmbeddedStorage - сегменты индекса в локальных файлах.
+* Только EmbeddedStorage публикует неизменяемые снимки: поисковик видит индекс целиком
+* после окончания обхода, а clear() не затрагивает опубликованный снимок. В PostgresStorage
+* поисковик видит страницы по мере записи, а clear() сразу удаляет данные, по которым
+* идет поиск.
+*/
+class Storage {
+public:
+    /**
+    * @brief Деструктор.
+    */
+    virtual ~Storage() = default;
+
+    /**
+    * @brief Создать хранилище по параметрам.
+    * @param config Параметры хранилища.
+    * @return Хранилище. Бросает std::runtime_error для неизвестной реализации.
+    */
+    static std::unique_ptr<Storage> create(const StorageConfig &config);
+
+    /**
+    * @brief Подготовить хранилище к записи и удалить все данные.
+    */
+    virtual void clear() = 0;
+
+    /**
+    * @brief Создать объект записи для текущего потока.
+    */
+    virtual std::unique_ptr<StorageWriter> createWriter() = 0;
+
+    /**
+    * @brief Дописать все накопленные страницы. Вызывается после уничтожения объектов записи.
+    * @return false, если записаны не все страницы; незаписанные страницы остаются в
+    * хранилище и дописываются следующим flush.
+    */
+    virtual bool flush() = 0;
+
+    /**
+    * @brief Найти страницы, подходящие под запрос.
+    * @param results Контейнер для записи URL страниц по убыванию релевантности.
+    * @param query Дерево запроса с нормализованными словами.
+    */
+    virtual void search(SearchResults &results, const QueryNode &query) = 0;
+
+    /**
+    * @brief Перебрать слова индекса с формами и документными частотами.
+    * @details Слово может передаваться несколько раз, например, из разных сегментов;
+    * его частоты складываются, а формы могут различаться. Если форма неизвестна,
+    * вместо нее передается само слово.
+    * @param consumer Обработчик слова, его формы и документной частоты.
+    */
+    virtual void forEachTerm(const TermConsumer &consumer) = 0;
+
+    /**
+    * @brief Установить обработчик изменения индекса.
+    * @details Вызывается, когда поиск начинает видеть новые данные, например, чтобы
+    * сбросить кэш результатов.
+    * @param listener Обработчик.
+    */
+    void setChangeListener(std::function<void()> listener);
+
+protected:
+    /**
+    * @brief Сообщить обработчику об изменении индекса.
+    */
+    void notifyChanged();
+
+private:
+    std::mutex listenerMutex_; //!< Мьютекс для работы с обработчиком.
+    std::function<void()> listener_; //!< Обработчик изменения индекса.
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+* @brief Фильтр Блума для строк.
+* @details Хранит множество строк в битовом массиве примерно по 10 бит на строку при доле
+* ложных срабатываний 1%. Отвечает "точно нет" или "возможно, есть": строка, добавленная
+* в фильтр, всегда находится. Номера битов строки получаются двойным хешированием: из хеша
+* FNV-1a перемешиванием splitmix64 получаются два независимых 64-битных хеша.
+*/
+class BloomFilter {
+public:
+    /**
+    * @brief Конструктор.
+    * @param capacity Число строк, для которого рассчитан фильтр.
+    * @param falsePositiveRate Доля ложных срабатываний при capacity строках.
+    */
+    BloomFilter(size_t capacity, double falsePositiveRate) :
+    bits_(),
+    hashes_(1),
+    capacity_(std::max<size_t>(capacity, 1)),
+    size_(0) {
+        const double rate = std::min(std::max(falsePositiveRate, 1e-6), 0.5);
+        const double ln2 = std::log(2.0);
+        const size_t bitCount = static_cast<size_t>(
+                std::ceil(-static_cast<double>(capacity_) * std::log(rate) / (ln2 * ln2)));
+        bits_.assign((std::max<size_t>(bitCount, 64) + 63) / 64, 0);
+        hashes_ = std::max<size_t>(
+                static_cast<size_t>(std::lround(bits_.size() * 64.0 / capacity_ * ln2)), 1);
+    }
+
+    /**
+    * @brief Добавить строку.
+    */
+    void add(const std::string &value) {
+        const uint64_t first = mix(hash(value));
+        const uint64_t second = mix(first) | 1;
+        const uint64_t bitCount = bits_.size() * 64;
+        for (size_t i = 0; i < hashes_; ++i) {
+            const uint64_t bit = (first + i * second) % bitCount;
+            bits_[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+        ++size_;
+    }
+
+    /**
+    * @brief Проверить, может ли строка быть в фильтре.
+    * @return false, если строки в фильтре точно нет.
+    */
+    bool mayContain(const std::string &value) const {
+        const uint64_t first = mix(hash(value));
+        const uint64_t second = mix(first) | 1;
+        const uint64_t bitCount = bits_.size() * 64;
+        for (size_t i = 0; i < hashes_; ++i) {
+            const uint64_t bit = (first + i * second) % bitCount;
+            if (!(bits_[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+    * @brief Проверить, превышено ли число строк, для которого рассчитан фильтр.
+    * @details После этого доля ложных срабатываний растет, и фильтр стоит построить заново.
+    */
+    bool full() const {
+        return size_ > capacity_;
+    }
+
+    /**
+    * @brief Получить размер битового массива в байтах.
+    */
+    size_t memoryUsage() const {
+        return bits_.size() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> bits_; //!< Битовый массив.
+    size_t hashes_; //!< Число битов на строку.
+    size_t capacity_; //!< Число строк, для которого рассчитан фильтр.
+    size_t size_; //!< Число добавленных строк.
+
+    /**
+    * @brief Посчитать хеш FNV-1a строки.
+    */
+    static uint64_t hash(const std::string &value) {
+        uint64_t result = 14695981039346656037ULL;
+        for (unsigned char ch : value) {
+            result ^= ch;
+            result *= 1099511628211ULL;
+        }
+        return result;
+    }
+
+    /**
+    * @brief Перемешать биты значения (финальный шаг splitmix64).
+    */
+    static uint64_t mix(uint64_t value) {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+* @brief Параметры ранжирования BM25.
+* @details Частота слова в документе - вклад слова с учетом весов полей страницы, длина
+* документа - число слов на странице. Оценка переводится в целое число умножением на
+* scoreScale, чтобы складываться с целочисленной прибавкой за близость слов.
+*/
+namespace bm25 {
+
+//! Насыщение частоты слова.
+const double k1 = 1.2;
+
+//! Степень нормализации по длине документа.
+const double b = 0.75;
+
+//! Множитель перевода оценки в целое число.
+const double scoreScale = 100.0;
+
+/**
+* @brief Посчитать обратную документную частоту слова.
+* @param docCount Число документов в коллекции.
+* @param docFreq Число документов, содержащих слово.
+*/
+inline double idf(uint64_t docCount, uint64_t docFreq) {
+    const double n = static_cast<double>(std::max(docCount, docFreq));
+    const double df = static_cast<double>(docFreq);
+    return std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+}
+
+/**
+* @brief Посчитать вес слова в документе без множителя idf.
+* @details Возрастает с частотой и убывает с длиной документа, поэтому вес при
+* наибольшей частоте и наименьшей длине ограничивает сверху веса группы документов.
+* @param tf Частота слова в документе.
+* @param length Длина документа.
+* @param averageLength Средняя длина документа в коллекции.
+*/
+inline double termWeight(uint32_t tf, uint32_t length, double averageLength) {
+    if (tf == 0) {
+        return 0;
+    }
+    const double norm = 1.0 - b + b * length / std::max(averageLength, 1.0);
+    return tf * (k1 + 1.0) / (tf + k1 * norm);
+}
+
+} // namespace bm25
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+* @brief Потокобезопасный кэш с вытеснением давно не использованных значений (LRU).
+* @details Ключи распределены по сегментам по хешу, у каждого сегмента свой мьютекс и своя
+* очередь LRU, поэтому потоки, обращающиеся к разным ключам, почти не ждут друг друга.
+* Значение хранится в shared_ptr и выдается без копирования; устаревшее по времени жизни
+* значение удаляется при обращении.
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class LruCache {
+public:
+    /**
+    * @brief Конструктор.
+    * @param capacity Число хранимых значений.
+    * @param shards Число сегментов.
+    * @param ttl Время жизни значения, 0 - без ограничения.
+    */
+    LruCache(size_t capacity, size_t shards, std::chrono::milliseconds ttl) :
+    shardCapacity_(0),
+    ttl_(ttl),
+    shards_(std::max<size_t>(shards, 1)) {
+        shardCapacity_ = std::max<size_t>((capacity + shards_.size() - 1) / shards_.size(), 1);
+    }
+
+    /**
+    * @brief Найти значение.
+    * @param key Ключ.
+    * @return Значение или nullptr, если значения нет или оно устарело.
+    */
+    std::shared_ptr<const Value> get(const Key &key) {
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            return nullptr;
+        }
+        if (ttl_.count() > 0 && Clock::now() >= it->second->expires) {
+            shard.entries.erase(it->second);
+            shard.index.erase(it);
+            return nullptr;
+        }
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return it->second->value;
+    }
+
+    /**
+    * @brief Сохранить значение, вытеснив самое давно использованное при переполнении.
+    * @param key Ключ.
+    * @param value Значение.
+    * @return Сохраненное значение.
+    */
+    std::shared_ptr<const Value> put(const Key &key, Value value) {
+        auto stored = std::make_shared<const Value>(std::move(value));
+        const Clock::time_point expires = Clock::now() + ttl_;
+
+        Shard &shard = shardFor(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            it->second->value = stored;
+            it->second->expires = expires;
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            return stored;
+        }
+
+        shard.entries.push_front(Entry {key, stored, expires});
+        shard.index.emplace(key, shard.entries.begin());
+        if (shard.entries.size() > shardCapacity_) {
+            shard.index.erase(shard.entries.back().key);
+            shard.entries.pop_back();
+        }
+        return stored;
+    }
+
+    /**
+    * @brief Удалить все значения.
+    */
+    void clear() {
+        for (auto &shard : shards_) {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            shard.index.clear();
+            shard.entries.clear();
+        }
+    }
+
+    /**
+    * @brief Получить число хранимых значений, включая устаревшие.
+    */
+    size_t size() const {
+        size_t total = 0;
+        for (auto &shard : shards_) {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            total += shard.entries.size();
+        }
+        return total;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+    * @brief Элемент очереди LRU.
+    */
+    struct Entry {
+        Key key; //!< Ключ.
+        std::shared_ptr<const Value> value; //!< Значение.
+        Clock::time_point expires; //!< Момент устаревания.
+    };
+
+    /**
+    * @brief Сегмент кэша.
+    */
+    struct Shard {
+        mutable std::mutex mutex; //!< Мьютекс сегмента.
+        std::list<Entry> entries; //!< Очередь LRU, в начале - последнее использованное.
+        //! Индекс элементов очереди по ключу.
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+    };
+
+    size_t shardCapacity_; //!< Число хранимых значений в сегменте.
+    std::chrono::milliseconds ttl_; //!< Время жизни значения.
+    std::vector<Shard> shards_; //!< Сегменты.
+
+    /**
+    * @brief Получить сегмент ключа.
+    */
+    Shard &shardFor(const Key &key) {
+        return shards_[Hash()(key) % shards_.size()];
+    }
+};
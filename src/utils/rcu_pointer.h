@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Указатель на неизменяемый объект, который заменяется без блокировок читателей (RCU).
+* @details Читатель занимает слот, записывает в него текущую эпоху и читает указатель; пока
+* жив ReadGuard, объект не удаляется. Ни мьютексов, ни общих счетчиков ссылок на пути
+* чтения нет: читатели разных потоков пишут только в свои слоты, выровненные по строке кэша.
+* Писатель атомарно подменяет указатель и откладывает старый объект с номером эпохи, а
+* удаляет его, когда в слотах не остается читателей этой или более ранней эпохи.
+* Писатель должен быть один в каждый момент времени.
+*/
+template <typename T>
+class RcuPointer {
+public:
+    /**
+    * @brief Объект, прочитанный читателем. Удерживает его до разрушения.
+    */
+    class ReadGuard {
+    public:
+        ReadGuard(ReadGuard &&other) :
+        slot_(other.slot_),
+        value_(other.value_) {
+            other.slot_ = nullptr;
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+        ReadGuard &operator=(ReadGuard &&) = delete;
+
+        /**
+        * @brief Деструктор. Освобождает слот читателя.
+        */
+        ~ReadGuard() {
+            if (slot_) {
+                slot_->store(0, std::memory_order_release);
+            }
+        }
+
+        const T &operator*() const {
+            return *value_;
+        }
+
+        const T *operator->() const {
+            return value_;
+        }
+
+    private:
+        friend class RcuPointer;
+
+        ReadGuard(std::atomic<uint64_t> &slot, const T *value) :
+        slot_(&slot),
+        value_(value) {
+        }
+
+        std::atomic<uint64_t> *slot_; //!< Слот читателя.
+        const T *value_; //!< Прочитанный объект.
+    };
+
+    /**
+    * @brief Конструктор.
+    * @param value Начальный объект.
+    */
+    explicit RcuPointer(std::unique_ptr<const T> value) :
+    current_(value.release()),
+    epoch_(1),
+    slots_(),
+    retired_() {
+    }
+
+    /**
+    * @brief Деструктор. Удаляет все объекты; читателей к этому моменту быть не должно.
+    */
+    ~RcuPointer() {
+        delete current_.load();
+        for (auto &val : retired_) {
+            delete val.second;
+        }
+    }
+
+    RcuPointer(const RcuPointer &) = delete;
+    RcuPointer &operator=(const RcuPointer &) = delete;
+
+    /**
+    * @brief Прочитать текущий объект.
+    * @details Занимает свободный слот, начиная с того, что поток занимал в прошлый раз.
+    * Если все слоты заняты, уступает процессор и ищет снова.
+    */
+    ReadGuard read() const {
+        thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (size_t attempt = 0;; ++attempt) {
+            Slot &slot = slots_[(hint + attempt) % slotCount];
+            uint64_t expected = 0;
+            if (slot.epoch.load(std::memory_order_relaxed) == 0 &&
+                    slot.epoch.compare_exchange_strong(expected, epoch_.load())) {
+                hint = (hint + attempt) % slotCount;
+                // Указатель читается после записи эпохи: писатель, не увидевший эпоху в
+                // слоте, уже подменил указатель, и старый объект сюда не попадет.
+                return ReadGuard(slot.epoch, current_.load());
+            }
+            if ((attempt + 1) % slotCount == 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+    * @brief Заменить объект. Старый объект удаляется, когда его дочитают все читатели.
+    * @param value Новый объект.
+    */
+    void publish(std::unique_ptr<const T> value) {
+        const T *old = current_.exchange(value.release());
+        retired_.emplace_back(epoch_.fetch_add(1), old);
+        reclaim();
+    }
+
+    /**
+    * @brief Удалить замененные объекты, которые больше никто не читает.
+    * @return Число замененных объектов, которые еще читаются.
+    */
+    size_t reclaim() {
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for (const auto &slot : slots_) {
+            const uint64_t epoch = slot.epoch.load();
+            if (epoch != 0) {
+                oldest = std::min(oldest, epoch);
+            }
+        }
+
+        auto unused = std::partition(retired_.begin(), retired_.end(),
+                [oldest](const std::pair<uint64_t, const T *> &val) {
+                    return val.first >= oldest;
+                });
+        for (auto it = unused; it != retired_.end(); ++it) {
+            delete it->second;
+        }
+        retired_.erase(unused, retired_.end());
+        return retired_.size();
+    }
+
+private:
+    //! Число слотов читателей: не меньше числа потоков, читающих одновременно.
+    static const size_t slotCount = 64;
+
+    /**
+    * @brief Слот читателя.
+    */
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch {0}; //!< Эпоха читателя, 0 - слот свободен.
+    };
+
+    std::atomic<const T *> current_; //!< Текущий объект.
+    std::atomic<uint64_t> epoch_; //!< Текущая эпоха, растет при каждой замене.
+    mutable Slot slots_[slotCount]; //!< Слоты читателей.
+    //! Замененные объекты с эпохой замены, только для писателя.
+    std::vector<std::pair<uint64_t, const T *> > retired_;
+};
@@ -155,8 +155,22 @@ RequestConfig parseUrl(const std::string &url, const RequestConfig &sourceConfig
     return config;
 }
 
+std::string makeUrlFromRequestConfig(const RequestConfig &config) {
+    std::string url;
+
+    if (config.port == "443") {
+        url = "https://";
+    } else if (config.port == "80") {
+        url = "http://";
+    }
+    url += config.host;
+    url += config.target;
+
+    return url;
+}
+
 void extractAllLinks(const std::string &htmlContent, std::vector<RequestConfig> &targetLinks,
-        const RequestConfig &sourceConfig) {
+        const RequestConfig &sourceConfig, std::vector<std::string> *anchorTexts) {
     htmlDocPtr doc = htmlReadDoc(reinterpret_cast<const xmlChar *>(htmlContent.c_str()), nullptr,
             nullptr, HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
 
@@ -195,6 +209,16 @@ void extractAllLinks(const std::string &htmlContent, std::vector<RequestConfig>
 
                 if (!config.host.empty()) {
                     targetLinks.push_back(config);
+
+                    if (anchorTexts != nullptr) {
+                        std::string anchorText;
+                        xmlChar *linkText = xmlNodeGetContent(attrNode->parent);
+                        if (linkText != nullptr) {
+                            anchorText = reinterpret_cast<const char *>(linkText);
+                            xmlFree(linkText);
+                        }
+                        anchorTexts->push_back(anchorText);
+                    }
                 }
                 xmlFree(hrefValue);
             }
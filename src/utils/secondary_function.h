@@ -12,13 +12,21 @@
 */
 RequestConfig parseUrl(const std::string &url, const RequestConfig &sourceConfig);
 
+/**
+* @brief Собрать URL из параметров запроса HTML страницы.
+* @param config Параметры запроса.
+* @return Строка с URL.
+*/
+std::string makeUrlFromRequestConfig(const RequestConfig &config);
+
 /**
 * @brief Извлеч все ссылки с HTML страницы.
 * @param htmlContent Строка с исходным URL.
 * @param links Контейнер для записи ссылок.
+* @param anchorTexts Контейнер для записи текста каждой ссылки (необязательный).
 */
 void extractAllLinks(const std::string &htmlContent, std::vector<RequestConfig> &targetLinks,
-        const RequestConfig &sourceConfig);
+        const RequestConfig &sourceConfig, std::vector<std::string> *anchorTexts = nullptr);
 
 /**
 * @brief Преобразовать структуру с параметрами подключения в строку.
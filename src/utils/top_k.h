@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Накопитель k лучших значений по оценке.
+* @details Хранит не более k значений в куче, вершина которой - худшее из них, поэтому
+* память не зависит от числа переданных значений. При равных оценках выше стоит
+* значение, переданное раньше; равные оценки не вытесняют друг друга.
+*/
+template <typename T>
+class TopK {
+public:
+    /**
+    * @brief Конструктор.
+    * @param k Число хранимых значений, 0 - без ограничения.
+    */
+    explicit TopK(size_t k) :
+    k_(k),
+    counter_(0),
+    heap_() {
+    }
+
+    /**
+    * @brief Проверить, попадет ли значение с такой оценкой в накопитель.
+    * @param score Оценка.
+    */
+    bool accepts(int score) const {
+        return k_ == 0 || heap_.size() < k_ || score > heap_.front().score;
+    }
+
+    /**
+    * @brief Передать значение.
+    * @param score Оценка.
+    * @param value Значение.
+    */
+    void push(int score, T value) {
+        if (!accepts(score)) {
+            return;
+        }
+
+        if (k_ != 0 && heap_.size() == k_) {
+            std::pop_heap(heap_.begin(), heap_.end(), Better());
+            heap_.pop_back();
+        }
+        heap_.push_back(Entry {score, counter_++, std::move(value)});
+        std::push_heap(heap_.begin(), heap_.end(), Better());
+    }
+
+    /**
+    * @brief Получить число хранимых значений.
+    */
+    size_t size() const {
+        return heap_.size();
+    }
+
+    /**
+    * @brief Забрать значения по убыванию оценки. Накопитель опустошается.
+    * @return Пары (оценка, значение).
+    */
+    std::vector<std::pair<int, T> > take() {
+        std::sort_heap(heap_.begin(), heap_.end(), Better());
+
+        std::vector<std::pair<int, T> > result;
+        result.reserve(heap_.size());
+        for (auto &entry : heap_) {
+            result.emplace_back(entry.score, std::move(entry.value));
+        }
+        heap_.clear();
+        return result;
+    }
+
+private:
+    /**
+    * @brief Элемент кучи.
+    */
+    struct Entry {
+        int score; //!< Оценка.
+        uint64_t order; //!< Порядковый номер поступления.
+        T value; //!< Значение.
+    };
+
+    /**
+    * @brief Сравнение "lhs лучше rhs": на вершине кучи оказывается худший элемент.
+    */
+    struct Better {
+        bool operator()(const Entry &lhs, const Entry &rhs) const {
+            if (lhs.score != rhs.score) {
+                return lhs.score > rhs.score;
+            }
+            return lhs.order < rhs.order;
+        }
+    };
+
+    size_t k_; //!< Число хранимых значений.
+    uint64_t counter_; //!< Счетчик поступивших значений.
+    std::vector<Entry> heap_; //!< Куча значений.
+};